@@ -0,0 +1,194 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// arc_replacer.cpp
+//
+// Identification: src/buffer/arc_replacer.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/arc_replacer.h"
+
+#include <algorithm>
+
+#include "common/macros.h"
+
+namespace bustub {
+
+ARCReplacer::ARCReplacer(size_t num_frames) : num_frames_(num_frames), cache_size_(num_frames) {
+  records_ = new FrameRecord[num_frames_];
+}
+
+ARCReplacer::~ARCReplacer() { delete[] records_; }
+
+auto ARCReplacer::Victim(frame_id_t *frame_id) -> bool {
+  std::scoped_lock guard(mtx_);
+  // REPLACE from the ARC paper: take from T1 while it is above its target, from T2 otherwise. A frame stays resident
+  // in its list until the buffer pool confirms the eviction through Remove().
+  std::list<frame_id_t> *victims;
+  if (!t1_evictable_.empty() && (t1_size_ > target_t1_ || t2_evictable_.empty())) {
+    victims = &t1_evictable_;
+  } else if (!t2_evictable_.empty()) {
+    victims = &t2_evictable_;
+  } else {
+    return false;
+  }
+  *frame_id = victims->front();
+  victims->pop_front();
+  records_[*frame_id].evictable_ = false;
+  return true;
+}
+
+void ARCReplacer::Pin(frame_id_t frame_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_frames_, "frame id out of range");
+  std::scoped_lock guard(mtx_);
+  FrameRecord &record = records_[frame_id];
+  if (record.evictable_) {
+    EvictableList(record.list_).erase(record.pos_);
+    record.evictable_ = false;
+  }
+}
+
+void ARCReplacer::Unpin(frame_id_t frame_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_frames_, "frame id out of range");
+  std::scoped_lock guard(mtx_);
+  FrameRecord &record = records_[frame_id];
+  if (record.evictable_) {
+    return;
+  }
+  if (record.list_ == ArcList::NONE) {
+    record.list_ = ArcList::T1;
+    ++t1_size_;
+    TrimGhosts();
+  }
+  auto &evictable = EvictableList(record.list_);
+  record.pos_ = evictable.insert(evictable.end(), frame_id);
+  record.evictable_ = true;
+}
+
+void ARCReplacer::RecordAccess(frame_id_t frame_id, page_id_t page_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_frames_, "frame id out of range");
+  std::scoped_lock guard(mtx_);
+  FrameRecord &record = records_[frame_id];
+  if (record.list_ != ArcList::NONE && record.referenced_) {
+    // Hit on a resident page: it has now been seen twice and moves to (the MRU end of) T2.
+    if (record.list_ == ArcList::T1) {
+      --t1_size_;
+      ++t2_size_;
+    }
+    if (record.evictable_) {
+      EvictableList(record.list_).erase(record.pos_);
+      record.pos_ = t2_evictable_.insert(t2_evictable_.end(), frame_id);
+    }
+    record.list_ = ArcList::T2;
+    record.page_id_ = page_id;
+    return;
+  }
+
+  // This is the first access to the page since it was loaded, i.e. a miss. Adapt the target size of T1 if the page
+  // is a ghost. A page that was loaded ahead of its first access already sits in T1 and is placed again.
+  if (record.list_ != ArcList::NONE) {
+    --t1_size_;
+    if (record.evictable_) {
+      t1_evictable_.erase(record.pos_);
+    }
+  }
+  record.page_id_ = page_id;
+  record.referenced_ = true;
+  auto ghost = ghost_index_.find(page_id);
+  if (ghost == ghost_index_.end()) {
+    record.list_ = ArcList::T1;
+    ++t1_size_;
+    if (record.evictable_) {
+      record.pos_ = t1_evictable_.insert(t1_evictable_.end(), frame_id);
+    }
+    TrimGhosts();
+    return;
+  }
+  if (ghost->second.list_ == ArcList::B1) {
+    size_t delta = b1_.size() >= b2_.size() ? 1 : b2_.size() / b1_.size();
+    target_t1_ = std::min(cache_size_, target_t1_ + delta);
+    b1_.erase(ghost->second.pos_);
+  } else {
+    size_t delta = b2_.size() >= b1_.size() ? 1 : b1_.size() / b2_.size();
+    target_t1_ = target_t1_ > delta ? target_t1_ - delta : 0;
+    b2_.erase(ghost->second.pos_);
+  }
+  ghost_index_.erase(ghost);
+  record.list_ = ArcList::T2;
+  ++t2_size_;
+  if (record.evictable_) {
+    record.pos_ = t2_evictable_.insert(t2_evictable_.end(), frame_id);
+  }
+}
+
+void ARCReplacer::Remove(frame_id_t frame_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_frames_, "frame id out of range");
+  std::scoped_lock guard(mtx_);
+  FrameRecord &record = records_[frame_id];
+  if (record.evictable_) {
+    EvictableList(record.list_).erase(record.pos_);
+  }
+  if (record.list_ != ArcList::NONE) {
+    // Remember the page in the ghost list that matches the list it leaves.
+    bool from_t1 = record.list_ == ArcList::T1;
+    --(from_t1 ? t1_size_ : t2_size_);
+    if (record.page_id_ != INVALID_PAGE_ID && ghost_index_.count(record.page_id_) == 0) {
+      auto &ghosts = from_t1 ? b1_ : b2_;
+      ghost_index_[record.page_id_] = {from_t1 ? ArcList::B1 : ArcList::B2,
+                                       ghosts.insert(ghosts.end(), record.page_id_)};
+    }
+    TrimGhosts();
+  }
+  record = FrameRecord();
+}
+
+void ARCReplacer::PeekVictims(size_t count, std::vector<frame_id_t> *frame_ids) {
+  std::scoped_lock guard(mtx_);
+  // Follow the current preference of REPLACE; the other list only comes into play once the preferred one runs dry.
+  bool t1_first = t1_size_ > target_t1_;
+  for (auto *victims : {t1_first ? &t1_evictable_ : &t2_evictable_, t1_first ? &t2_evictable_ : &t1_evictable_}) {
+    for (auto it = victims->begin(); it != victims->end() && frame_ids->size() < count; ++it) {
+      frame_ids->push_back(*it);
+    }
+  }
+}
+
+void ARCReplacer::SetPoolSize(size_t pool_size) {
+  BUSTUB_ASSERT(pool_size <= num_frames_, "pool size out of range");
+  std::scoped_lock guard(mtx_);
+  cache_size_ = pool_size;
+  target_t1_ = std::min(target_t1_, cache_size_);
+  TrimGhosts();
+}
+
+auto ARCReplacer::Size() -> size_t {
+  std::scoped_lock guard(mtx_);
+  return t1_evictable_.size() + t2_evictable_.size();
+}
+
+auto ARCReplacer::GetTargetRecencySize() -> size_t {
+  std::scoped_lock guard(mtx_);
+  return target_t1_;
+}
+
+void ARCReplacer::TrimGhosts() {
+  // |T1| + |B1| <= c and |T1| + |T2| + |B1| + |B2| <= 2c. After a shrink, pinned pages in retired frames may keep
+  // T1 and T2 alone above 2c until they are unpinned; only ghosts can be dropped meanwhile.
+  while (!b1_.empty() && t1_size_ + b1_.size() > cache_size_) {
+    DropGhost(&b1_);
+  }
+  while ((!b1_.empty() || !b2_.empty()) && t1_size_ + t2_size_ + b1_.size() + b2_.size() > 2 * cache_size_) {
+    DropGhost(b2_.empty() ? &b1_ : &b2_);
+  }
+}
+
+void ARCReplacer::DropGhost(std::list<page_id_t> *ghosts) {
+  ghost_index_.erase(ghosts->front());
+  ghosts->pop_front();
+}
+
+}  // namespace bustub
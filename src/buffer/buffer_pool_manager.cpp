@@ -0,0 +1,87 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_manager.cpp
+//
+// Identification: src/buffer/buffer_pool_manager.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/buffer_pool_manager.h"
+
+#include <utility>
+#include <vector>
+
+namespace bustub {
+
+BufferPoolManager::BufferPoolManager() : long_pin_budget_(std::make_shared<LongPinBudget>(this)) {}
+
+BufferPoolManager::~BufferPoolManager() { long_pin_budget_->Close(); }
+
+auto LongPinBudget::Pin(page_id_t page_id, Holder *holder) -> Page * {
+  std::scoped_lock guard(latch_);
+  if (bpm_ == nullptr || pinned_.size() >= bpm_->GetPoolSize() / 8) {
+    exhausted_.store(true, std::memory_order_relaxed);
+    return nullptr;
+  }
+  Page *page = bpm_->FetchPage(page_id);
+  if (page != nullptr) {
+    pinned_.emplace(page_id, PinnedPage{page, holder});
+    exhausted_.store(pinned_.size() >= bpm_->GetPoolSize() / 8, std::memory_order_relaxed);
+  }
+  return page;
+}
+
+void LongPinBudget::Unpin(page_id_t page_id) {
+  std::scoped_lock guard(latch_);
+  if (bpm_ == nullptr || pinned_.erase(page_id) == 0) {
+    return;
+  }
+  bpm_->UnpinPage(page_id, false);
+  exhausted_.store(false, std::memory_order_relaxed);
+}
+
+void LongPinBudget::Forget(Holder *holder) {
+  std::scoped_lock reclaim_guard(reclaim_latch_);
+  std::scoped_lock guard(latch_);
+  for (auto it = pinned_.begin(); it != pinned_.end();) {
+    if (it->second.holder_ != holder) {
+      ++it;
+      continue;
+    }
+    if (bpm_ != nullptr) {
+      bpm_->UnpinPage(it->first, false);
+    }
+    it = pinned_.erase(it);
+  }
+  exhausted_.store(bpm_ == nullptr, std::memory_order_relaxed);
+}
+
+void LongPinBudget::Reclaim(const std::function<bool(const Page *)> &needed) {
+  std::scoped_lock reclaim_guard(reclaim_latch_);
+  std::vector<std::pair<page_id_t, Holder *>> reclaimed;
+  {
+    std::scoped_lock guard(latch_);
+    for (const auto &[page_id, pinned] : pinned_) {
+      if (needed(pinned.page_)) {
+        reclaimed.emplace_back(page_id, pinned.holder_);
+      }
+    }
+  }
+  // Holders may wait for their readers, which may need the budget to pin other pages meanwhile.
+  for (const auto &[page_id, holder] : reclaimed) {
+    holder->Release(page_id);
+  }
+}
+
+void LongPinBudget::Close() {
+  std::scoped_lock guard(latch_);
+  bpm_ = nullptr;
+  pinned_.clear();
+  exhausted_.store(true, std::memory_order_relaxed);
+}
+
+}  // namespace bustub
@@ -12,81 +12,660 @@
 
 #include "buffer/buffer_pool_manager_instance.h"
 
+#include <sys/mman.h>
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <vector>
+
 #include "common/logger.h"
 #include "common/macros.h"
+#include "common/util/numa_util.h"
 
 namespace bustub {
 
 BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager,
-                                                     LogManager *log_manager)
-    : BufferPoolManagerInstance(pool_size, 1, 0, disk_manager, log_manager) {}
+                                                     LogManager *log_manager, ReplacerType replacer_type)
+    : BufferPoolManagerInstance(pool_size, 1, 0, disk_manager, log_manager, replacer_type) {}
 
 BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, uint32_t num_instances, uint32_t instance_index,
-                                                     DiskManager *disk_manager, LogManager *log_manager)
+                                                     DiskManager *disk_manager, LogManager *log_manager,
+                                                     ReplacerType replacer_type, int numa_node)
     : pool_size_(pool_size),
+      max_pool_size_(pool_size * BUFFER_POOL_MAX_GROWTH),
+      constructed_frames_(pool_size),
       num_instances_(num_instances),
       instance_index_(instance_index),
+      numa_node_(numa_node),
       next_page_id_(instance_index),
       disk_manager_(disk_manager),
-      log_manager_(log_manager) {
+      log_manager_(log_manager),
+      scan_ring_capacity_(ScanRingCapacity(pool_size)) {
   BUSTUB_ASSERT(num_instances > 0, "If BPI is not part of a pool, then the pool size should just be 1");
   BUSTUB_ASSERT(
       instance_index < num_instances,
       "BPI index cannot be greater than the number of BPIs in the pool. In non-parallel case, index should just be 1.");
+  // Pages that are already in the database are never handed out again, unless they are freed.
+  auto num_pages = static_cast<uint32_t>(disk_manager_->GetNumPages());
+  if (num_pages > instance_index_) {
+    next_page_id_ = static_cast<page_id_t>(instance_index_ +
+                                           (num_pages - instance_index_ + num_instances_ - 1) / num_instances_ *
+                                               num_instances_);
+  }
   // We allocate a consecutive memory space for the buffer pool.
-  pages_ = new Page[pool_size_];
-  replacer_ = new LRUReplacer(pool_size);
-  pinned_num_ = 0;
+  AllocateFrames();
+  frames_ = new FrameHeader[max_pool_size_];
+  switch (replacer_type) {
+    case ReplacerType::LRU_K:
+      replacer_ = new LRUKReplacer(max_pool_size_);
+      break;
+    case ReplacerType::ARC:
+      replacer_ = new ARCReplacer(max_pool_size_);
+      break;
+    case ReplacerType::LRU:
+      replacer_ = new LRUReplacer(max_pool_size_);
+      break;
+    case ReplacerType::CLOCK:
+      replacer_ = new ClockReplacer(max_pool_size_);
+      break;
+  }
+  replacer_->SetPoolSize(pool_size);
 
-  // Initially, every page is in the free list.
+  // Initially, every page is in the free list. The frames past the pool size belong to nobody until it grows.
   for (size_t i = 0; i < pool_size_; ++i) {
     free_list_.emplace_back(static_cast<int>(i));
   }
+  for (size_t i = pool_size_; i < max_pool_size_; ++i) {
+    frames_[i].detached_ = true;
+  }
 }
 
 BufferPoolManagerInstance::~BufferPoolManagerInstance() {
-  delete[] pages_;
+  StopPageCleaner();
+  StopPrefetcher();
+  for (size_t i = 0; i < constructed_frames_; ++i) {
+    pages_[i].~Page();
+  }
+  munmap(frame_data_, frame_data_size_);
+  delete[] frames_;
   delete replacer_;
   free_list_.clear();
 }
 
-bool BufferPoolManagerInstance::FindFrame(frame_id_t *frame_id) {
-  if (!free_list_.empty()) {
-    *frame_id = free_list_.front();
-    free_list_.pop_front();
-    return true;
+void BufferPoolManagerInstance::AllocateFrames() {
+  frame_data_size_ = max_pool_size_ * (PAGE_SIZE + sizeof(Page));
+  void *data = MAP_FAILED;
+#ifdef MAP_HUGETLB
+  if (enable_huge_pages) {
+    // Explicit huge pages have to be reserved by the administrator; transparent huge pages are the fallback.
+    size_t huge_size = (frame_data_size_ + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    data = mmap(nullptr, huge_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (data != MAP_FAILED) {
+      frame_data_size_ = huge_size;
+    }
   }
-  if (replacer_->Victim(frame_id)) {
-    // 如果要替换的帧在page_table_中，就要改写，这里可以另外用一个map
-    if (reverse_page_table_.find(*frame_id) != reverse_page_table_.end()) {
-      Page *replaced_page = &pages_[*frame_id];
-      if (replaced_page->is_dirty_) {
-        disk_manager_->WritePage(replaced_page->page_id_, replaced_page->data_);
-        replaced_page->pin_count_ = 0;
+#endif
+  if (data == MAP_FAILED) {
+    data = mmap(nullptr, frame_data_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data == MAP_FAILED) {
+      throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    if (enable_huge_pages) {
+      madvise(data, frame_data_size_, MADV_HUGEPAGE);
+    }
+#endif
+  }
+  // Bind the arena before the frames are constructed below, which touches the pages of those frames.
+  if (numa_node_ >= 0 && !NumaUtil::BindMemory(data, frame_data_size_, numa_node_)) {
+    LOG_DEBUG("could not bind the frames to NUMA node %d", numa_node_);
+  }
+  frame_data_ = data;
+  pages_ = reinterpret_cast<Page *>(static_cast<char *>(data) + max_pool_size_ * PAGE_SIZE);
+  for (size_t i = 0; i < pool_size_; ++i) {
+    ConstructFrame(static_cast<frame_id_t>(i));
+  }
+}
+
+auto BufferPoolManagerInstance::ResizePool(size_t pool_size) -> bool {
+  if (pool_size == 0 || pool_size > max_pool_size_) {
+    return false;
+  }
+  std::scoped_lock resize_guard(resize_latch_);
+  const size_t old_size = pool_size_;
+  if (pool_size > old_size) {
+    replacer_->SetPoolSize(pool_size);
+    for (size_t i = old_size; i < pool_size; ++i) {
+      if (i == constructed_frames_) {
+        ConstructFrame(static_cast<frame_id_t>(i));
+        ++constructed_frames_;
+      }
+      // A frame that is still held by a thread that took it before it was retired stays with that thread.
+      frames_[i].retired_ = false;
+      if (frames_[i].detached_.exchange(false)) {
+        ReleaseFrame(static_cast<frame_id_t>(i));
       }
-      page_table_.erase(replaced_page->page_id_);
-      reverse_page_table_.erase(*frame_id);
     }
+    pool_size_ = pool_size;
+    std::scoped_lock ring_guard(scan_ring_latch_);
+    scan_ring_capacity_ = ScanRingCapacity(pool_size);
     return true;
   }
 
+  // Lower the size first, so that no new page is created in the frames that are about to be retired. Frames retired
+  // by an earlier shrink that could not vacate them are retried as well.
+  pool_size_ = pool_size;
+  for (size_t i = pool_size; i < old_size; ++i) {
+    frames_[i].retired_ = true;
+  }
+  {
+    std::scoped_lock free_list_guard(free_list_latch_);
+    free_list_.remove_if([this](frame_id_t frame_id) { return DetachIfRetired(frame_id); });
+  }
+  {
+    std::scoped_lock ring_guard(scan_ring_latch_);
+    scan_ring_.erase(std::remove_if(scan_ring_.begin(), scan_ring_.end(),
+                                    [this](frame_id_t frame_id) { return frames_[frame_id].retired_.load(); }),
+                     scan_ring_.end());
+    // The frames dropped from the ring are left to the replacer.
+    scan_ring_capacity_ = ScanRingCapacity(pool_size);
+    if (scan_ring_.size() > scan_ring_capacity_) {
+      scan_ring_.resize(scan_ring_capacity_);
+    }
+    scan_ring_next_ = 0;
+  }
+  // Pages kept pinned through the budget, e.g. swizzled by B+ trees, would pin the retired frames for good.
+  GetLongPinBudget()->Reclaim([this, pool_size](const Page *page) { return IsFrameBeyond(page, pool_size); });
+  bool vacated = true;
+  for (size_t i = pool_size; i < constructed_frames_; ++i) {
+    if (!frames_[i].detached_ && !VacateFrame(static_cast<frame_id_t>(i))) {
+      vacated = false;
+    }
+  }
+  replacer_->SetPoolSize(pool_size);
+  return vacated;
+}
+
+auto BufferPoolManagerInstance::DetachIfRetired(frame_id_t frame_id) -> bool {
+  FrameHeader &frame = frames_[frame_id];
+  if (!frame.retired_) {
+    return false;
+  }
+  frame.detached_ = true;
+  // A concurrent resize may have brought the frame back before it saw it detached. Whoever clears detached_ first
+  // owns the frame again.
+  return frame.retired_ || !frame.detached_.exchange(false);
+}
+
+auto BufferPoolManagerInstance::VacateFrame(frame_id_t frame_id) -> bool {
+  Page *page = &pages_[frame_id];
+  page_id_t page_id = page->page_id_;
+  if (page_id == INVALID_PAGE_ID) {
+    // A thread took the frame before it was retired and is about to fill it. It is dropped once its page is evicted.
+    return false;
+  }
+  // Keep the page resident if a frame is free, which costs a copy instead of a write and a later read.
+  frame_id_t target = 0;
+  bool have_target = false;
+  {
+    std::scoped_lock free_list_guard(free_list_latch_);
+    if (!free_list_.empty()) {
+      target = free_list_.front();
+      free_list_.pop_front();
+      have_target = true;
+    }
+  }
+  bool moved = false;
+  if (have_target) {
+    auto &shard = ShardOf(page_id);
+    std::scoped_lock shard_guard(shard.latch_);
+    auto it = shard.table_.find(page_id);
+    if (it != shard.table_.end() && it->second == frame_id && page->pin_count_ == 0 &&
+        frames_[frame_id].state_ == FrameState::READY) {
+      Page *moved_page = &pages_[target];
+      moved_page->BeginReassign();
+      memcpy(moved_page->GetData(), page->GetData(), PAGE_SIZE);
+      moved_page->page_id_ = page_id;
+      moved_page->EndReassign();
+      moved_page->pin_count_ = 0;
+      moved_page->is_dirty_ = page->is_dirty_.load();
+      frames_[target].scan_ = frames_[frame_id].scan_.load();
+      it->second = target;
+      page->page_id_ = INVALID_PAGE_ID;
+      page->is_dirty_ = false;
+      replacer_->Remove(frame_id);
+      replacer_->Unpin(target);
+      moved = true;
+    }
+  }
+  if (!moved) {
+    if (have_target) {
+      ReleaseFrame(target);
+    }
+    if (!EvictFrame(frame_id)) {
+      return false;
+    }
+  }
+  // Readers that reached the frame without pinning it must not validate what they read from it anymore.
+  page->BeginReassign();
+  page->EndReassign();
+  return DetachIfRetired(frame_id);
+}
+
+auto BufferPoolManagerInstance::FindFrame(frame_id_t *frame_id) -> bool {
+  {
+    // Retired frames are dropped on the way.
+    std::scoped_lock free_list_guard(free_list_latch_);
+    while (!free_list_.empty()) {
+      frame_id_t free_frame = free_list_.front();
+      free_list_.pop_front();
+      if (!DetachIfRetired(free_frame)) {
+        *frame_id = free_frame;
+        return true;
+      }
+    }
+  }
+  // A victim may have been pinned (or deleted) between leaving the replacer and being latched here. Such frames are
+  // simply dropped: they re-enter the replacer on their next unpin.
+  frame_id_t victim;
+  while (replacer_->Victim(&victim)) {
+    if (EvictFrame(victim) && !DetachIfRetired(victim)) {
+      *frame_id = victim;
+      return true;
+    }
+  }
   return false;
 }
 
-auto BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) -> bool {
-  if (page_id == INVALID_PAGE_ID || page_table_.find(page_id) == page_table_.end()) {
+auto BufferPoolManagerInstance::FindScanFrame(frame_id_t *frame_id) -> bool {
+  bool ring_full = false;
+  size_t slot = 0;
+  frame_id_t candidate = 0;
+  {
+    std::scoped_lock ring_guard(scan_ring_latch_);
+    if (scan_ring_capacity_ > 0 && scan_ring_.size() == scan_ring_capacity_) {
+      ring_full = true;
+      slot = scan_ring_next_;
+      scan_ring_next_ = (slot + 1) % scan_ring_capacity_;
+      candidate = scan_ring_[slot];
+    }
+  }
+  // The candidate may have been taken over by the replacer for a regular page, or be pinned by someone who still
+  // uses it. Either way it leaves the ring and a regular victim takes its slot.
+  if (ring_full && frames_[candidate].scan_ && EvictFrame(candidate) && !DetachIfRetired(candidate)) {
+    *frame_id = candidate;
+    return true;
+  }
+  if (!FindFrame(frame_id)) {
+    return false;
+  }
+  std::scoped_lock ring_guard(scan_ring_latch_);
+  // The ring may have been cut down by a resize in the meantime.
+  if (ring_full && slot < scan_ring_.size()) {
+    scan_ring_[slot] = *frame_id;
+  } else if (scan_ring_.size() < scan_ring_capacity_) {
+    scan_ring_.push_back(*frame_id);
+  }
+  return true;
+}
+
+auto BufferPoolManagerInstance::EvictFrame(frame_id_t frame_id) -> bool {
+  Page *page = &pages_[frame_id];
+  page_id_t page_id = page->page_id_;
+  if (page_id == INVALID_PAGE_ID) {
+    // The page was deleted and the frame already sits in the free list.
     return false;
   }
-  disk_manager_->WritePage(page_id, pages_[page_table_[page_id]].data_);
+  auto &shard = ShardOf(page_id);
+  std::unique_lock shard_guard(shard.latch_);
+  while (true) {
+    auto it = shard.table_.find(page_id);
+    if (it == shard.table_.end() || it->second != frame_id || page->pin_count_ > 0) {
+      return false;
+    }
+    if (frames_[frame_id].state_ != FrameState::READY) {
+      // Someone else is flushing the page; look again once that write is done.
+      shard_guard.unlock();
+      WaitForIo(frame_id);
+      shard_guard.lock();
+      continue;
+    }
+    if (!page->is_dirty_) {
+      shard.table_.erase(it);
+      break;
+    }
+    // Write the page back with the shard unlatched. The page stays in the page table meanwhile, so a concurrent
+    // fetch pins it and waits for this frame only; in that case the eviction is abandoned. The page cleaner is
+    // falling behind, so wake it up.
+    page_cleaner_cv_.notify_one();
+    page->is_dirty_ = false;
+    SetFrameState(frame_id, FrameState::WRITING_BACK);
+    shard_guard.unlock();
+    bool written = disk_manager_->WritePage(page_id, page->GetData());
+    shard_guard.lock();
+    if (!written) {
+      // Keep the page rather than lose its modifications; it re-enters the replacer on its next unpin.
+      page->is_dirty_ = true;
+      SetFrameState(frame_id, FrameState::READY);
+      return false;
+    }
+    SetFrameState(frame_id, FrameState::READY);
+  }
+  page->page_id_ = INVALID_PAGE_ID;
+  // A concurrent unpin may have put the frame back into the replacer after it was picked as a victim. The access
+  // history of the evicted page goes with it.
+  replacer_->Remove(frame_id);
   return true;
 }
 
+auto BufferPoolManagerInstance::PinFrame(frame_id_t frame_id) -> Page * {
+  Page *page = &pages_[frame_id];
+  if (page->pin_count_++ == 0) {
+    ++pinned_frames_;
+    replacer_->Pin(frame_id);
+  }
+  return page;
+}
+
+void BufferPoolManagerInstance::ReleaseFrame(frame_id_t frame_id) {
+  if (DetachIfRetired(frame_id)) {
+    return;
+  }
+  std::scoped_lock free_list_guard(free_list_latch_);
+  free_list_.push_back(frame_id);
+}
+
+void BufferPoolManagerInstance::SetFrameState(frame_id_t frame_id, FrameState state) {
+  FrameHeader &frame = frames_[frame_id];
+  {
+    std::scoped_lock frame_guard(frame.latch_);
+    frame.state_ = state;
+  }
+  if (state == FrameState::READY) {
+    frame.io_done_.notify_all();
+  }
+}
+
+void BufferPoolManagerInstance::WaitForIo(frame_id_t frame_id) {
+  FrameHeader &frame = frames_[frame_id];
+  if (frame.state_ == FrameState::READY) {
+    return;
+  }
+  std::unique_lock frame_guard(frame.latch_);
+  frame.io_done_.wait(frame_guard, [&frame] { return frame.state_ == FrameState::READY; });
+}
+
+void BufferPoolManagerInstance::StartPageCleaner() {
+  std::scoped_lock cleaner_guard(page_cleaner_latch_);
+  if (page_cleaner_thread_ != nullptr) {
+    return;
+  }
+  page_cleaner_running_ = true;
+  page_cleaner_thread_ = new std::thread(&BufferPoolManagerInstance::RunPageCleaner, this);
+}
+
+void BufferPoolManagerInstance::StopPageCleaner() {
+  std::thread *cleaner;
+  {
+    std::scoped_lock cleaner_guard(page_cleaner_latch_);
+    if (page_cleaner_thread_ == nullptr) {
+      return;
+    }
+    page_cleaner_running_ = false;
+    cleaner = page_cleaner_thread_;
+    page_cleaner_thread_ = nullptr;
+  }
+  page_cleaner_cv_.notify_one();
+  cleaner->join();
+  delete cleaner;
+}
+
+void BufferPoolManagerInstance::RunPageCleaner() {
+  std::vector<frame_id_t> candidates;
+  std::vector<DiskRequest> writes;
+  std::vector<frame_id_t> frame_ids;
+  std::unique_lock cleaner_guard(page_cleaner_latch_);
+  while (page_cleaner_running_) {
+    page_cleaner_cv_.wait_for(cleaner_guard, page_cleaner_interval);
+    if (!page_cleaner_running_) {
+      break;
+    }
+    cleaner_guard.unlock();
+    candidates.clear();
+    writes.clear();
+    frame_ids.clear();
+    replacer_->PeekVictims(page_cleaner_clean_target, &candidates);
+    for (auto frame_id : candidates) {
+      if (writes.size() >= page_cleaner_max_writes) {
+        break;
+      }
+      if (CleanFrame(frame_id, &writes)) {
+        frame_ids.push_back(frame_id);
+      }
+    }
+    WriteBack(&writes, frame_ids);
+    cleaner_guard.lock();
+  }
+}
+
+auto BufferPoolManagerInstance::CleanFrame(frame_id_t frame_id, std::vector<DiskRequest> *writes) -> bool {
+  Page *page = &pages_[frame_id];
+  page_id_t page_id = page->page_id_;
+  if (page_id == INVALID_PAGE_ID || !page->is_dirty_) {
+    return false;
+  }
+  auto &shard = ShardOf(page_id);
+  std::unique_lock shard_guard(shard.latch_);
+  auto it = shard.table_.find(page_id);
+  if (it == shard.table_.end() || it->second != frame_id || page->pin_count_ > 0 || !page->is_dirty_ ||
+      frames_[frame_id].state_ != FrameState::READY) {
+    return false;
+  }
+  page->is_dirty_ = false;
+  SetFrameState(frame_id, FrameState::WRITING_BACK);
+  writes->push_back({true, page_id, page->GetData()});
+  return true;
+}
+
+void BufferPoolManagerInstance::WriteBack(std::vector<DiskRequest> *writes, const std::vector<frame_id_t> &frame_ids) {
+  if (writes->empty()) {
+    return;
+  }
+  disk_manager_->SubmitRequests(writes);
+  disk_manager_->WaitForRequests(writes);
+  for (auto frame_id : frame_ids) {
+    SetFrameState(frame_id, FrameState::READY);
+  }
+}
+
+void BufferPoolManagerInstance::PrefetchPgImp(page_id_t page_id, size_t count, next_page_fn next_page,
+                                              AccessType access_type) {
+  if (page_id == INVALID_PAGE_ID || count == 0) {
+    return;
+  }
+  std::scoped_lock prefetch_guard(prefetch_latch_);
+  if (prefetch_thread_ == nullptr) {
+    prefetch_running_ = true;
+    prefetch_thread_ = new std::thread(&BufferPoolManagerInstance::RunPrefetcher, this);
+  }
+  // Prefetching is only a hint; drop the request rather than letting the queue grow.
+  if (prefetch_queue_.size() >= pool_size_) {
+    return;
+  }
+  prefetch_queue_.push_back({page_id, count, next_page, access_type});
+  prefetch_cv_.notify_one();
+}
+
+void BufferPoolManagerInstance::StopPrefetcher() {
+  std::thread *prefetcher;
+  {
+    std::scoped_lock prefetch_guard(prefetch_latch_);
+    if (prefetch_thread_ == nullptr) {
+      return;
+    }
+    prefetch_running_ = false;
+    prefetcher = prefetch_thread_;
+    prefetch_thread_ = nullptr;
+  }
+  prefetch_cv_.notify_one();
+  prefetcher->join();
+  delete prefetcher;
+}
+
+void BufferPoolManagerInstance::RunPrefetcher() {
+  // Requests are worked on in batches, which bounds the number of frames the prefetcher pins at a time.
+  const size_t max_batch = std::max<size_t>(pool_size_ / 8, 1);
+  std::vector<PrefetchRequest> requests;
+  std::unique_lock prefetch_guard(prefetch_latch_);
+  while (true) {
+    prefetch_cv_.wait(prefetch_guard, [this] { return !prefetch_running_ || !prefetch_queue_.empty(); });
+    if (!prefetch_running_) {
+      break;
+    }
+    requests.clear();
+    while (!prefetch_queue_.empty() && requests.size() < max_batch) {
+      requests.push_back(prefetch_queue_.front());
+      prefetch_queue_.pop_front();
+    }
+    prefetch_guard.unlock();
+    Prefetch(&requests);
+    prefetch_guard.lock();
+  }
+}
+
+void BufferPoolManagerInstance::Prefetch(std::vector<PrefetchRequest> *requests) {
+  std::vector<Page *> pages;
+  std::vector<DiskRequest> reads;
+  std::vector<frame_id_t> loads;
+  auto in_this_instance = [this](page_id_t page_id) {
+    return page_id != INVALID_PAGE_ID && static_cast<uint32_t>(page_id) % num_instances_ == instance_index_;
+  };
+  requests->erase(std::remove_if(requests->begin(), requests->end(),
+                                 [&](const PrefetchRequest &request) { return !in_this_instance(request.page_id_); }),
+                  requests->end());
+  // Every round loads the next page of all chains at once.
+  while (!requests->empty()) {
+    pages.assign(requests->size(), nullptr);
+    reads.clear();
+    loads.clear();
+    for (size_t i = 0; i < requests->size(); ++i) {
+      const PrefetchRequest &request = (*requests)[i];
+      bool load;
+      pages[i] = StartPinPage(request.page_id_, false, request.access_type_, &load);
+      if (pages[i] != nullptr && load) {
+        reads.push_back({false, request.page_id_, pages[i]->GetData()});
+        loads.push_back(static_cast<frame_id_t>(pages[i] - pages_));
+      }
+    }
+    disk_manager_->SubmitRequests(&reads);
+    disk_manager_->WaitForRequests(&reads);
+    for (auto frame_id : loads) {
+      pages_[frame_id].EndReassign();
+      SetFrameState(frame_id, FrameState::READY);
+    }
+
+    size_t active = 0;
+    for (size_t i = 0; i < requests->size(); ++i) {
+      PrefetchRequest request = (*requests)[i];
+      Page *page = pages[i];
+      if (page == nullptr) {
+        // Every frame is pinned.
+        continue;
+      }
+      WaitForIo(static_cast<frame_id_t>(page - pages_));
+      page_id_t next_page_id = INVALID_PAGE_ID;
+      if (request.next_page_ != nullptr && request.count_ > 1) {
+        page->RLatch();
+        next_page_id = request.next_page_(page->GetData());
+        page->RUnlatch();
+      }
+      UnpinPgImp(request.page_id_, false);
+      // The chain ends, or the rest of it belongs to another instance.
+      if (in_this_instance(next_page_id)) {
+        request.page_id_ = next_page_id;
+        --request.count_;
+        (*requests)[active++] = request;
+      }
+    }
+    requests->resize(active);
+  }
+}
+
+auto BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) -> bool {
+  if (page_id == INVALID_PAGE_ID) {
+    return false;
+  }
+  auto &shard = ShardOf(page_id);
+  std::unique_lock shard_guard(shard.latch_);
+  while (true) {
+    auto it = shard.table_.find(page_id);
+    if (it == shard.table_.end()) {
+      return false;
+    }
+    frame_id_t frame_id = it->second;
+    if (frames_[frame_id].state_ != FrameState::READY) {
+      shard_guard.unlock();
+      WaitForIo(frame_id);
+      shard_guard.lock();
+      continue;
+    }
+    // Clear the dirty flag before writing so that a modification made during the write is not lost.
+    Page *page = &pages_[frame_id];
+    page->is_dirty_ = false;
+    SetFrameState(frame_id, FrameState::WRITING_BACK);
+    shard_guard.unlock();
+    bool written = disk_manager_->WritePage(page_id, page->GetData());
+    if (!written) {
+      page->is_dirty_ = true;
+    }
+    SetFrameState(frame_id, FrameState::READY);
+    return written;
+  }
+}
+
 void BufferPoolManagerInstance::FlushAllPgsImp() {
-  // latch_.lock();
-  for (auto it : page_table_) {
-    disk_manager_->WritePage(it.first, pages_[it.second].data_);
+  WriteDirtyPages();
+  disk_manager_->SyncPages();
+}
+
+void BufferPoolManagerInstance::WriteDirtyPages() {
+  // Write back the dirty pages in one sorted batch. Pages with I/O in flight are flushed one by one afterwards, once
+  // that I/O is done.
+  std::vector<DiskRequest> writes;
+  std::vector<std::pair<page_id_t, frame_id_t>> frame_ids;
+  std::vector<page_id_t> busy_page_ids;
+  for (auto &shard : page_table_) {
+    std::scoped_lock shard_guard(shard.latch_);
+    for (const auto &[page_id, frame_id] : shard.table_) {
+      if (frames_[frame_id].state_ != FrameState::READY) {
+        busy_page_ids.push_back(page_id);
+        continue;
+      }
+      Page *page = &pages_[frame_id];
+      if (!page->is_dirty_) {
+        continue;
+      }
+      page->is_dirty_ = false;
+      SetFrameState(frame_id, FrameState::WRITING_BACK);
+      writes.push_back({true, page_id, page->GetData()});
+      frame_ids.emplace_back(page_id, frame_id);
+    }
+  }
+  if (!writes.empty()) {
+    disk_manager_->WritePages(&writes);
+    // The writes come back sorted by page id; a page that could not be written is dirty again.
+    std::sort(frame_ids.begin(), frame_ids.end());
+    for (size_t i = 0; i < writes.size(); ++i) {
+      frame_id_t frame_id = frame_ids[i].second;
+      if (!writes[i].done_) {
+        pages_[frame_id].is_dirty_ = true;
+      }
+      SetFrameState(frame_id, FrameState::READY);
+    }
+  }
+  for (auto page_id : busy_page_ids) {
+    FlushPgImp(page_id);
   }
-  // latch_.unlock();
 }
 
 auto BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) -> Page * {
@@ -95,39 +674,76 @@ auto BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) -> Page * {
   // 2.   Pick a victim page P from either the free list or the replacer. Always pick from the free list first.
   // 3.   Update P's metadata, zero out memory and add P to the page table.
   // 4.   Set the page ID output parameter. Return a pointer to P.
-  latch_.lock();
-  bool flag = true;
-  for (int i = 0; i < static_cast<int>(pool_size_); ++i) {
-    if (pages_[i].pin_count_ == 0) {
-      flag = false;
-      break;
-    }
-  }
-  if (flag) {
-    latch_.unlock();
+  if (IsFull()) {
     return nullptr;
   }
-  frame_id_t stored_frame;
-  if (!FindFrame(&stored_frame)) {
-    latch_.unlock();
+  frame_id_t frame_id;
+  if (!FindFrame(&frame_id)) {
     return nullptr;
   }
+  // A freed page can still be resident if it was read through a stale page id after it was deleted. Leave it alone
+  // and take another page instead, then give the skipped ones back so that they are reused once they are evicted.
+  std::vector<page_id_t> skipped_page_ids;
   page_id_t new_page_id = AllocatePage();
-  Page *new_page = &pages_[stored_frame];
-  new_page->page_id_ = new_page_id;
-  new_page->pin_count_++;
-  replacer_->Pin(stored_frame);
-  page_table_[new_page_id] = stored_frame;
-  reverse_page_table_[stored_frame] = new_page_id;
-  new_page->is_dirty_ = false;
-  disk_manager_->WritePage(new_page->GetPageId(), new_page->GetData());
+  PageTableShard *shard = &ShardOf(new_page_id);
+  std::unique_lock shard_guard(shard->latch_);
+  while (shard->table_.count(new_page_id) > 0) {
+    shard_guard.unlock();
+    skipped_page_ids.push_back(new_page_id);
+    new_page_id = AllocatePage();
+    shard = &ShardOf(new_page_id);
+    shard_guard = std::unique_lock(shard->latch_);
+  }
+  Page *page = &pages_[frame_id];
+  page->BeginReassign();
+  page->ResetMemory();
+  page->page_id_ = new_page_id;
+  page->EndReassign();
+  page->pin_count_ = 1;
+  ++pinned_frames_;
+  // The page is only written once it is evicted or flushed; until then it reads as zeroes from disk anyway.
+  page->is_dirty_ = true;
+  frames_[frame_id].scan_ = false;
+  shard->table_.emplace(new_page_id, frame_id);
+  shard_guard.unlock();
+  for (auto skipped_page_id : skipped_page_ids) {
+    DeallocatePage(skipped_page_id);
+  }
+  // The frame stays pinned from here on, so its access can be recorded without the shard latch.
+  replacer_->RecordAccess(frame_id, new_page_id);
   *page_id = new_page_id;
-  latch_.unlock();
+  return page;
+}
+
+auto BufferPoolManagerInstance::FetchPgImp(page_id_t page_id, AccessType access_type) -> Page * {
+  return PinPage(page_id, true, access_type);
+}
 
-  return new_page;
+auto BufferPoolManagerInstance::PinPage(page_id_t page_id, bool record_access, AccessType access_type) -> Page * {
+  bool load;
+  Page *page = StartPinPage(page_id, record_access, access_type, &load);
+  if (page == nullptr) {
+    return nullptr;
+  }
+  auto frame_id = static_cast<frame_id_t>(page - pages_);
+  if (load) {
+    disk_manager_->ReadPage(page_id, page->GetData());
+    page->EndReassign();
+    SetFrameState(frame_id, FrameState::READY);
+  } else {
+    WaitForIo(frame_id);
+  }
+  if (record_access) {
+    (load ? num_misses_ : num_hits_).fetch_add(1, std::memory_order_relaxed);
+    if (numa_node_ >= 0 && NumaUtil::CurrentNode() != numa_node_) {
+      num_remote_accesses_.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+  return page;
 }
 
-auto BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) -> Page * {
+auto BufferPoolManagerInstance::StartPinPage(page_id_t page_id, bool record_access, AccessType access_type,
+                                             bool *load) -> Page * {
   // 1.     Search the page table for the requested page (P).
   // 1.1    If P exists, pin it and return it immediately.
   // 1.2    If P does not exist, find a replacement page (R) from either the free list or the replacer.
@@ -135,36 +751,47 @@ auto BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) -> Page * {
   // 2.     If R is dirty, write it back to the disk.
   // 3.     Delete R from the page table and insert P.
   // 4.     Update P's metadata, read in the page content from disk, and then return a pointer to P.
-  latch_.lock();
-  if (page_table_.find(page_id) != page_table_.end()) {
-    frame_id_t frame_id = page_table_[page_id];
-    Page *page = &pages_[frame_id];
-    page->pin_count_++;
-    replacer_->Pin(frame_id);
-    latch_.unlock();
-    return page;
-  }
-  frame_id_t stored_frame;
-  if (!FindFrame(&stored_frame)) {
-    latch_.unlock();
-    return nullptr;
+  auto &shard = ShardOf(page_id);
+  std::unique_lock shard_guard(shard.latch_);
+  auto it = shard.table_.find(page_id);
+  if (it == shard.table_.end()) {
+    shard_guard.unlock();
+    frame_id_t frame_id;
+    if (!(access_type == AccessType::SCAN ? FindScanFrame(&frame_id) : FindFrame(&frame_id))) {
+      return nullptr;
+    }
+    shard_guard.lock();
+    it = shard.table_.find(page_id);
+    if (it == shard.table_.end()) {
+      // Publish the page in LOADING state; the caller reads it in with the shard unlatched. Concurrent requests for
+      // the same page pin the frame and wait for the read to finish.
+      Page *page = &pages_[frame_id];
+      page->BeginReassign();
+      page->page_id_ = page_id;
+      page->pin_count_ = 1;
+      ++pinned_frames_;
+      page->is_dirty_ = false;
+      frames_[frame_id].scan_ = access_type == AccessType::SCAN;
+      SetFrameState(frame_id, FrameState::LOADING);
+      shard.table_.emplace(page_id, frame_id);
+      shard_guard.unlock();
+      if (record_access) {
+        replacer_->RecordAccess(frame_id, page_id);
+      }
+      *load = true;
+      return page;
+    }
+    // Another thread brought the page in while we were looking for a frame.
+    ReleaseFrame(frame_id);
   }
-  Page *new_page = &pages_[stored_frame];
-  if (new_page->is_dirty_) {
-    disk_manager_->WritePage(new_page->page_id_, new_page->data_);
+  frame_id_t frame_id = it->second;
+  Page *page = PinFrame(frame_id);
+  shard_guard.unlock();
+  if (record_access) {
+    replacer_->RecordAccess(frame_id, page_id);
   }
-  page_table_.erase(new_page->page_id_);
-  new_page->page_id_ = page_id;
-  new_page->pin_count_++;
-  replacer_->Pin(stored_frame);
-  new_page->is_dirty_ = false;
-  replacer_->Pin(stored_frame);
-  disk_manager_->ReadPage(page_id, new_page->GetData());
-  page_table_[page_id] = stored_frame;
-  reverse_page_table_[stored_frame] = page_id;
-  latch_.unlock();
-
-  return new_page;
+  *load = false;
+  return page;
 }
 
 auto BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) -> bool {
@@ -173,62 +800,63 @@ auto BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) -> bool {
   // 1.   If P does not exist, return true.
   // 2.   If P exists, but has a non-zero pin-count, return false. Someone is using the page.
   // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
-
-  latch_.lock();
-  // DeallocatePage(page_id);
-  if (page_table_.find(page_id) == page_table_.end()) {
-    latch_.unlock();
+  auto &shard = ShardOf(page_id);
+  std::unique_lock shard_guard(shard.latch_);
+  while (true) {
+    auto it = shard.table_.find(page_id);
+    if (it == shard.table_.end()) {
+      DeallocatePage(page_id);
+      return true;
+    }
+    frame_id_t frame_id = it->second;
+    Page *page = &pages_[frame_id];
+    if (page->pin_count_ > 0) {
+      return false;
+    }
+    // An unpinned page may still be being written back, by the page cleaner or an eviction: wait until it is done.
+    if (frames_[frame_id].state_ != FrameState::READY) {
+      shard_guard.unlock();
+      WaitForIo(frame_id);
+      shard_guard.lock();
+      continue;
+    }
+    DeallocatePage(page_id);
+    shard.table_.erase(it);
+    replacer_->Remove(frame_id);
+    page->page_id_ = INVALID_PAGE_ID;
+    page->is_dirty_ = false;
+    ReleaseFrame(frame_id);
     return true;
   }
-  frame_id_t stored_frame = page_table_[page_id];
-  Page *delete_page = &pages_[stored_frame];
-  if (delete_page->pin_count_ > 0) {
-    latch_.unlock();
-    return false;
-  }
-  if (delete_page->is_dirty_) {
-    FlushPgImp(page_id);
-  }
-  DeallocatePage(page_id);
-  reverse_page_table_.erase(stored_frame);
-  page_table_.erase(page_id);
-  free_list_.push_back(stored_frame);
-  delete_page->is_dirty_ = false;
-  delete_page->pin_count_ = 0;
-  delete_page->page_id_ = INVALID_PAGE_ID;
-
-  latch_.unlock();
-  return true;
 }
 
 auto BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool {
-  latch_.lock();
-  if (page_table_.find(page_id) == page_table_.end()) {
-    latch_.unlock();
+  auto &shard = ShardOf(page_id);
+  std::scoped_lock shard_guard(shard.latch_);
+  auto it = shard.table_.find(page_id);
+  if (it == shard.table_.end()) {
     return false;
   }
-  frame_id_t stored_frame = page_table_[page_id];
-  Page *unpin_page = &pages_[stored_frame];
-  // unpin_page -> is_dirty_ = is_dirty;
-  if (is_dirty) {  // notice
-    unpin_page->is_dirty_ = true;
-  }
-  if (unpin_page->pin_count_ == 0) {
-    latch_.unlock();
+  Page *page = &pages_[it->second];
+  if (page->pin_count_ <= 0) {
     return false;
   }
-  unpin_page->pin_count_--;
-  if (unpin_page->GetPinCount() == 0) {
-    replacer_->Unpin(stored_frame);
+  if (is_dirty) {
+    page->is_dirty_ = true;
+  }
+  if (--page->pin_count_ == 0) {
+    --pinned_frames_;
+    replacer_->Unpin(it->second);
   }
-
-  latch_.unlock();
   return true;
 }
 
 auto BufferPoolManagerInstance::AllocatePage() -> page_id_t {
-  const page_id_t next_page_id = next_page_id_;
-  next_page_id_ += num_instances_;
+  page_id_t next_page_id = disk_manager_->AllocateFreePage(num_instances_, instance_index_);
+  if (next_page_id == INVALID_PAGE_ID) {
+    next_page_id = next_page_id_.fetch_add(num_instances_);
+    disk_manager_->ReservePage(next_page_id);
+  }
   ValidatePageId(next_page_id);
   return next_page_id;
 }
@@ -236,16 +864,23 @@ auto BufferPoolManagerInstance::AllocatePage() -> page_id_t {
 void BufferPoolManagerInstance::ValidatePageId(const page_id_t page_id) const {
   assert(page_id % num_instances_ == instance_index_);  // allocated pages mod back to this BPI
 }
-auto BufferPoolManagerInstance::Count() -> int {
-  latch_.lock();
-  int tot = 0;
-  for (int i = 0; i < static_cast<int>(pool_size_); ++i) {
+
+auto BufferPoolManagerInstance::Count() -> int { return static_cast<int>(pinned_frames_.load()); }
+
+auto BufferPoolManagerInstance::IsFull() const -> bool {
+  size_t pool_size = pool_size_;
+  size_t pinned = pinned_frames_;
+  if (pinned < pool_size) {
+    return false;
+  }
+  // The pool shrank while some of its frames were pinned: those pins do not take up the frames left.
+  size_t constructed_frames = constructed_frames_;
+  for (size_t i = pool_size; i < constructed_frames && pinned >= pool_size; ++i) {
     if (pages_[i].pin_count_ > 0) {
-      tot++;
+      --pinned;
     }
   }
-  latch_.unlock();
-  return tot;
+  return pinned >= pool_size;
 }
 
 }  // namespace bustub
@@ -12,18 +12,73 @@
 
 #include "buffer/clock_replacer.h"
 
+#include "common/macros.h"
+
 namespace bustub {
 
-ClockReplacer::ClockReplacer(size_t num_pages) {}
+ClockReplacer::ClockReplacer(size_t num_pages) : num_pages_(num_pages) {
+  states_ = new std::atomic<uint8_t>[num_pages_];
+  for (size_t i = 0; i < num_pages_; ++i) {
+    states_[i] = 0;
+  }
+}
+
+ClockReplacer::~ClockReplacer() { delete[] states_; }
 
-ClockReplacer::~ClockReplacer() = default;
+auto ClockReplacer::Victim(frame_id_t *frame_id) -> bool {
+  std::scoped_lock guard(hand_latch_);
+  // Every full turn clears the reference bits it passes, so the sweep finds a victim within two turns unless frames
+  // keep getting unpinned concurrently.
+  while (size_ > 0) {
+    std::atomic<uint8_t> &state = states_[hand_];
+    size_t current = hand_;
+    hand_ = (hand_ + 1) % num_pages_;
+    uint8_t bits = state.load();
+    if ((bits & IN_CLOCK) == 0) {
+      continue;
+    }
+    if ((bits & REFERENCED) != 0) {
+      state.compare_exchange_strong(bits, IN_CLOCK);
+      continue;
+    }
+    if (state.compare_exchange_strong(bits, 0)) {
+      --size_;
+      *frame_id = static_cast<frame_id_t>(current);
+      return true;
+    }
+  }
+  return false;
+}
 
-auto ClockReplacer::Victim(frame_id_t *frame_id) -> bool { return false; }
+void ClockReplacer::Pin(frame_id_t frame_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_pages_, "frame id out of range");
+  if ((states_[frame_id].exchange(0) & IN_CLOCK) != 0) {
+    --size_;
+  }
+}
 
-void ClockReplacer::Pin(frame_id_t frame_id) {}
+void ClockReplacer::Unpin(frame_id_t frame_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_pages_, "frame id out of range");
+  // Count the frame before publishing it so that a concurrent Pin or Victim never drives size_ below zero.
+  ++size_;
+  if ((states_[frame_id].fetch_or(IN_CLOCK | REFERENCED) & IN_CLOCK) != 0) {
+    --size_;
+  }
+}
 
-void ClockReplacer::Unpin(frame_id_t frame_id) {}
+void ClockReplacer::PeekVictims(size_t count, std::vector<frame_id_t> *frame_ids) {
+  std::scoped_lock guard(hand_latch_);
+  // Frames the hand would take on this turn come first, then the ones that only go on the next turn.
+  for (uint8_t wanted : {IN_CLOCK, static_cast<uint8_t>(IN_CLOCK | REFERENCED)}) {
+    for (size_t i = 0; i < num_pages_ && frame_ids->size() < count; ++i) {
+      size_t current = (hand_ + i) % num_pages_;
+      if (states_[current].load() == wanted) {
+        frame_ids->push_back(static_cast<frame_id_t>(current));
+      }
+    }
+  }
+}
 
-auto ClockReplacer::Size() -> size_t { return 0; }
+auto ClockReplacer::Size() -> size_t { return size_; }
 
 }  // namespace bustub
@@ -0,0 +1,128 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.cpp
+//
+// Identification: src/buffer/lru_k_replacer.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/lru_k_replacer.h"
+
+#include "common/macros.h"
+
+namespace bustub {
+
+LRUKReplacer::LRUKReplacer(size_t num_frames, size_t k, size_t correlated_period)
+    : num_frames_(num_frames), k_(k), correlated_period_(correlated_period) {
+  BUSTUB_ASSERT(k_ > 0, "LRU-K needs to remember at least one access per frame");
+  records_ = new FrameRecord[num_frames_];
+  history_ = new uint64_t[num_frames_ * k_];
+}
+
+LRUKReplacer::~LRUKReplacer() {
+  delete[] records_;
+  delete[] history_;
+}
+
+void LRUKReplacer::PushAccess(frame_id_t frame_id, uint64_t timestamp) {
+  FrameRecord &record = records_[frame_id];
+  history_[frame_id * k_ + record.next_] = timestamp;
+  record.next_ = (record.next_ + 1) % k_;
+  if (record.count_ < k_) {
+    ++record.count_;
+  }
+}
+
+auto LRUKReplacer::KeyOf(frame_id_t frame_id) const -> EvictionKey {
+  const FrameRecord &record = records_[frame_id];
+  // Until the ring buffer wraps around the oldest access sits in slot 0; afterwards it is the next slot to overwrite,
+  // which is also the K-th most recent access.
+  if (record.count_ == 0) {
+    return {false, record.last_access_, frame_id};
+  }
+  size_t oldest = record.count_ < k_ ? 0 : record.next_;
+  return {record.count_ == k_, history_[frame_id * k_ + oldest], frame_id};
+}
+
+auto LRUKReplacer::Victim(frame_id_t *frame_id) -> bool {
+  std::scoped_lock guard(mtx_);
+  if (evictable_.empty()) {
+    return false;
+  }
+  *frame_id = std::get<2>(*evictable_.begin());
+  evictable_.erase(evictable_.begin());
+  records_[*frame_id].evictable_ = false;
+  return true;
+}
+
+void LRUKReplacer::Pin(frame_id_t frame_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_frames_, "frame id out of range");
+  std::scoped_lock guard(mtx_);
+  FrameRecord &record = records_[frame_id];
+  if (record.evictable_) {
+    evictable_.erase(KeyOf(frame_id));
+    record.evictable_ = false;
+  }
+}
+
+void LRUKReplacer::Unpin(frame_id_t frame_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_frames_, "frame id out of range");
+  std::scoped_lock guard(mtx_);
+  FrameRecord &record = records_[frame_id];
+  if (record.evictable_) {
+    return;
+  }
+  if (record.count_ == 0) {
+    // Ordered as if it was accessed now, but not counted as a reference (e.g. a page that was read ahead).
+    record.last_access_ = ++current_timestamp_;
+  }
+  record.evictable_ = true;
+  evictable_.insert(KeyOf(frame_id));
+}
+
+void LRUKReplacer::RecordAccess(frame_id_t frame_id, page_id_t page_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_frames_, "frame id out of range");
+  std::scoped_lock guard(mtx_);
+  FrameRecord &record = records_[frame_id];
+  uint64_t now = ++current_timestamp_;
+  bool correlated = record.count_ > 0 && now - record.last_access_ <= correlated_period_;
+  record.last_access_ = now;
+  if (correlated) {
+    return;
+  }
+  if (record.evictable_) {
+    evictable_.erase(KeyOf(frame_id));
+    PushAccess(frame_id, now);
+    evictable_.insert(KeyOf(frame_id));
+  } else {
+    PushAccess(frame_id, now);
+  }
+}
+
+void LRUKReplacer::Remove(frame_id_t frame_id) {
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < num_frames_, "frame id out of range");
+  std::scoped_lock guard(mtx_);
+  FrameRecord &record = records_[frame_id];
+  if (record.evictable_) {
+    evictable_.erase(KeyOf(frame_id));
+  }
+  record = FrameRecord();
+}
+
+void LRUKReplacer::PeekVictims(size_t count, std::vector<frame_id_t> *frame_ids) {
+  std::scoped_lock guard(mtx_);
+  for (auto it = evictable_.begin(); it != evictable_.end() && frame_ids->size() < count; ++it) {
+    frame_ids->push_back(std::get<2>(*it));
+  }
+}
+
+auto LRUKReplacer::Size() -> size_t {
+  std::scoped_lock guard(mtx_);
+  return evictable_.size();
+}
+
+}  // namespace bustub
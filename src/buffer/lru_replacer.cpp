@@ -11,81 +11,71 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/lru_replacer.h"
-#include "common/logger.h"
+
+#include "common/macros.h"
 
 namespace bustub {
 
-LRUReplacer::LRUReplacer(size_t num_pages) {
-  size_ = 0;
-  capacity_ = num_pages;
-  head_ = new ListNode();
-  tail_ = new ListNode();
-  head_->next_ = tail_;
-  tail_->prev_ = head_;
+LRUReplacer::LRUReplacer(size_t num_pages) : capacity_(num_pages) {
+  nodes_ = new ListNode[capacity_ + 1];
+  head_ = static_cast<frame_id_t>(capacity_);
+  nodes_[head_].prev_ = head_;
+  nodes_[head_].next_ = head_;
 }
 
-LRUReplacer::~LRUReplacer() {
-  // 释放整个链表的内存
-  ListNode *temp;
-  for (auto it = head_->next_; it != tail_; it = temp) {
-    temp = it->next_;
-    delete it;
-  }
-  delete head_;
-  delete tail_;
+LRUReplacer::~LRUReplacer() { delete[] nodes_; }
+
+void LRUReplacer::Unlink(frame_id_t frame_id) {
+  ListNode &node = nodes_[frame_id];
+  nodes_[node.prev_].next_ = node.next_;
+  nodes_[node.next_].prev_ = node.prev_;
+  node.in_list_ = false;
+}
+
+void LRUReplacer::AddTail(frame_id_t frame_id) {
+  ListNode &node = nodes_[frame_id];
+  node.prev_ = nodes_[head_].prev_;
+  node.next_ = head_;
+  nodes_[node.prev_].next_ = frame_id;
+  nodes_[head_].prev_ = frame_id;
+  node.in_list_ = true;
 }
 
 auto LRUReplacer::Victim(frame_id_t *frame_id) -> bool {
-  mtx_.lock();
+  std::scoped_lock guard(mtx_);
   if (size_ == 0) {
-    mtx_.unlock();
     return false;
   }
-  ListNode *tail_node = head_->next_;
-  *frame_id = tail_node->frame_id_;
-  tail_node->Remove();
-  delete tail_node;
+  *frame_id = nodes_[head_].next_;
+  Unlink(*frame_id);
   --size_;
-  hash_map_.erase(*frame_id);
-  mtx_.unlock();
   return true;
 }
 
 void LRUReplacer::Pin(frame_id_t frame_id) {
-  mtx_.lock();
-  if (hash_map_.find(frame_id) != hash_map_.end()) {
-    ListNode *object_node = hash_map_[frame_id];
-    object_node->Remove();
-    hash_map_.erase(frame_id);
-    delete object_node;
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < capacity_, "frame id out of range");
+  std::scoped_lock guard(mtx_);
+  if (nodes_[frame_id].in_list_) {
+    Unlink(frame_id);
     --size_;
   }
-  mtx_.unlock();
-}
-
-void LRUReplacer::AddTail(ListNode *new_node) {
-  (tail_->prev_)->next_ = new_node;
-  new_node->prev_ = tail_->prev_;
-  new_node->next_ = tail_;
-  tail_->prev_ = new_node;
 }
 
 void LRUReplacer::Unpin(frame_id_t frame_id) {
-  mtx_.lock();
-  if (hash_map_.find(frame_id) == hash_map_.end()) {
-    while (size_ >= capacity_) {
-      ListNode *object_node = head_->next_;
-      object_node->Remove();
-      hash_map_.erase(object_node->frame_id_);
-      delete object_node;
-      --size_;
-    }
-    auto *new_node = new ListNode(frame_id);
-    AddTail(new_node);
-    hash_map_[frame_id] = new_node;
+  BUSTUB_ASSERT(static_cast<size_t>(frame_id) < capacity_, "frame id out of range");
+  std::scoped_lock guard(mtx_);
+  if (!nodes_[frame_id].in_list_) {
+    AddTail(frame_id);
     ++size_;
   }
-  mtx_.unlock();
+}
+
+void LRUReplacer::PeekVictims(size_t count, std::vector<frame_id_t> *frame_ids) {
+  std::scoped_lock guard(mtx_);
+  for (frame_id_t frame_id = nodes_[head_].next_; frame_id != head_ && frame_ids->size() < count;
+       frame_id = nodes_[frame_id].next_) {
+    frame_ids->push_back(frame_id);
+  }
 }
 
 auto LRUReplacer::Size() -> size_t { return size_; }
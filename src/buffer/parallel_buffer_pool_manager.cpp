@@ -11,131 +11,165 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/parallel_buffer_pool_manager.h"
+
+#include <thread>  // NOLINT
+#include <vector>
+
 #include "common/logger.h"
+#include "common/util/numa_util.h"
 
 namespace bustub {
 
 ParallelBufferPoolManager::ParallelBufferPoolManager(size_t num_instances, size_t pool_size, DiskManager *disk_manager,
-                                                     LogManager *log_manager) {
-  // Allocate and create individual BufferPoolManagerInstance
-  num_instances_ = num_instances;
-  pool_size_ = pool_size;
-  disk_manager_ = disk_manager;
-  log_manager_ = log_manager;
+                                                     LogManager *log_manager)
+    : num_instances_(num_instances), pool_size_(pool_size), disk_manager_(disk_manager), log_manager_(log_manager) {
+  // Allocate and create individual BufferPoolManagerInstances up front, so that routing a request never has to latch.
+  // With NUMA binding, instance i lives on node i % NumNodes().
+  int num_nodes = enable_numa_binding ? NumaUtil::NumNodes() : 0;
+  node_instances_.resize(num_nodes);
   buffer_pools_ = new BufferPoolManagerInstance *[num_instances];
-  allocated_ = new bool[num_instances];
-  for (int i = 0; i < static_cast<int>(num_instances); ++i) {
-    allocated_[i] = false;
+  for (uint32_t i = 0; i < num_instances_; ++i) {
+    int node = num_nodes > 0 ? static_cast<int>(i % num_nodes) : -1;
+    buffer_pools_[i] = new BufferPoolManagerInstance(pool_size_, num_instances_, i, disk_manager_, log_manager_,
+                                                     ReplacerType::LRU, node);
+    if (node >= 0) {
+      node_instances_[node].push_back(i);
+    }
   }
-  start_index_ = 0;
 }
 
-// Update constructor to destruct all BufferPoolManagerInstances and deallocate any associated memory
 ParallelBufferPoolManager::~ParallelBufferPoolManager() {
-  for (int i = 0; i < static_cast<int>(num_instances_); ++i) {
-    if (allocated_[i]) {
-      delete buffer_pools_[i];
-    }
+  for (uint32_t i = 0; i < num_instances_; ++i) {
+    delete buffer_pools_[i];
   }
   delete[] buffer_pools_;
-  delete[] allocated_;
 }
 
 auto ParallelBufferPoolManager::GetPoolSize() -> size_t {
   // Get size of all BufferPoolManagerInstances
-  return num_instances_ * pool_size_;
+  size_t pool_size = 0;
+  for (uint32_t i = 0; i < num_instances_; ++i) {
+    pool_size += buffer_pools_[i]->GetPoolSize();
+  }
+  return pool_size;
+}
+
+auto ParallelBufferPoolManager::ResizePool(size_t pool_size) -> bool {
+  if (pool_size % num_instances_ != 0 || pool_size / num_instances_ == 0 ||
+      pool_size / num_instances_ > buffer_pools_[0]->GetMaxPoolSize()) {
+    return false;
+  }
+  // Pages kept pinned through the budget, e.g. swizzled by B+ trees, would pin the retired frames for good.
+  GetLongPinBudget()->Reclaim([this, pool_size](const Page *page) {
+    for (uint32_t i = 0; i < num_instances_; ++i) {
+      if (buffer_pools_[i]->IsFrameBeyond(page, pool_size / num_instances_)) {
+        return true;
+      }
+    }
+    return false;
+  });
+  bool vacated = true;
+  for (uint32_t i = 0; i < num_instances_; ++i) {
+    vacated = buffer_pools_[i]->ResizePool(pool_size / num_instances_) && vacated;
+  }
+  return vacated;
 }
 
 auto ParallelBufferPoolManager::GetBufferPoolManager(page_id_t page_id) -> BufferPoolManagerInstance * {
-  // Get BufferPoolManager responsible for handling given page id. You can use this method in your other methods.
-  auto index = buffer_pool_table_[page_id % num_instances_];
-  if (!allocated_[index]) {
-    allocated_[index] = true;
-    buffer_pools_[index] = new BufferPoolManagerInstance(pool_size_, disk_manager_, log_manager_);
+  // Every instance allocates the page ids that are congruent to its index.
+  return buffer_pools_[static_cast<uint32_t>(page_id) % num_instances_];
+}
+
+void ParallelBufferPoolManager::StartPageCleaner() {
+  for (uint32_t i = 0; i < num_instances_; ++i) {
+    buffer_pools_[i]->StartPageCleaner();
+  }
+}
+
+void ParallelBufferPoolManager::StopPageCleaner() {
+  for (uint32_t i = 0; i < num_instances_; ++i) {
+    buffer_pools_[i]->StopPageCleaner();
   }
-  return buffer_pools_[index];
 }
 
-auto ParallelBufferPoolManager::FetchPgImp(page_id_t page_id) -> Page * {
-  latch_.lock();
-  // Fetch page for page_id from responsible BufferPoolManagerInstance
-  BufferPoolManagerInstance *buffer_pool = GetBufferPoolManager(page_id);
-  latch_.unlock();
-  return buffer_pool->FetchPgImp(page_id);
+auto ParallelBufferPoolManager::GetNodeStats(int node) -> BufferPoolStats {
+  BufferPoolStats stats;
+  if (node < 0 || node >= static_cast<int>(node_instances_.size())) {
+    return stats;
+  }
+  for (uint32_t i : node_instances_[node]) {
+    BufferPoolStats instance_stats = buffer_pools_[i]->GetStats();
+    stats.hits_ += instance_stats.hits_;
+    stats.misses_ += instance_stats.misses_;
+    stats.remote_accesses_ += instance_stats.remote_accesses_;
+  }
+  return stats;
+}
+
+auto ParallelBufferPoolManager::FetchPgImp(page_id_t page_id, AccessType access_type) -> Page * {
+  return GetBufferPoolManager(page_id)->FetchPgImp(page_id, access_type);
 }
 
 auto ParallelBufferPoolManager::UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool {
-  latch_.lock();
-  // Unpin page_id from responsible BufferPoolManagerInstance
-  BufferPoolManagerInstance *buffer_pool = GetBufferPoolManager(page_id);
-  latch_.unlock();
-  return buffer_pool->UnpinPgImp(page_id, is_dirty);
+  return GetBufferPoolManager(page_id)->UnpinPgImp(page_id, is_dirty);
 }
 
 auto ParallelBufferPoolManager::FlushPgImp(page_id_t page_id) -> bool {
-  // Flush page_id from responsible BufferPoolManagerInstance
-  latch_.lock();
-  BufferPoolManagerInstance *buffer_pool = GetBufferPoolManager(page_id);
-  latch_.unlock();
-  return buffer_pool->FlushPgImp(page_id);
+  return GetBufferPoolManager(page_id)->FlushPgImp(page_id);
 }
 
 auto ParallelBufferPoolManager::NewPgImp(page_id_t *page_id) -> Page * {
-  // create new page. We will request page allocation in a round robin manner from the underlying
-  // BufferPoolManagerInstances
-  // 1.   From a starting index of the BPMIs, call NewPageImpl until either 1) success and return 2) looped around to
-  // starting index and return nullptr
-  // 2.   Bump the starting index (mod number of instances) to start search at a different BPMI each time this function
-  // is called
-  latch_.lock();
-  auto x = start_index_;
-  Page *result = nullptr;
-  do {
-    BufferPoolManagerInstance *&buffer_pool = buffer_pools_[x];
-    if (!allocated_[x]) {
-      allocated_[x] = true;
-      buffer_pool = new BufferPoolManagerInstance(pool_size_, disk_manager_, log_manager_);
-    }
-    result = buffer_pool->NewPgImp(page_id);
-    if (result == nullptr) {
-      ++x;
-      if (x == num_instances_) {
-        x = 0;
+  // Create new pages round robin across the BufferPoolManagerInstances. Every call starts at the next instance, and
+  // moves on past the instances that are full, until it has tried them all.
+  const uint32_t cursor = next_instance_.fetch_add(1, std::memory_order_relaxed);
+  if (!node_instances_.empty()) {
+    // Node-local instances first, so that the new page is created in memory close to the thread that fills it.
+    const auto &local = node_instances_[NumaUtil::CurrentNode() % node_instances_.size()];
+    for (size_t i = 0; i < local.size(); ++i) {
+      BufferPoolManagerInstance *buffer_pool = buffer_pools_[local[(cursor + i) % local.size()]];
+      if (buffer_pool->IsFull()) {
+        continue;
       }
-    } else {
-      start_index_++;
-      if (start_index_ == num_instances_) {
-        start_index_ = 0;
+      Page *page = buffer_pool->NewPgImp(page_id);
+      if (page != nullptr) {
+        return page;
       }
-      latch_.unlock();
-      return result;
     }
-  } while (x != start_index_);
-  start_index_++;
-  if (start_index_ == num_instances_) {
-    start_index_ = 0;
   }
-  latch_.unlock();
-  return result;
+  const uint32_t start = cursor % num_instances_;
+  for (uint32_t i = 0; i < num_instances_; ++i) {
+    BufferPoolManagerInstance *buffer_pool = buffer_pools_[(start + i) % num_instances_];
+    if (buffer_pool->IsFull()) {
+      continue;
+    }
+    Page *page = buffer_pool->NewPgImp(page_id);
+    if (page != nullptr) {
+      return page;
+    }
+  }
+  return nullptr;
 }
 
 auto ParallelBufferPoolManager::DeletePgImp(page_id_t page_id) -> bool {
-  // Delete page_id from responsible BufferPoolManagerInstance
-  latch_.lock();
-  BufferPoolManagerInstance *buffer_pool = GetBufferPoolManager(page_id);
-  latch_.unlock();
-  return buffer_pool->DeletePgImp(page_id);
+  return GetBufferPoolManager(page_id)->DeletePgImp(page_id);
+}
+
+void ParallelBufferPoolManager::PrefetchPgImp(page_id_t page_id, size_t count, next_page_fn next_page,
+                                              AccessType access_type) {
+  GetBufferPoolManager(page_id)->PrefetchPgImp(page_id, count, next_page, access_type);
 }
 
 void ParallelBufferPoolManager::FlushAllPgsImp() {
-  // flush all pages from all BufferPoolManagerInstances
-  latch_.lock();
-  for (int i = 0; i < static_cast<int>(num_instances_); ++i) {
-    if (buffer_pools_[i] != nullptr) {
-      buffer_pools_[i]->FlushAllPgsImp();
-    }
+  // Write back the dirty pages of all BufferPoolManagerInstances in parallel, then sync the database once.
+  std::vector<std::thread> writers;
+  for (uint32_t i = 1; i < num_instances_; ++i) {
+    writers.emplace_back(&BufferPoolManagerInstance::WriteDirtyPages, buffer_pools_[i]);
+  }
+  buffer_pools_[0]->WriteDirtyPages();
+  for (auto &writer : writers) {
+    writer.join();
   }
-  latch_.unlock();
+  disk_manager_->SyncPages();
 }
 
 }  // namespace bustub
@@ -18,6 +18,20 @@ std::atomic<bool> enable_logging(false);
 
 std::chrono::duration<int64_t> log_timeout = std::chrono::seconds(1);
 
+std::chrono::milliseconds page_cleaner_interval = std::chrono::milliseconds(10);
+
+size_t page_cleaner_max_writes = 32;
+
+size_t page_cleaner_clean_target = 16;
+
+bool enable_io_uring = true;
+
+bool enable_direct_io = false;
+
+bool enable_huge_pages = false;
+
+bool enable_numa_binding = false;
+
 std::chrono::milliseconds cycle_detection_interval = std::chrono::milliseconds(50);
 
 }  // namespace bustub
@@ -0,0 +1,79 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// numa_util.cpp
+//
+// Identification: src/common/util/numa_util.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/numa_util.h"
+
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#if defined(__linux__) && defined(SYS_mbind)
+#include <linux/mempolicy.h>
+#define BUSTUB_HAVE_MBIND 1
+#endif
+
+namespace bustub {
+
+auto NumaUtil::NumNodes() -> int {
+  static const int num_nodes = [] {
+    // The online nodes are listed as ranges, e.g. "0-1,3"; the last number is the highest node.
+    std::ifstream online("/sys/devices/system/node/online");
+    std::string nodes;
+    if (!std::getline(online, nodes) || nodes.empty()) {
+      return 1;
+    }
+    size_t last = nodes.find_last_of(",-");
+    return std::stoi(last == std::string::npos ? nodes : nodes.substr(last + 1)) + 1;
+  }();
+  return num_nodes;
+}
+
+auto NumaUtil::CurrentNode() -> int {
+  unsigned int cpu;
+  unsigned int node;
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 29))
+  // glibc answers this from the vDSO, without entering the kernel.
+  if (getcpu(&cpu, &node) != 0) {
+    return 0;
+  }
+#elif defined(SYS_getcpu)
+  if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0) {
+    return 0;
+  }
+#else
+  node = 0;
+#endif
+  return static_cast<int>(node);
+}
+
+auto NumaUtil::BindMemory(void *addr, size_t len, int node) -> bool {
+#ifdef BUSTUB_HAVE_MBIND
+  if (node < 0) {
+    return false;
+  }
+  // The kernel takes the node mask as an array of unsigned long.
+  using mask_word_t = unsigned long;  // NOLINT
+  const int bits = 8 * sizeof(mask_word_t);
+  std::vector<mask_word_t> node_mask(node / bits + 1);
+  node_mask[node / bits] |= mask_word_t{1} << (node % bits);
+  // The kernel reads one bit less than maxnode.
+  const mask_word_t max_node = node_mask.size() * bits + 1;
+  return syscall(SYS_mbind, addr, len, MPOL_BIND, node_mask.data(), max_node, 0) == 0;
+#else
+  return false;
+#endif
+}
+
+}  // namespace bustub
@@ -26,20 +26,19 @@ template <typename KeyType, typename ValueType, typename KeyComparator>
 HASH_TABLE_TYPE::ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
                                      const KeyComparator &comparator, HashFunction<KeyType> hash_fn)
     : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {
-  auto directory_page = reinterpret_cast<HashTableDirectoryPage *>(
-      buffer_pool_manager_->NewPage(&directory_page_id_, nullptr)->GetData());
+  BasicPageGuard directory_guard = buffer_pool_manager_->NewPageGuarded(&directory_page_id_);
+  auto directory_page = directory_guard.AsMut<HashTableDirectoryPage>();
   directory_page->IncrGlobalDepth();
   page_id_t bucket_page_id_1 = INVALID_PAGE_ID;
   page_id_t bucket_page_id_2 = INVALID_PAGE_ID;
-  buffer_pool_manager_->NewPage(&bucket_page_id_1, nullptr);
-  buffer_pool_manager_->NewPage(&bucket_page_id_2, nullptr);
+  BasicPageGuard bucket_guard_1 = buffer_pool_manager_->NewPageGuarded(&bucket_page_id_1);
+  BasicPageGuard bucket_guard_2 = buffer_pool_manager_->NewPageGuarded(&bucket_page_id_2);
+  bucket_guard_1.AsMut<HASH_TABLE_BUCKET_TYPE>()->Clear();
+  bucket_guard_2.AsMut<HASH_TABLE_BUCKET_TYPE>()->Clear();
   directory_page->SetLocalDepth(0, 1);
   directory_page->SetLocalDepth(1, 1);
   directory_page->SetBucketPageId(0, bucket_page_id_1);
   directory_page->SetBucketPageId(1, bucket_page_id_2);
-  buffer_pool_manager_->UnpinPage(bucket_page_id_1, true);
-  buffer_pool_manager_->UnpinPage(bucket_page_id_2, true);
-  buffer_pool_manager_->UnpinPage(directory_page_id_, true);
 }
 
 /*****************************************************************************
@@ -58,7 +57,7 @@ auto HASH_TABLE_TYPE::Hash(KeyType key) -> uint32_t {
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-inline auto HASH_TABLE_TYPE::KeyToDirectoryIndex(KeyType key, HashTableDirectoryPage *dir_page) -> uint32_t {
+inline auto HASH_TABLE_TYPE::KeyToDirectoryIndex(KeyType key, const HashTableDirectoryPage *dir_page) -> uint32_t {
   auto global_mask = dir_page->GetGlobalDepthMask();
   auto hash_val = Hash(key);
   auto hash_key = (hash_val & global_mask);
@@ -67,7 +66,7 @@ inline auto HASH_TABLE_TYPE::KeyToDirectoryIndex(KeyType key, HashTableDirectory
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-inline auto HASH_TABLE_TYPE::KeyToPageId(KeyType key, HashTableDirectoryPage *dir_page) -> uint32_t {
+inline auto HASH_TABLE_TYPE::KeyToPageId(KeyType key, const HashTableDirectoryPage *dir_page) -> uint32_t {
   auto directory_index = KeyToDirectoryIndex(key, dir_page);
 
   return dir_page->GetBucketPageId(directory_index);
@@ -75,33 +74,25 @@ inline auto HASH_TABLE_TYPE::KeyToPageId(KeyType key, HashTableDirectoryPage *di
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::FetchDirectoryPage() -> HashTableDirectoryPage * {
-  auto directory_page = reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->FetchPage(directory_page_id_));
+  auto directory_page =
+      reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->FetchPage(directory_page_id_)->GetData());
 
   return directory_page;
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
-auto HASH_TABLE_TYPE::FetchBucketPage(page_id_t bucket_page_id) -> HASH_TABLE_BUCKET_TYPE * {
-  auto bucket_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(buffer_pool_manager_->FetchPage(bucket_page_id));
-
-  return bucket_page;
-}
-
 /*****************************************************************************
  * SEARCH
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) -> bool {
   table_latch_.RLock();
-  auto directory_page = FetchDirectoryPage();
-  auto bucket_page_id = KeyToPageId(key, directory_page);
-  auto bucket_page = FetchBucketPage(bucket_page_id);
-  AddBucketLatch(bucket_page, 'R');
-  bool flag = bucket_page->GetValue(key, comparator_, result);
-  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-  buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+  ReadPageGuard directory_guard = buffer_pool_manager_->FetchPageRead(directory_page_id_);
+  auto bucket_page_id = KeyToPageId(key, directory_guard.As<HashTableDirectoryPage>());
+  ReadPageGuard bucket_guard = buffer_pool_manager_->FetchPageRead(bucket_page_id);
+  directory_guard.Drop();
+  bool flag = bucket_guard.As<HASH_TABLE_BUCKET_TYPE>()->GetValue(key, comparator_, result);
+  bucket_guard.Drop();
   table_latch_.RUnlock();
-  RemoveBucketLatch(bucket_page, 'R');
 
   return flag;
 }
@@ -112,111 +103,88 @@ auto HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
   table_latch_.WLock();
-  auto directory_page = FetchDirectoryPage();
-  AddDirectoryLatch(directory_page, 'R');
-  auto bucket_page_id = KeyToPageId(key, directory_page);
-  auto bucket_page = FetchBucketPage(bucket_page_id);
-  RemoveDirectoryLatch(directory_page, 'R');
+  bool flag = SplitInsert(transaction, key, value);
+  table_latch_.WUnlock();
+
+  return flag;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
+  WritePageGuard directory_guard = buffer_pool_manager_->FetchPageWrite(directory_page_id_);
+  auto directory_index = KeyToDirectoryIndex(key, directory_guard.As<HashTableDirectoryPage>());
+  auto bucket_page_id = directory_guard.As<HashTableDirectoryPage>()->GetBucketPageId(directory_index);
+  WritePageGuard bucket_guard = buffer_pool_manager_->FetchPageWrite(bucket_page_id);
   // 如果要插入的bucketpage中已经有完全相同的key-value了，不插入
-  AddBucketLatch(bucket_page, 'R');
-  if (bucket_page->FindElement(key, value, comparator_)) {
-    RemoveBucketLatch(bucket_page, 'R');
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-    table_latch_.WUnlock();
+  if (bucket_guard.As<HASH_TABLE_BUCKET_TYPE>()->FindElement(key, value, comparator_)) {
     return false;
   }
-  RemoveBucketLatch(bucket_page, 'R');
-  AddDirectoryLatch(directory_page, 'W');
-  AddBucketLatch(bucket_page, 'W');
-  auto directory_index = KeyToDirectoryIndex(key, directory_page);
-  auto limit_size = (1 << ((directory_page->GetLocalDepth(directory_index)) - 1));
-  if (limit_size == static_cast<int>(bucket_page->GetSize())) {
-    // 如果满了，要进行分裂
-
-    // 先尝试对directory合并
-
-    auto last_local_depth = directory_page->GetLocalDepth(directory_index);
-    auto new_bucket_page_id =
-        SplitBucketPage(bucket_page, directory_page, bucket_page_id, KeyToDirectoryIndex(key, directory_page));
-    if (directory_page->GetGlobalDepth() == last_local_depth) {
-      directory_page->IncrGlobalDepth();
-      UpdateDirectoryPage(directory_page, bucket_page_id, new_bucket_page_id);
-    } else {
-      UpdateLittleDirectoryPage(directory_page, bucket_page_id, new_bucket_page_id, last_local_depth + 1);
-    }
-    auto another_bucket_page_id = KeyToPageId(key, directory_page);
-    if (another_bucket_page_id != bucket_page_id) {
-      auto another_bucket_page = FetchBucketPage(another_bucket_page_id);
-      AddBucketLatch(another_bucket_page, 'W');
-      another_bucket_page->Insert(key, value, comparator_);
-      buffer_pool_manager_->UnpinPage(another_bucket_page_id, true);
-      RemoveBucketLatch(another_bucket_page, 'W');
-    } else {
-      bucket_page->Insert(key, value, comparator_);
-    }
-    buffer_pool_manager_->UnpinPage(directory_page_id_, true);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, true);
+  auto bucket_page = bucket_guard.AsMut<HASH_TABLE_BUCKET_TYPE>();
+  auto last_local_depth = directory_guard.As<HashTableDirectoryPage>()->GetLocalDepth(directory_index);
+  auto limit_size = (1 << (last_local_depth - 1));
+  if (limit_size != static_cast<int>(bucket_page->GetSize())) {
+    bucket_page->Insert(key, value, comparator_);
+    return true;
+  }
+  // 如果满了，要进行分裂
+  auto directory_page = directory_guard.AsMut<HashTableDirectoryPage>();
+  auto new_bucket_page_id = SplitBucketPage(bucket_page, directory_page, bucket_page_id, directory_index);
+  if (directory_page->GetGlobalDepth() == last_local_depth) {
+    directory_page->IncrGlobalDepth();
+    UpdateDirectoryPage(directory_page, bucket_page_id, new_bucket_page_id);
+  } else {
+    UpdateLittleDirectoryPage(directory_page, bucket_page_id, new_bucket_page_id, last_local_depth + 1);
+  }
+  auto another_bucket_page_id = static_cast<page_id_t>(KeyToPageId(key, directory_page));
+  if (another_bucket_page_id != bucket_page_id) {
+    WritePageGuard another_bucket_guard = buffer_pool_manager_->FetchPageWrite(another_bucket_page_id);
+    another_bucket_guard.AsMut<HASH_TABLE_BUCKET_TYPE>()->Insert(key, value, comparator_);
   } else {
     bucket_page->Insert(key, value, comparator_);
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, true);
   }
-  RemoveBucketLatch(bucket_page, 'W');
-  RemoveDirectoryLatch(directory_page, 'W');
-  table_latch_.WUnlock();
 
   return true;
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
-auto HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
-  return false;
-}
-
 /*****************************************************************************
  * REMOVE
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
   table_latch_.WLock();
-  auto directory_page = FetchDirectoryPage();
-  AddDirectoryLatch(directory_page, 'W');
-  auto bucket_page_id = KeyToPageId(key, directory_page);
-  auto bucket_page = FetchBucketPage(bucket_page_id);
-  auto directory_index = KeyToDirectoryIndex(key, directory_page);
-  auto local_depth = directory_page->GetLocalDepth(directory_index);
+  bool flag = MergeRemove(transaction, key, value);
+  table_latch_.WUnlock();
+
+  return flag;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::MergeRemove(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
+  WritePageGuard directory_guard = buffer_pool_manager_->FetchPageWrite(directory_page_id_);
+  auto directory_index = KeyToDirectoryIndex(key, directory_guard.As<HashTableDirectoryPage>());
+  auto bucket_page_id = directory_guard.As<HashTableDirectoryPage>()->GetBucketPageId(directory_index);
+  auto local_depth = directory_guard.As<HashTableDirectoryPage>()->GetLocalDepth(directory_index);
+  WritePageGuard bucket_guard = buffer_pool_manager_->FetchPageWrite(bucket_page_id);
   page_id_t another_bucket_page_id = 0;
-  AddBucketLatch(bucket_page, 'W');
-  if (!bucket_page->FindElement(key, value, comparator_) &&
-      (!bucket_page->IsEmpty() || !CheckMerge(directory_page, directory_index, local_depth, &another_bucket_page_id))) {
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-    table_latch_.WUnlock();
-    RemoveDirectoryLatch(directory_page, 'W');
-    RemoveBucketLatch(bucket_page, 'W');
+  if (!bucket_guard.As<HASH_TABLE_BUCKET_TYPE>()->FindElement(key, value, comparator_) &&
+      (!bucket_guard.As<HASH_TABLE_BUCKET_TYPE>()->IsEmpty() ||
+       !CheckMerge(directory_guard.As<HashTableDirectoryPage>(), directory_index, local_depth,
+                   &another_bucket_page_id))) {
     return false;
   }
+  auto bucket_page = bucket_guard.AsMut<HASH_TABLE_BUCKET_TYPE>();
   bucket_page->Remove(key, value, comparator_);
-  if (!bucket_page->IsEmpty() || !CheckMerge(directory_page, directory_index, local_depth, &another_bucket_page_id)) {
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, true);
-    table_latch_.WUnlock();
-    RemoveDirectoryLatch(directory_page, 'W');
-    RemoveBucketLatch(bucket_page, 'W');
+  if (!bucket_page->IsEmpty() || !CheckMerge(directory_guard.As<HashTableDirectoryPage>(), directory_index,
+                                             local_depth, &another_bucket_page_id)) {
     return true;
   }
   // try to merge
-  Merge(nullptr, directory_page, bucket_page_id, another_bucket_page_id);
+  auto directory_page = directory_guard.AsMut<HashTableDirectoryPage>();
+  Merge(transaction, directory_page, bucket_page_id, another_bucket_page_id);
   if (CheckUpdateGlobalDepth(directory_page)) {
     // update global depth
     directory_page->DecrGlobalDepth();
   }
-  buffer_pool_manager_->UnpinPage(directory_page_id_, true);
-  buffer_pool_manager_->UnpinPage(bucket_page_id, true);
-  table_latch_.WUnlock();
-  RemoveDirectoryLatch(directory_page, 'W');
-  RemoveBucketLatch(bucket_page, 'W');
 
   return true;
 }
@@ -291,9 +259,8 @@ auto ExtendibleHashTable<KeyType, ValueType, KeyComparator>::SplitBucketPage(
   auto local_depth = directory_page->GetLocalDepth(bucket_index);
   local_depth++;
   page_id_t new_bucket_page_id = INVALID_PAGE_ID;
-  auto new_bucket_page = reinterpret_cast<HashTableBucketPage<KeyType, ValueType, KeyComparator> *>(
-      buffer_pool_manager_->NewPage(&new_bucket_page_id, nullptr)->GetData());
-  AddBucketLatch(new_bucket_page, 'W');
+  BasicPageGuard new_bucket_guard = buffer_pool_manager_->NewPageGuarded(&new_bucket_page_id);
+  auto new_bucket_page = new_bucket_guard.AsMut<HASH_TABLE_BUCKET_TYPE>();
   new_bucket_page->Clear();
   std::vector<MappingType> elements;
   bucket_page->GetAllPairs(&elements);
@@ -308,14 +275,12 @@ auto ExtendibleHashTable<KeyType, ValueType, KeyComparator>::SplitBucketPage(
       bucket_page->Insert(it.first, it.second, comparator_);
     }
   }
-  buffer_pool_manager_->UnpinPage(new_bucket_page_id, true);
-  RemoveBucketLatch(new_bucket_page, 'W');
 
   return new_bucket_page_id;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-bool ExtendibleHashTable<KeyType, ValueType, KeyComparator>::CheckMerge(HashTableDirectoryPage *directory_page,
+bool ExtendibleHashTable<KeyType, ValueType, KeyComparator>::CheckMerge(const HashTableDirectoryPage *directory_page,
                                                                         uint32_t pid, uint32_t local_depth,
                                                                         page_id_t *pInt) {
   auto global_depth = directory_page->GetGlobalDepth();
@@ -329,13 +294,9 @@ bool ExtendibleHashTable<KeyType, ValueType, KeyComparator>::CheckMerge(HashTabl
     return false;
   }
   *pInt = bucket_page_id;
-  auto bucket_page = FetchBucketPage(bucket_page_id);
-  AddBucketLatch(bucket_page, 'R');
-  bool flag = bucket_page->IsEmpty();
-  buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-  RemoveBucketLatch(bucket_page, 'R');
+  ReadPageGuard bucket_guard = buffer_pool_manager_->FetchPageRead(bucket_page_id);
 
-  return flag;
+  return bucket_guard.As<HASH_TABLE_BUCKET_TYPE>()->IsEmpty();
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
@@ -352,7 +313,6 @@ void ExtendibleHashTable<KeyType, ValueType, KeyComparator>::Merge(Transaction *
       directory_page->SetBucketPageId(i, id0);
     }
   }
-  buffer_pool_manager_->UnpinPage(id1, true);
   buffer_pool_manager_->DeletePage(id1);
 }
 
@@ -369,46 +329,6 @@ bool ExtendibleHashTable<KeyType, ValueType, KeyComparator>::CheckUpdateGlobalDe
   return true;
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
-void ExtendibleHashTable<KeyType, ValueType, KeyComparator>::AddDirectoryLatch(HashTableDirectoryPage *directory_page,
-                                                                               char ch) {
-  if (ch == 'R') {
-    reinterpret_cast<Page *>(directory_page)->RLatch();
-  } else {
-    reinterpret_cast<Page *>(directory_page)->WLatch();
-  }
-}
-
-template <typename KeyType, typename ValueType, typename KeyComparator>
-void ExtendibleHashTable<KeyType, ValueType, KeyComparator>::RemoveDirectoryLatch(
-    HashTableDirectoryPage *directory_page, char ch) {
-  if (ch == 'R') {
-    reinterpret_cast<Page *>(directory_page)->RUnlatch();
-  } else {
-    reinterpret_cast<Page *>(directory_page)->WUnlatch();
-  }
-}
-
-template <typename KeyType, typename ValueType, typename KeyComparator>
-void ExtendibleHashTable<KeyType, ValueType, KeyComparator>::AddBucketLatch(
-    HashTableBucketPage<KeyType, ValueType, KeyComparator> *bucket_page, char ch) {
-  if (ch == 'R') {
-    reinterpret_cast<Page *>(bucket_page)->RLatch();
-  } else {
-    reinterpret_cast<Page *>(bucket_page)->WLatch();
-  }
-}
-
-template <typename KeyType, typename ValueType, typename KeyComparator>
-void ExtendibleHashTable<KeyType, ValueType, KeyComparator>::RemoveBucketLatch(
-    HashTableBucketPage<KeyType, ValueType, KeyComparator> *bucket_page, char ch) {
-  if (ch == 'R') {
-    reinterpret_cast<Page *>(bucket_page)->RUnlatch();
-  } else {
-    reinterpret_cast<Page *>(bucket_page)->WUnlatch();
-  }
-}
-
 /*****************************************************************************
  * TEMPLATE DEFINITIONS - DO NOT TOUCH
  *****************************************************************************/
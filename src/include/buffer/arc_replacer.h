@@ -0,0 +1,126 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// arc_replacer.h
+//
+// Identification: src/include/buffer/arc_replacer.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <list>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * ARCReplacer implements the Adaptive Replacement Cache policy (Megiddo and Modha, FAST '03).
+ *
+ * Resident pages are split into T1 (seen once recently) and T2 (seen at least twice). The ghost lists B1 and B2 keep
+ * the ids of pages recently evicted from T1 and T2. A miss on a B1 ghost means T1 was too small and grows its target
+ * size; a miss on a B2 ghost shrinks it. A one-pass scan therefore only cycles through T1 while the pages that are
+ * referenced again stay in T2, and a workload of short-lived recency gets all of the pool for T1.
+ *
+ * Victims are chosen among the evictable frames of each list in unpin order.
+ */
+class ARCReplacer : public Replacer {
+ public:
+  /**
+   * Create a new ARCReplacer.
+   * @param num_frames the number of frames in the buffer pool, which is also the number of ghosts remembered until
+   * SetPoolSize() says otherwise
+   */
+  explicit ARCReplacer(size_t num_frames);
+
+  /**
+   * Destroys the ARCReplacer.
+   */
+  ~ARCReplacer() override;
+
+  auto Victim(frame_id_t *frame_id) -> bool override;
+
+  void Pin(frame_id_t frame_id) override;
+
+  /**
+   * Makes a frame evictable. A frame without any recorded access is put into T1 until its first access.
+   * @param frame_id the id of the frame to unpin
+   */
+  void Unpin(frame_id_t frame_id) override;
+
+  void RecordAccess(frame_id_t frame_id, page_id_t page_id) override;
+
+  void Remove(frame_id_t frame_id) override;
+
+  void PeekVictims(size_t count, std::vector<frame_id_t> *frame_ids) override;
+
+  /**
+   * Sets the cache size c that bounds the target size of T1 and the ghost lists. Ghosts in excess are dropped.
+   * @param pool_size the number of frames in use
+   */
+  void SetPoolSize(size_t pool_size) override;
+
+  auto Size() -> size_t override;
+
+  /** @return the current target size of T1 */
+  auto GetTargetRecencySize() -> size_t;
+
+ private:
+  enum class ArcList { NONE, T1, T2, B1, B2 };
+
+  struct FrameRecord {
+    page_id_t page_id_{INVALID_PAGE_ID};
+    /** NONE, T1 or T2. */
+    ArcList list_{ArcList::NONE};
+    /** False while the page has been loaded (and unpinned) but not accessed yet. */
+    bool referenced_{false};
+    bool evictable_{false};
+    /** Position in t1_evictable_ or t2_evictable_ while evictable_ is set. */
+    std::list<frame_id_t>::iterator pos_;
+  };
+
+  struct Ghost {
+    /** B1 or B2. */
+    ArcList list_;
+    std::list<page_id_t>::iterator pos_;
+  };
+
+  /** Drops the least recent ghosts until the ARC directory invariants hold. */
+  void TrimGhosts();
+
+  /** Drops the least recent ghost of B1 or B2. */
+  void DropGhost(std::list<page_id_t> *ghosts);
+
+  auto EvictableList(ArcList list) -> std::list<frame_id_t> & {
+    return list == ArcList::T1 ? t1_evictable_ : t2_evictable_;
+  }
+
+  const size_t num_frames_;
+  /** The cache size c of ARC, at most num_frames_. */
+  size_t cache_size_;
+  /** Target size of T1. */
+  size_t target_t1_{0};
+  /** Number of resident frames in T1 and T2, evictable or not. */
+  size_t t1_size_{0};
+  size_t t2_size_{0};
+  /** Array of frame records, indexed by frame id. */
+  FrameRecord *records_;
+  /** Evictable frames of T1 and T2, least recently unpinned first. */
+  std::list<frame_id_t> t1_evictable_;
+  std::list<frame_id_t> t2_evictable_;
+  /** Ghost lists, least recently evicted first. */
+  std::list<page_id_t> b1_;
+  std::list<page_id_t> b2_;
+  std::unordered_map<page_id_t, Ghost> ghost_index_;
+  std::mutex mtx_;
+};
+
+}  // namespace bustub
@@ -12,11 +12,21 @@
 
 #pragma once
 
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
 #include <list>
 #include <mutex>  // NOLINT
+#include <thread>  // NOLINT
 #include <unordered_map>
+#include <vector>
 
 #include "buffer/buffer_pool_manager.h"
+#include "buffer/arc_replacer.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
 #include "buffer/lru_replacer.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
@@ -24,6 +34,16 @@
 
 namespace bustub {
 
+/** Counters of the page requests served by a buffer pool. */
+struct BufferPoolStats {
+  /** Fetches of pages that were resident. */
+  uint64_t hits_{0};
+  /** Fetches that had to read the page from disk. */
+  uint64_t misses_{0};
+  /** Fetches by threads running on another NUMA node than the one the frames are bound to. */
+  uint64_t remote_accesses_{0};
+};
+
 /**
  * BufferPoolManager reads disk pages to and from its internal buffer pool.
  */
@@ -32,12 +52,15 @@ class BufferPoolManagerInstance : public BufferPoolManager {
 
  public:
   /**
-   * Creates a new BufferPoolManagerInstance.
+   * Creates a new BufferPoolManagerInstance. Room for BUFFER_POOL_MAX_GROWTH times pool_size frames is reserved, so
+   * that the pool can be grown with ResizePool() later on.
    * @param pool_size the size of the buffer pool
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy used to pick victim frames
    */
-  BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr);
+  BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                            ReplacerType replacer_type = ReplacerType::LRU);
   /**
    * Creates a new BufferPoolManagerInstance.
    * @param pool_size the size of the buffer pool
@@ -45,9 +68,12 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    * @param instance_index index of this BPI in the parallel BPM
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_type the replacement policy used to pick victim frames
+   * @param numa_node the NUMA node to bind the frames to, or -1 to leave their placement to the kernel
    */
   BufferPoolManagerInstance(size_t pool_size, uint32_t num_instances, uint32_t instance_index,
-                            DiskManager *disk_manager, LogManager *log_manager = nullptr);
+                            DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                            ReplacerType replacer_type = ReplacerType::LRU, int numa_node = -1);
 
   /**
    * Destroys an existing BufferPoolManagerInstance.
@@ -57,18 +83,63 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /** @return size of the buffer pool */
   auto GetPoolSize() -> size_t override { return pool_size_; }
 
+  /** @return the largest size ResizePool() accepts */
+  auto GetMaxPoolSize() const -> size_t { return max_pool_size_; }
+
+  /**
+   * Grows or shrinks the buffer pool while it is in use. Growing hands the additional frames to the free list.
+   * Shrinking retires the frames past the new size: free ones are dropped, and the pages of unpinned ones are moved to
+   * a free frame, or evicted if there is none. Pages of retired frames pinned through the long pin budget are reclaimed
+   * from their holders first. Retired frames that are still pinned keep their page until it is evicted.
+   * @param pool_size the new number of frames, between 1 and GetMaxPoolSize()
+   * @return false if the size is out of range, or if some retired frames were still pinned
+   */
+  auto ResizePool(size_t pool_size) -> bool override;
+
   /** @return pointer to all the pages in the buffer pool */
   auto GetPages() -> Page * { return pages_; }
 
+  /** @return the number of frames that are currently pinned, maintained as frames get pinned and unpinned */
   auto Count() -> int;
 
+  /** @return the NUMA node the frames are bound to, or -1 if they are not bound */
+  auto GetNumaNode() const -> int { return numa_node_; }
+
+  /** @return the hit, miss and remote access counts of the fetches served so far */
+  auto GetStats() const -> BufferPoolStats {
+    return {num_hits_.load(), num_misses_.load(), num_remote_accesses_.load()};
+  }
+
+  /**
+   * @return true if every frame is pinned, so that no new page fits until one is unpinned. Frames retired by a shrink
+   * that are still pinned do not count.
+   */
+  auto IsFull() const -> bool;
+
+  /**
+   * Starts the page cleaner thread. Every PAGE_CLEANER_INTERVAL it writes back the dirty, unpinned pages among the
+   * next PAGE_CLEANER_CLEAN_TARGET victims of the replacer, at most PAGE_CLEANER_MAX_WRITES of them, so that
+   * foreground requests rarely have to write a page back before reusing its frame.
+   */
+  void StartPageCleaner() override;
+
+  /**
+   * Stops and joins the page cleaner thread. Does nothing if it is not running.
+   */
+  void StopPageCleaner() override;
+
  protected:
   /**
    * Fetch the requested page from the buffer pool.
+   * Pages fetched for a SCAN that are not resident are read into the scan ring: up to SCAN_RING_SIZE frames (and at
+   * most a quarter of the pool) that are recycled in turn by all scans of this instance, so a large scan does not
+   * flush the rest of the buffer pool. A ring frame that is pinned when its turn comes is left to the replacer and
+   * replaced in the ring by a regular victim.
    * @param page_id id of page to be fetched
+   * @param access_type how the page is going to be used
    * @return the requested page
    */
-  auto FetchPgImp(page_id_t page_id) -> Page * override;
+  auto FetchPgImp(page_id_t page_id, AccessType access_type) -> Page * override;
 
   /**
    * Unpin the target page from the buffer pool.
@@ -86,37 +157,52 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   auto FlushPgImp(page_id_t page_id) -> bool override;
 
   /**
-   * Creates a new page in the buffer pool.
+   * Creates a new page in the buffer pool. The page starts out dirty and is written to disk only once it is evicted
+   * or flushed.
    * @param[out] page_id id of created page
    * @return nullptr if no new pages could be created, otherwise pointer to new page
    */
   auto NewPgImp(page_id_t *page_id) -> Page * override;
 
   /**
-   * Deletes a page from the buffer pool.
+   * Deletes a page from the buffer pool. An unpinned page that is being written back is deleted once the write is done.
    * @param page_id id of page to be deleted
-   * @return false if the page exists but could not be deleted, true if the page didn't exist or deletion succeeded
+   * @return false if the page exists but is pinned, true if the page didn't exist or deletion succeeded
    */
   auto DeletePgImp(page_id_t page_id) -> bool override;
 
   /**
-   * Flushes all the pages in the buffer pool to disk.
+   * Flushes all the dirty pages in the buffer pool to disk with WriteDirtyPages(), then syncs the database once.
    */
   void FlushAllPgsImp() override;
 
   /**
-   * Allocate a page on disk.∂
+   * Write back every dirty page, in page id order and with runs of consecutive pages merged into single writes. Clean
+   * pages are skipped. The pages are not synced to stable storage.
+   */
+  void WriteDirtyPages();
+
+  /**
+   * Queues pages to be loaded by the prefetch thread, which is started on first use. The prefetch thread follows the
+   * chain while it stays within this instance, and does not record the loads as accesses in the replacer.
+   * @param page_id id of the first page to load
+   * @param count the number of pages to load
+   * @param next_page follows the chain from one loaded page to the next, or nullptr
+   * @param access_type how the pages are going to be fetched once they are loaded; SCAN loads them into the scan ring
+   */
+  void PrefetchPgImp(page_id_t page_id, size_t count, next_page_fn next_page, AccessType access_type) override;
+
+  /**
+   * Allocate a page on disk, reusing the lowest free page of this instance if there is one.
    * @return the id of the allocated page
    */
   auto AllocatePage() -> page_id_t;
 
   /**
-   * Deallocate a page on disk.
+   * Deallocate a page on disk, so that AllocatePage() can reuse it.
    * @param page_id id of the page to deallocate
    */
-  void DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-    // This is a no-nop right now without a more complex data structure to track deallocated pages
-  }
+  void DeallocatePage(page_id_t page_id) { disk_manager_->DeallocatePage(page_id); }
 
   /**
    * Validate that the page_id being used is accessible to this BPI. This can be used in all of the functions to
@@ -125,33 +211,247 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    */
   void ValidatePageId(page_id_t page_id) const;
 
-  bool FindFrame(frame_id_t *frame_id);
+  /**
+   * One partition of the page table. Each shard owns the mapping for a disjoint subset of page ids and is protected
+   * by its own latch, so requests for pages in different shards never contend with each other.
+   */
+  struct PageTableShard {
+    /** Protects table_ and the pin count / dirty flag transitions of every frame mapped by this shard. */
+    std::mutex latch_;
+    std::unordered_map<page_id_t, frame_id_t> table_;
+  };
+
+  /** I/O state of a frame. Frames that are not READY must not be handed out to callers or evicted. */
+  enum class FrameState { READY, LOADING, WRITING_BACK };
+
+  /**
+   * Per-frame I/O bookkeeping. Threads that need a frame with in-flight I/O wait on that frame only; disk reads and
+   * write-backs are performed without holding any page table latch.
+   */
+  struct FrameHeader {
+    std::mutex latch_;
+    std::condition_variable io_done_;
+    std::atomic<FrameState> state_{FrameState::READY};
+    /** Set while the frame holds a page that was read in for a scan, i.e. one the scan ring may recycle. */
+    std::atomic<bool> scan_{false};
+    /** Set while the frame lies past the pool size. A retired frame is dropped instead of being reused. */
+    std::atomic<bool> retired_{false};
+    /** Set while the frame is owned by nobody: it is retired, or was never part of the pool. */
+    std::atomic<bool> detached_{false};
+  };
+
+  /** Number of page table shards. */
+  static constexpr size_t PAGE_TABLE_SHARDS = 16;
+
+  /** Size of the huge pages that back the frames with ENABLE_HUGE_PAGES. */
+  static constexpr size_t HUGE_PAGE_SIZE = 2 << 20;
+
+  /** @return the number of frames scans may recycle in a pool of the given size */
+  static auto ScanRingCapacity(size_t pool_size) -> size_t {
+    return std::min<size_t>(SCAN_RING_SIZE, pool_size / 4);
+  }
+
+  /** @return the page table shard responsible for the given page id */
+  auto ShardOf(page_id_t page_id) -> PageTableShard & {
+    return page_table_[(static_cast<uint32_t>(page_id) / num_instances_) % PAGE_TABLE_SHARDS];
+  }
+
+  /**
+   * Allocate the frames in one page-aligned arena, optionally backed by huge pages and bound to numa_node_. The data
+   * of the frames comes first, in PAGE_SIZE blocks, so every frame can be used for direct I/O; the pages that refer to
+   * them follow. The arena has room for max_pool_size_ frames, but only the first pool_size_ are constructed, and only
+   * their memory is touched.
+   */
+  void AllocateFrames();
+
+  /** Construct the page of a frame over the frame's block of the arena. */
+  void ConstructFrame(frame_id_t frame_id) {
+    new (&pages_[frame_id]) Page(static_cast<char *>(frame_data_) + static_cast<size_t>(frame_id) * PAGE_SIZE);
+  }
+
+  /** @return true if a page is held by one of the frames past pool_size */
+  auto IsFrameBeyond(const Page *page, size_t pool_size) const -> bool {
+    return page >= pages_ + pool_size && page < pages_ + max_pool_size_;
+  }
+
+  /**
+   * Drop a frame that holds no page if it is retired. A retired frame is owned by nobody until a resize brings it back.
+   * @param frame_id a frame owned by the caller
+   * @return true if the frame was dropped, false if the caller still owns it
+   */
+  auto DetachIfRetired(frame_id_t frame_id) -> bool;
+
+  /**
+   * Vacate a retired frame, moving its page to a free frame or evicting it.
+   * @param frame_id the retired frame
+   * @return false if the frame is pinned or in use by another thread
+   */
+  auto VacateFrame(frame_id_t frame_id) -> bool;
+
+  /**
+   * Fetch and pin a page, reading it in if it is not resident.
+   * @param page_id id of page to be fetched
+   * @param record_access whether the replacer should count this as an access to the page
+   * @param access_type SCAN to read the page into the scan ring if it is not resident
+   * @return the pinned page, or nullptr if every frame is pinned
+   */
+  auto PinPage(page_id_t page_id, bool record_access, AccessType access_type) -> Page *;
+
+  /**
+   * Pin a page like PinPage(), but without waiting for its I/O. If the page is not resident, it is published in
+   * LOADING state and the caller must read it in and then mark the frame READY.
+   * @param page_id id of page to be fetched
+   * @param record_access whether the replacer should count this as an access to the page
+   * @param access_type SCAN to read the page into the scan ring if it is not resident
+   * @param[out] load set if the caller has to read the page in
+   * @return the pinned page, or nullptr if every frame is pinned
+   */
+  auto StartPinPage(page_id_t page_id, bool record_access, AccessType access_type, bool *load) -> Page *;
+
+  /**
+   * Find a frame that can hold a new page, taking it from the free list first and from the replacer otherwise.
+   * @param[out] frame_id the frame that is now exclusively owned by the caller
+   * @return false if every frame is pinned
+   */
+  auto FindFrame(frame_id_t *frame_id) -> bool;
+
+  /**
+   * Find a frame for a page read in by a scan. Until the scan ring is full, frames come from FindFrame() and join the
+   * ring; afterwards the ring frames are recycled in round-robin order.
+   * @param[out] frame_id the frame that is now exclusively owned by the caller
+   * @return false if every frame is pinned
+   */
+  auto FindScanFrame(frame_id_t *frame_id) -> bool;
+
+  /**
+   * Try to evict the page held by a frame returned by the replacer. Only the shard of the evicted page is latched.
+   * @param frame_id the victim frame
+   * @return true if the frame was evicted and is now owned by the caller, false if it was pinned or reused meanwhile
+   */
+  auto EvictFrame(frame_id_t frame_id) -> bool;
+
+  /**
+   * Pin the page held by a frame. The latch of the shard that maps the page must be held.
+   * @param frame_id the frame to pin
+   * @return the pinned page
+   */
+  auto PinFrame(frame_id_t frame_id) -> Page *;
+
+  /** Return a frame that holds no page to the free list. */
+  void ReleaseFrame(frame_id_t frame_id);
+
+  /** Set the I/O state of a frame, waking up waiters once it becomes READY. */
+  void SetFrameState(frame_id_t frame_id, FrameState state);
+
+  /** Block until the frame has no in-flight I/O. */
+  void WaitForIo(frame_id_t frame_id);
+
+  /** Main loop of the page cleaner thread. */
+  void RunPageCleaner();
+
+  /** A batch of pages queued by PrefetchPgImp(). */
+  struct PrefetchRequest {
+    page_id_t page_id_;
+    size_t count_;
+    next_page_fn next_page_;
+    AccessType access_type_;
+  };
+
+  /** Main loop of the prefetch thread. */
+  void RunPrefetcher();
+
+  /** Load the pages of a batch of prefetch requests, leaving them unpinned. The reads of each round are batched. */
+  void Prefetch(std::vector<PrefetchRequest> *requests);
+
+  /** Stops and joins the prefetch thread. Does nothing if it was never started. */
+  void StopPrefetcher();
+
+  /**
+   * Start writing back the page held by a frame if it is dirty and unpinned. Frames with in-flight I/O are skipped.
+   * @param frame_id the frame to clean
+   * @param[out] writes receives the write, which the caller completes with WriteBack()
+   * @return true if the frame is now WRITING_BACK
+   */
+  auto CleanFrame(frame_id_t frame_id, std::vector<DiskRequest> *writes) -> bool;
+
+  /**
+   * Perform a batch of page writes with all of them in flight at once, then mark the frames READY again.
+   * @param writes the writes
+   * @param frame_ids the frames in WRITING_BACK state that are written
+   */
+  void WriteBack(std::vector<DiskRequest> *writes, const std::vector<frame_id_t> &frame_ids);
 
   /** Number of pages in the buffer pool. */
-  const size_t pool_size_;
+  std::atomic<size_t> pool_size_;
+  /** Number of frames the arena has room for. */
+  const size_t max_pool_size_;
+  /** Number of frames constructed in the arena so far; they never shrink back. Only grown under resize_latch_. */
+  std::atomic<size_t> constructed_frames_;
+  /** Serializes ResizePool() calls. */
+  std::mutex resize_latch_;
   /** How many instances are in the parallel BPM (if present, otherwise just 1 BPI) */
   const uint32_t num_instances_ = 1;
   /** Index of this BPI in the parallel BPM (if present, otherwise just 0) */
   const uint32_t instance_index_ = 0;
-  /** Each BPI maintains its own counter for page_ids to hand out, must ensure they mod back to its instance_index_ */
+  /** NUMA node that holds the frames, -1 if they are not bound to one */
+  const int numa_node_;
+  /**
+   * Each BPI maintains its own counter for page_ids to hand out, must ensure they mod back to its instance_index_. It
+   * starts past the end of the database, and is only used once there are no free pages left to reuse.
+   */
   std::atomic<page_id_t> next_page_id_ = instance_index_;
 
-  /** Array of buffer pool pages. */
+  /** Array of buffer pool pages. The page metadata doubles as the per-frame state, indexed by frame id. */
   Page *pages_;
+  /** The arena that holds the frame data and pages_, frame_data_size_ bytes mapped by AllocateFrames(). */
+  void *frame_data_;
+  size_t frame_data_size_;
+  /** Array of frame headers, parallel to pages_. */
+  FrameHeader *frames_;
   /** Pointer to the disk manager. */
   DiskManager *disk_manager_ __attribute__((__unused__));
   /** Pointer to the log manager. */
   LogManager *log_manager_ __attribute__((__unused__));
-  /** Page table for keeping track of buffer pool pages. */
-  std::unordered_map<page_id_t, frame_id_t> page_table_;
-  std::unordered_map<frame_id_t, page_id_t> reverse_page_table_;
+  /** Page table for keeping track of buffer pool pages, partitioned by page id. */
+  std::array<PageTableShard, PAGE_TABLE_SHARDS> page_table_;
   /** Replacer to find unpinned pages for replacement. */
   Replacer *replacer_;
   /** List of free pages. */
   std::list<frame_id_t> free_list_;
-  /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
-  std::mutex latch_;
+  /** Protects free_list_ only. */
+  std::mutex free_list_latch_;
+  /** Number of frames with a non-zero pin count. Once it reaches pool_size_ no frame can be evicted. */
+  std::atomic<size_t> pinned_frames_{0};
+
+  /** Counters reported by GetStats(); remote accesses are only counted if the frames are bound to a node. */
+  std::atomic<uint64_t> num_hits_{0};
+  std::atomic<uint64_t> num_misses_{0};
+  std::atomic<uint64_t> num_remote_accesses_{0};
+
+  /** Maximum number of frames in the scan ring, a quarter of the pool at most; follows the size of the pool. */
+  size_t scan_ring_capacity_;
+  /** Frames recycled by scans, filled up to scan_ring_capacity_ on demand. */
+  std::vector<frame_id_t> scan_ring_;
+  /** Ring slot to recycle next once the ring is full. */
+  size_t scan_ring_next_{0};
+  /** Protects scan_ring_capacity_, scan_ring_ and scan_ring_next_. */
+  std::mutex scan_ring_latch_;
+
+  /** The page cleaner thread, nullptr when it is not running. */
+  std::thread *page_cleaner_thread_{nullptr};
+  /** Cleared to ask the page cleaner to exit, protected by page_cleaner_latch_. */
+  bool page_cleaner_running_{false};
+  std::mutex page_cleaner_latch_;
+  /** Wakes up the page cleaner early, on shutdown or when a foreground eviction had to write a page back. */
+  std::condition_variable page_cleaner_cv_;
 
-  size_t pinned_num_;
+  /** The prefetch thread, nullptr until the first prefetch request. */
+  std::thread *prefetch_thread_{nullptr};
+  /** Cleared to ask the prefetch thread to exit. prefetch_latch_ protects this and prefetch_queue_. */
+  bool prefetch_running_{false};
+  /** Pending prefetch requests, at most pool_size_ of them. */
+  std::deque<PrefetchRequest> prefetch_queue_;
+  std::mutex prefetch_latch_;
+  std::condition_variable prefetch_cv_;
 };
 }  // namespace bustub
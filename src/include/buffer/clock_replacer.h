@@ -12,7 +12,8 @@
 
 #pragma once
 
-#include <list>
+#include <atomic>
+#include <cstdint>
 #include <mutex>  // NOLINT
 #include <vector>
 
@@ -23,6 +24,10 @@ namespace bustub {
 
 /**
  * ClockReplacer implements the clock replacement policy, which approximates the Least Recently Used policy.
+ *
+ * Every frame has an atomic state word holding its "in the clock" and reference bits. Pin and Unpin only flip those
+ * bits and never block; Victim serializes the movement of the clock hand and claims frames with compare-and-swap, so
+ * a frame that is pinned or re-referenced while the hand passes over it is never handed out.
  */
 class ClockReplacer : public Replacer {
  public:
@@ -43,10 +48,23 @@ class ClockReplacer : public Replacer {
 
   void Unpin(frame_id_t frame_id) override;
 
+  void PeekVictims(size_t count, std::vector<frame_id_t> *frame_ids) override;
+
   auto Size() -> size_t override;
 
  private:
-  // TODO(student): implement me!
+  /** The frame can be victimized. */
+  static constexpr uint8_t IN_CLOCK = 1;
+  /** The frame was unpinned since the hand last passed over it. */
+  static constexpr uint8_t REFERENCED = 2;
+
+  size_t num_pages_;
+  /** Array of frame states, indexed by frame id. */
+  std::atomic<uint8_t> *states_;
+  std::atomic<size_t> size_{0};
+  /** Position of the clock hand, protected by hand_latch_. */
+  size_t hand_{0};
+  std::mutex hand_latch_;
 };
 
 }  // namespace bustub
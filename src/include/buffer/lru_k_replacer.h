@@ -0,0 +1,107 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.h
+//
+// Identification: src/include/buffer/lru_k_replacer.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <mutex>  // NOLINT
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * LRUKReplacer implements the LRU-K replacement policy.
+ *
+ * The victim is the evictable frame with the largest backward K-distance, i.e. the one whose K-th most recent access
+ * lies furthest in the past. Frames with fewer than K recorded accesses have an infinite K-distance and are evicted
+ * first, oldest access first, so pages touched once by a scan go before pages that are referenced repeatedly.
+ *
+ * Time is measured in logical accesses. An access that arrives within the correlated reference period of the previous
+ * access to the same frame (e.g. an iterator fetching the same page twice in a row) is correlated: it refreshes the
+ * frame's last access but is not counted as a new reference.
+ */
+class LRUKReplacer : public Replacer {
+ public:
+  /**
+   * Create a new LRUKReplacer.
+   * @param num_frames the maximum number of frames the LRUKReplacer will be required to track
+   * @param k the number of most recent accesses remembered per frame
+   * @param correlated_period accesses at most this many ticks after the previous access to a frame are correlated
+   */
+  explicit LRUKReplacer(size_t num_frames, size_t k = LRUK_REPLACER_K,
+                        size_t correlated_period = LRUK_CORRELATED_PERIOD);
+
+  /**
+   * Destroys the LRUKReplacer.
+   */
+  ~LRUKReplacer() override;
+
+  auto Victim(frame_id_t *frame_id) -> bool override;
+
+  void Pin(frame_id_t frame_id) override;
+
+  /**
+   * Makes a frame evictable. A frame without any recorded access is ordered as if it was accessed now, but the unpin
+   * does not count as a reference.
+   * @param frame_id the id of the frame to unpin
+   */
+  void Unpin(frame_id_t frame_id) override;
+
+  void RecordAccess(frame_id_t frame_id, page_id_t page_id) override;
+
+  void Remove(frame_id_t frame_id) override;
+
+  void PeekVictims(size_t count, std::vector<frame_id_t> *frame_ids) override;
+
+  auto Size() -> size_t override;
+
+ private:
+  /** Eviction order: frames with fewer than K accesses first, then by ascending oldest remembered access. */
+  using EvictionKey = std::tuple<bool, uint64_t, frame_id_t>;
+
+  /** Per-frame access history. The timestamps live in history_, k_ slots per frame used as a ring buffer. */
+  struct FrameRecord {
+    /** Number of remembered accesses, at most k_. */
+    size_t count_{0};
+    /** Ring buffer slot that receives the next access. */
+    size_t next_{0};
+    /** Timestamp of the last access, correlated or not. */
+    uint64_t last_access_{0};
+    bool evictable_{false};
+  };
+
+  /** Appends an uncorrelated access to the history of a frame. */
+  void PushAccess(frame_id_t frame_id, uint64_t timestamp);
+
+  /** @return the position of a frame in the eviction order */
+  auto KeyOf(frame_id_t frame_id) const -> EvictionKey;
+
+  const size_t num_frames_;
+  const size_t k_;
+  const size_t correlated_period_;
+  /** Logical clock, advanced by every recorded access. */
+  uint64_t current_timestamp_{0};
+  /** Array of frame records, indexed by frame id. */
+  FrameRecord *records_;
+  /** Access timestamps of all frames, num_frames_ * k_ entries. */
+  uint64_t *history_;
+  /** Evictable frames ordered by eviction priority. */
+  std::set<EvictionKey> evictable_;
+  std::mutex mtx_;
+};
+
+}  // namespace bustub
@@ -12,10 +12,8 @@
 
 #pragma once
 
-#include <list>
-#include <map>
+#include <atomic>
 #include <mutex>  // NOLINT
-#include <unordered_map>
 #include <vector>
 
 #include "buffer/replacer.h"
@@ -23,20 +21,11 @@
 
 namespace bustub {
 
-struct ListNode {
-  frame_id_t frame_id_{-1};
-  ListNode *prev_{nullptr};
-  ListNode *next_{nullptr};
-  explicit ListNode(frame_id_t frame_id) : frame_id_(frame_id) {}
-  ListNode() = default;
-  void Remove() {
-    prev_->next_ = next_;
-    next_->prev_ = prev_;
-  }
-};
-
 /**
  * LRUReplacer implements the Least Recently Used replacement policy.
+ *
+ * The LRU list is intrusive: the links of every frame live in an array indexed by frame id, so pinning, unpinning and
+ * victimizing never allocate.
  */
 class LRUReplacer : public Replacer {
  public:
@@ -57,16 +46,30 @@ class LRUReplacer : public Replacer {
 
   void Unpin(frame_id_t frame_id) override;
 
+  void PeekVictims(size_t count, std::vector<frame_id_t> *frame_ids) override;
+
   auto Size() -> size_t override;
 
  private:
-  void AddTail(ListNode *new_node);
+  /** Links of a frame in the LRU list. */
+  struct ListNode {
+    frame_id_t prev_{-1};
+    frame_id_t next_{-1};
+    bool in_list_{false};
+  };
+
+  /** Unlinks a frame from the LRU list. */
+  void Unlink(frame_id_t frame_id);
+
+  /** Links a frame in at the most recently used end of the LRU list. */
+  void AddTail(frame_id_t frame_id);
 
-  size_t size_;
+  std::atomic<size_t> size_{0};
   size_t capacity_;
-  std::unordered_map<frame_id_t, ListNode *> hash_map_{};
-  ListNode *head_;
-  ListNode *tail_;
+  /** Array of capacity_ + 1 list nodes. The last one is the sentinel; its next_ is the least recently used frame. */
+  ListNode *nodes_;
+  /** Index of the sentinel node. */
+  frame_id_t head_;
   std::mutex mtx_;
 };
 
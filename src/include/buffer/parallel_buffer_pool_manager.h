@@ -12,7 +12,8 @@
 
 #pragma once
 
-#include <unordered_map>
+#include <atomic>
+#include <vector>
 #include "buffer/buffer_pool_manager.h"
 #include "buffer/buffer_pool_manager_instance.h"
 #include "recovery/log_manager.h"
@@ -41,8 +42,29 @@ class ParallelBufferPoolManager : public BufferPoolManager {
   /** @return size of the buffer pool */
   auto GetPoolSize() -> size_t override;
 
+  /**
+   * Resizes every instance to an equal share of the new size. The number of instances stays the same, since it
+   * determines which instance owns a page id.
+   * @param pool_size the new size of the buffer pool, a multiple of the number of instances
+   * @return false if the size is not such a multiple or out of range, or if some retired frames were still pinned
+   */
+  auto ResizePool(size_t pool_size) -> bool override;
+
+  /** Starts the page cleaner of every instance. */
+  void StartPageCleaner() override;
+
+  /** Stops the page cleaners started by StartPageCleaner(). */
+  void StopPageCleaner() override;
+
+  /**
+   * @param node a NUMA node
+   * @return the counters of the instances whose frames are bound to the node, all zero if NUMA binding is off
+   */
+  auto GetNodeStats(int node) -> BufferPoolStats;
+
  protected:
   /**
+   * Routing needs no latch: the instances are created up front, and instance i owns the page ids congruent to i.
    * @param page_id id of page
    * @return pointer to the BufferPoolManager responsible for handling given page id
    */
@@ -51,9 +73,10 @@ class ParallelBufferPoolManager : public BufferPoolManager {
   /**
    * Fetch the requested page from the buffer pool.
    * @param page_id id of page to be fetched
+   * @param access_type how the page is going to be used
    * @return the requested page
    */
-  auto FetchPgImp(page_id_t page_id) -> Page * override;
+  auto FetchPgImp(page_id_t page_id, AccessType access_type) -> Page * override;
 
   /**
    * Unpin the target page from the buffer pool.
@@ -71,7 +94,8 @@ class ParallelBufferPoolManager : public BufferPoolManager {
   auto FlushPgImp(page_id_t page_id) -> bool override;
 
   /**
-   * Creates a new page in the buffer pool.
+   * Creates a new page in the buffer pool. With NUMA binding, the instances on the node of the calling thread are
+   * tried first.
    * @param[out] page_id id of created page
    * @return nullptr if no new pages could be created, otherwise pointer to new page
    */
@@ -85,18 +109,30 @@ class ParallelBufferPoolManager : public BufferPoolManager {
   auto DeletePgImp(page_id_t page_id) -> bool override;
 
   /**
-   * Flushes all the pages in the buffer pool to disk.
+   * Flushes all the dirty pages in the buffer pool to disk. The instances write back their pages in parallel, then the
+   * database is synced once.
    */
   void FlushAllPgsImp() override;
 
+  /**
+   * Loads pages in the background without pinning them.
+   * @param page_id id of the first page to load
+   * @param count the number of pages to load
+   * @param next_page follows the chain from one loaded page to the next, or nullptr
+   * @param access_type how the pages are going to be fetched once they are loaded
+   */
+  void PrefetchPgImp(page_id_t page_id, size_t count, next_page_fn next_page, AccessType access_type) override;
+
+  /** The instances, all of them created by the constructor. */
   BufferPoolManagerInstance **buffer_pools_;
-  uint32_t num_instances_;
-  size_t pool_size_;
-  uint32_t start_index_;
+  const uint32_t num_instances_;
+  /** Pool size of each instance at construction; ResizePool() changes the instances only. */
+  const size_t pool_size_;
   DiskManager *disk_manager_;
   LogManager *log_manager_;
-  bool *allocated_;
-  std::unordered_map<page_id_t, int> buffer_pool_table_;
-  std::mutex latch_;
+  /** Round-robin cursor of NewPgImp(); taken modulo num_instances_. */
+  std::atomic<uint32_t> next_instance_{0};
+  /** The instances bound to each NUMA node, indexed by node; empty if NUMA binding is off. */
+  std::vector<std::vector<uint32_t>> node_instances_;
 };
 }  // namespace bustub
@@ -12,10 +12,15 @@
 
 #pragma once
 
+#include <vector>
+
 #include "common/config.h"
 
 namespace bustub {
 
+/** Replacement policies that a buffer pool instance can be constructed with. */
+enum class ReplacerType { LRU, CLOCK, LRU_K, ARC };
+
 /**
  * Replacer is an abstract class that tracks page usage.
  */
@@ -43,6 +48,34 @@ class Replacer {
    */
   virtual void Unpin(frame_id_t frame_id) = 0;
 
+  /**
+   * Records an access to the page held by a frame. Policies that only look at the unpin order ignore it.
+   * @param frame_id the id of the accessed frame
+   * @param page_id the id of the page held by the frame
+   */
+  virtual void RecordAccess(frame_id_t frame_id, page_id_t page_id) {}
+
+  /**
+   * Forgets a frame whose page has been evicted or deleted, including any access history kept for it.
+   * @param frame_id the id of the frame to remove
+   */
+  virtual void Remove(frame_id_t frame_id) { Pin(frame_id); }
+
+  /**
+   * Lists the frames that would be victimized next without removing them. The answer may be stale by the time it is
+   * used, so it is only good for hints such as which dirty pages to write back ahead of eviction.
+   * @param count the maximum number of frames to list
+   * @param[out] frame_ids the upcoming victims, most imminent first
+   */
+  virtual void PeekVictims(size_t count, std::vector<frame_id_t> *frame_ids) {}
+
+  /**
+   * Tells the replacer how many frames the buffer pool currently uses, which is at most the number of frames the
+   * replacer was created for. Policies that size their bookkeeping after the cache follow it.
+   * @param pool_size the number of frames in use
+   */
+  virtual void SetPoolSize(size_t pool_size) {}
+
   /** @return the number of elements in the replacer that can be victimized */
   virtual auto Size() -> size_t = 0;
 };
@@ -23,7 +23,7 @@ namespace bustub {
 
 class BustubInstance {
  public:
-  explicit BustubInstance(const std::string &db_file_name) {
+  explicit BustubInstance(const std::string &db_file_name, size_t pool_size = BUFFER_POOL_SIZE) {
     enable_logging = false;
 
     // storage related
@@ -32,7 +32,8 @@ class BustubInstance {
     // log related
     log_manager_ = new LogManager(disk_manager_);
 
-    buffer_pool_manager_ = new BufferPoolManagerInstance(BUFFER_POOL_SIZE, disk_manager_, log_manager_);
+    buffer_pool_manager_ = new BufferPoolManagerInstance(pool_size, disk_manager_, log_manager_);
+    buffer_pool_manager_->StartPageCleaner();
 
     // txn related
     lock_manager_ = new LockManager();
@@ -46,6 +47,7 @@ class BustubInstance {
     if (enable_logging) {
       log_manager_->StopFlushThread();
     }
+    buffer_pool_manager_->StopPageCleaner();
     delete checkpoint_manager_;
     delete log_manager_;
     delete buffer_pool_manager_;
@@ -14,6 +14,7 @@
 
 #include <atomic>
 #include <chrono>  // NOLINT
+#include <cstddef>
 #include <cstdint>
 
 namespace bustub {
@@ -27,14 +28,47 @@ extern std::atomic<bool> enable_logging;
 /** If ENABLE_LOGGING is true, the log should be flushed to disk every LOG_TIMEOUT. */
 extern std::chrono::duration<int64_t> log_timeout;
 
+/** The page cleaner of each buffer pool instance wakes up every PAGE_CLEANER_INTERVAL milliseconds. */
+extern std::chrono::milliseconds page_cleaner_interval;
+
+/** The page cleaner writes back at most PAGE_CLEANER_MAX_WRITES dirty pages per wake-up. */
+extern size_t page_cleaner_max_writes;
+
+/** The page cleaner tries to keep the next PAGE_CLEANER_CLEAN_TARGET victims of the replacer clean. */
+extern size_t page_cleaner_clean_target;
+
+/** Disk managers created while ENABLE_IO_URING is true submit batched page I/O through io_uring, if available. */
+extern bool enable_io_uring;
+
+/** Disk managers created while ENABLE_DIRECT_IO is true bypass the kernel page cache (O_DIRECT), if supported. */
+extern bool enable_direct_io;
+
+/** Buffer pool instances created while ENABLE_HUGE_PAGES is true back their frames with huge pages, if available. */
+extern bool enable_huge_pages;
+
+/**
+ * Parallel buffer pools created while ENABLE_NUMA_BINDING is true bind the frames of their instances to the NUMA nodes
+ * in turn, and create new pages in an instance on the node of the calling thread.
+ */
+extern bool enable_numa_binding;
+
 static constexpr int INVALID_PAGE_ID = -1;                                    // invalid page id
 static constexpr int INVALID_TXN_ID = -1;                                     // invalid transaction id
 static constexpr int INVALID_LSN = -1;                                        // invalid log sequence number
 static constexpr int HEADER_PAGE_ID = 0;                                      // the header page id
 static constexpr int PAGE_SIZE = 4096;                                        // size of a data page in byte
 static constexpr int BUFFER_POOL_SIZE = 10;                                   // size of buffer pool
+static constexpr int BUFFER_POOL_MAX_GROWTH = 8;                              // max growth of a resized buffer pool
 static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE);  // size of a log buffer in byte
 static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
+static constexpr int LRUK_REPLACER_K = 2;                                     // lookback window of the LRU-K replacer
+static constexpr int LRUK_CORRELATED_PERIOD = 2;                              // correlated reference period of LRU-K
+static constexpr int TABLE_SCAN_READ_AHEAD_MAX = 16;                          // max pages read ahead by a table scan
+static constexpr int SCAN_RING_SIZE = 32;                                     // frames recycled by large scans
+static constexpr int DB_SEGMENT_SIZE = 1 << 30;                               // size of a segmented db file in byte
+static constexpr int IO_URING_ENTRIES = 256;                                  // max page I/Os in flight per disk
+static constexpr int DIRECT_IO_ALIGNMENT = 512;                               // alignment of frames for direct I/O
+static constexpr int EXTENT_SIZE = 64;                                        // pages reserved on disk at a time
 
 using frame_id_t = int32_t;    // frame id type
 using page_id_t = int32_t;     // page id type
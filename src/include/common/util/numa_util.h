@@ -0,0 +1,42 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// numa_util.h
+//
+// Identification: src/include/common/util/numa_util.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+
+namespace bustub {
+
+/**
+ * NumaUtil places memory on NUMA nodes through the Linux system calls, without libnuma. On machines or kernels
+ * without NUMA support everything is on node 0 and binding memory fails.
+ */
+class NumaUtil {
+ public:
+  /** @return the number of NUMA nodes of this machine, 1 if it cannot be determined */
+  static auto NumNodes() -> int;
+
+  /** @return the NUMA node of the CPU the calling thread runs on, 0 if it cannot be determined */
+  static auto CurrentNode() -> int;
+
+  /**
+   * Bind a range of memory to a NUMA node. Pages that were touched before are not moved, so bind memory right after
+   * mapping it.
+   * @param addr start of the range, page-aligned
+   * @param len length of the range in bytes
+   * @param node the node to allocate the memory on
+   * @return true if the memory was bound
+   */
+  static auto BindMemory(void *addr, size_t len, int node) -> bool;
+};
+
+}  // namespace bustub
@@ -110,7 +110,7 @@ class ExtendibleHashTable {
    * @param dir_page to use for lookup of global depth
    * @return the directory index
    */
-  inline auto KeyToDirectoryIndex(KeyType key, HashTableDirectoryPage *dir_page) -> uint32_t;
+  inline auto KeyToDirectoryIndex(KeyType key, const HashTableDirectoryPage *dir_page) -> uint32_t;
 
   /**
    * Get the bucket page_id corresponding to a key.
@@ -119,7 +119,7 @@ class ExtendibleHashTable {
    * @param dir_page a pointer to the hash table's directory page
    * @return the bucket page_id corresponding to the input key
    */
-  inline auto KeyToPageId(KeyType key, HashTableDirectoryPage *dir_page) -> uint32_t;
+  inline auto KeyToPageId(KeyType key, const HashTableDirectoryPage *dir_page) -> uint32_t;
 
   /**
    * Fetches the directory page from the buffer pool manager.
@@ -128,14 +128,6 @@ class ExtendibleHashTable {
    */
   auto FetchDirectoryPage() -> HashTableDirectoryPage *;
 
-  /**
-   * Fetches the a bucket page from the buffer pool manager using the bucket's page_id.
-   *
-   * @param bucket_page_id the page_id to fetch
-   * @return a pointer to a bucket page
-   */
-  auto FetchBucketPage(page_id_t bucket_page_id) -> HASH_TABLE_BUCKET_TYPE *;
-
   /**
    * Performs insertion with an optional bucket splitting.
    *
@@ -146,6 +138,16 @@ class ExtendibleHashTable {
    */
   auto SplitInsert(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool;
 
+  /**
+   * Performs removal with an optional bucket merging.
+   *
+   * @param transaction a pointer to the current transaction
+   * @param key the key to remove
+   * @param value the value to remove
+   * @return whether or not the removal was successful
+   */
+  auto MergeRemove(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool;
+
   /**
    * Optionally merges an empty bucket into it's pair.  This is called by Remove,
    * if Remove makes a bucket empty.
@@ -176,12 +178,8 @@ class ExtendibleHashTable {
   void UpdateDirectoryPage(HashTableDirectoryPage *directory_page, page_id_t id0, page_id_t id1);
   void UpdateLittleDirectoryPage(HashTableDirectoryPage *directory_page, page_id_t id0, page_id_t id1,
                                  uint32_t local_depth);
-  bool CheckMerge(HashTableDirectoryPage *directory_page, uint32_t pid, uint32_t local_depth, page_id_t *pInt);
+  bool CheckMerge(const HashTableDirectoryPage *directory_page, uint32_t pid, uint32_t local_depth, page_id_t *pInt);
   bool CheckUpdateGlobalDepth(HashTableDirectoryPage *directory_page);
-  void AddDirectoryLatch(HashTableDirectoryPage *directory_page, char ch);
-  void RemoveDirectoryLatch(HashTableDirectoryPage *directory_page, char ch);
-  void AddBucketLatch(HashTableBucketPage<KeyType, ValueType, KeyComparator> *bucket_page, char ch);
-  void RemoveBucketLatch(HashTableBucketPage<KeyType, ValueType, KeyComparator> *bucket_page, char ch);
 };
 
 }  // namespace bustub
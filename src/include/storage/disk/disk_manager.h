@@ -12,29 +12,78 @@
 
 #pragma once
 
+#include <sys/types.h>
+#include <algorithm>
 #include <atomic>
+#include <condition_variable>  // NOLINT
+#include <cstdint>
 #include <fstream>
 #include <future>  // NOLINT
 #include <mutex>   // NOLINT
+#include <set>
+#include <shared_mutex>
 #include <string>
+#include <vector>
 
 #include "common/config.h"
+#include "storage/disk/io_uring.h"
 
 namespace bustub {
 
+/**
+ * A page read or write that is performed in a batch through DiskManager::SubmitRequests().
+ */
+struct DiskRequest {
+  /** True for a write, false for a read. */
+  bool is_write_;
+  page_id_t page_id_;
+  /** The page to write, or the buffer that receives the page. Must stay valid until the request is done. */
+  char *data_;
+  /** Set by the disk manager once the request has completed. */
+  bool done_{false};
+};
+
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
+ *
+ * Pages are read and written with positional I/O (pread/pwrite) on a single file descriptor, so ReadPage() and
+ * WritePage() never latch and requests for different pages proceed in parallel. The caller must not issue concurrent
+ * requests for the same page, which the buffer pool guarantees.
+ *
+ * By default all pages live in the database file itself. A segmented database splits the pages into segment files of
+ * a fixed size instead: the first segment is the database file, segment n > 0 is "<db_file>.<n>". Segments are opened
+ * lazily on first use and can be preallocated, so a large database grows one segment at a time.
+ *
+ * Batches of page reads and writes can be submitted with SubmitRequests() and completed with WaitForRequests(). On
+ * Linux they are handed to io_uring, so the whole batch is in flight at once; where io_uring is not available (or
+ * ENABLE_IO_URING is off) the requests are performed synchronously on submission.
+ *
+ * WritePages() writes a batch of pages sequentially, with one pwritev per run of consecutive pages, and SyncPages()
+ * makes them durable. Together they turn a flush of the buffer pool into large sequential writes and a single sync.
+ *
+ * Pages freed with DeallocatePage() are kept in free-page sets, one per buffer pool instance, and handed out again by
+ * AllocateFreePage(), lowest page id first. The free pages are persisted as a bitmap in "<db_name>.fsm" whenever the pages are synced and on ShutDown().
+ * Compact() shrinks the database by truncating the free pages at its end.
+ *
+ * With ENABLE_DIRECT_IO the files are opened with O_DIRECT, so the buffer pool is the only cache of the pages. Direct
+ * I/O needs aligned buffers; the frames of the buffer pool are, and other buffers go through a bounce buffer.
  */
 class DiskManager {
  public:
   /**
    * Creates a new disk manager that writes to the specified database file.
    * @param db_file the file name of the database file to write to
+   * @param segment_size size of a segment file in bytes, a multiple of PAGE_SIZE (e.g. DB_SEGMENT_SIZE); 0 keeps the
+   * whole database in db_file
+   * @param preallocate_segments reserve the disk space of a whole segment with fallocate when it is created
    */
-  explicit DiskManager(const std::string &db_file);
+  explicit DiskManager(const std::string &db_file, size_t segment_size = 0, bool preallocate_segments = false);
 
-  ~DiskManager() = default;
+  /**
+   * Closes the database file if ShutDown() was not called.
+   */
+  ~DiskManager();
 
   /**
    * Shut down the disk manager and close all the file resources.
@@ -45,8 +94,9 @@ class DiskManager {
    * Write a page to the database file.
    * @param page_id id of the page
    * @param page_data raw page data
+   * @return false if the page could not be written
    */
-  void WritePage(page_id_t page_id, const char *page_data);
+  auto WritePage(page_id_t page_id, const char *page_data) -> bool;
 
   /**
    * Read a page from the database file.
@@ -55,6 +105,75 @@ class DiskManager {
    */
   void ReadPage(page_id_t page_id, char *page_data);
 
+  /**
+   * Start reading and writing a batch of pages. Requests for the same page must not be in flight at the same time.
+   * @param requests the requests to start; they must stay alive until WaitForRequests() has returned for them
+   */
+  void SubmitRequests(std::vector<DiskRequest> *requests);
+
+  /**
+   * Block until every request of a batch submitted with SubmitRequests() has completed.
+   * @param requests the submitted requests
+   */
+  void WaitForRequests(std::vector<DiskRequest> *requests);
+
+  /**
+   * Write a batch of pages in page id order, merging runs of consecutive pages into vectored writes. Every request is
+   * done when this returns, unless its page could not be written.
+   * @param writes the pages to write, sorted by page id on return
+   */
+  void WritePages(std::vector<DiskRequest> *writes);
+
+  /**
+   * Force all pages written so far to stable storage, with one fdatasync per open database file, and persist the
+   * free-page set.
+   */
+  void SyncPages();
+
+  /**
+   * Mark a page as free, so that AllocateFreePage() can hand it out again. The caller must not use the page anymore.
+   * Pages past the end of the database were never written and are ignored.
+   * @param page_id id of the page
+   */
+  void DeallocatePage(page_id_t page_id);
+
+  /**
+   * Take the lowest free page whose id is congruent to offset modulo stride, so that parallel buffer pools only
+   * reuse their own pages.
+   * @param stride the number of buffer pool instances
+   * @param offset the index of the buffer pool instance
+   * @return the id of the page, or INVALID_PAGE_ID if there is no such free page
+   */
+  auto AllocateFreePage(uint32_t stride = 1, uint32_t offset = 0) -> page_id_t;
+
+  /** @return the number of free pages */
+  auto GetNumFreePages() -> size_t;
+
+  /**
+   * Announce a page that is about to be allocated but may not be written for a while. The disk space of the extent of
+   * EXTENT_SIZE pages that holds it is reserved up front, so that pages allocated one after another end up
+   * contiguous on disk, and the page counts as part of the database from now on.
+   * @param page_id id of the new page
+   */
+  void ReservePage(page_id_t page_id);
+
+  /** @return the number of pages in the database, including the free ones and the reserved ones */
+  auto GetNumPages() const -> page_id_t { return std::max(GetNumFilePages(), num_reserved_pages_.load()); }
+
+  /**
+   * Shrink the database by truncating the run of free pages at its end. Segment files that become empty are removed.
+   * The truncated pages stay free, and are written again at the end of the database when they are reused. Pages
+   * must not be written past the end of the database meanwhile, i.e. no new pages may be allocated.
+   * @return the number of pages truncated
+   */
+  auto Compact() -> size_t;
+
+  /** @return true if batches are submitted through io_uring, false if they fall back to synchronous I/O */
+  auto IsAsync() const -> bool { return io_ring_ != nullptr; }
+
+  /** @return true if the database files were opened for direct I/O */
+  auto IsDirectIo() const -> bool { return direct_io_; }
+
   /**
    * Flush the entire log buffer into disk.
    * @param log_data raw log data
@@ -80,6 +199,9 @@ class DiskManager {
   /** @return the number of disk writes */
   auto GetNumWrites() const -> int;
 
+  /** @return the number of disk reads */
+  auto GetNumReads() const -> int;
+
   /**
    * Sets the future which is used to check for non-blocking flushes.
    * @param f the non-blocking flush check
@@ -91,18 +213,132 @@ class DiskManager {
 
  private:
   auto GetFileSize(const std::string &file_name) -> int;
+
+  /** Open or create a database file, with O_DIRECT if direct_io_ is set. */
+  auto OpenDbFile(const std::string &file_name) -> int;
+
+  /** @return true if a buffer can be used for I/O on the database files as it is */
+  auto IsAligned(const char *buf) const -> bool {
+    return !direct_io_ || reinterpret_cast<uintptr_t>(buf) % direct_io_alignment_ == 0;
+  }
+
+  /** @return the file name of a segment of the database */
+  auto SegmentFileName(size_t segment) const -> std::string;
+
+  /**
+   * Locate a page on disk.
+   * @param page_id id of the page
+   * @param[out] offset offset of the page within its segment file
+   * @return the file descriptor of the segment that holds the page, or -1 if it could not be opened
+   */
+  auto LocatePage(page_id_t page_id, off_t *offset) -> int;
+
+  /**
+   * Open a segment file and all missing segments before it, so that the segments on disk never have gaps.
+   * @param segment the segment to open
+   * @return the file descriptor of the segment, or -1 if it could not be opened
+   */
+  auto OpenSegment(size_t segment) -> int;
+
+  /** Reserve the disk space of a whole segment if preallocate_segments_ is set. */
+  void PreallocateSegment(int fd);
+
+  /** Grow the cached database size to include a page that has been written. */
+  void GrowFileSize(page_id_t page_id);
+
+  /**
+   * Queue a request on io_ring_. The submission latch must be held.
+   * @return false if the request has to be performed synchronously instead
+   */
+  auto PrepareRequest(DiskRequest *request) -> bool;
+
+  /** Mark the requests whose completions are in the completion queue as done. The completion latch must be held. */
+  void ReapCompletions();
+
+  /**
+   * Write a run of consecutive pages with as few pwritev calls as possible.
+   * @param fd the file descriptor of the segment that holds all the pages
+   * @param offset offset of the first page within the segment
+   * @param first the request for the first page
+   * @param count the number of pages in the run
+   */
+  void WriteRun(int fd, off_t offset, DiskRequest *first, size_t count);
+
+  /** @return the number of pages that have been written to the database files */
+  auto GetNumFilePages() const -> page_id_t {
+    return static_cast<page_id_t>((db_file_size_.load() + PAGE_SIZE - 1) / PAGE_SIZE);
+  }
+
+  /** @return true if a page is free. free_pages_latch_ must be held. */
+  auto IsFree(page_id_t page_id) const -> bool {
+    return free_pages_[static_cast<uint32_t>(page_id) % free_stride_].count(page_id) != 0;
+  }
+
+  /** Add a page to the free pages. free_pages_latch_ must be held. */
+  void AddFreePage(page_id_t page_id);
+
+  /** Split the free pages by their residue modulo another stride. free_pages_latch_ must be held. */
+  void SetFreeStride(uint32_t stride);
+
+  /** Read the free-page bitmap written by WriteFreeMap(), ignoring pages past the end of the database. */
+  void ReadFreeMap();
+
+  /** Write the free-page bitmap if the free-page set changed. free_pages_latch_ must be held. */
+  void WriteFreeMap();
+
+  /** Maximum number of pages written by a single pwritev. */
+  static constexpr size_t MAX_PAGES_PER_WRITE = 256;
+
   // stream to write log file
   std::fstream log_io_;
   std::string log_name_;
-  // stream to write db file
-  std::fstream db_io_;
+  // file descriptor of the db file (the first segment), -1 once it is closed
+  int db_fd_{-1};
   std::string file_name_;
+  // size of a segment file in bytes, 0 if the database is not segmented
+  const size_t segment_size_;
+  const bool preallocate_segments_;
+  // true if the database files are opened with O_DIRECT
+  bool direct_io_{false};
+  // memory alignment that direct I/O needs on the file system of the database
+  size_t direct_io_alignment_{DIRECT_IO_ALIGNMENT};
+  // file descriptors of the open segments, indexed by segment number; protected by segments_latch_
+  std::vector<int> segment_fds_;
+  std::shared_mutex segments_latch_;
+  // file that persists free_pages_
+  std::string free_map_name_;
+  // pages that are free for reuse, one set per residue of their id modulo free_stride_, the stride last passed to
+  // AllocateFreePage(); protected by free_pages_latch_
+  std::vector<std::set<page_id_t>> free_pages_{1};
+  uint32_t free_stride_{1};
+  size_t num_free_pages_{0};
+  // set when free_pages_ differs from the bitmap in free_map_name_
+  bool free_map_dirty_{false};
+  std::mutex free_pages_latch_;
+  // one past the highest page passed to ReservePage()
+  std::atomic<page_id_t> num_reserved_pages_{0};
+  // end of the disk space preallocated for reserved pages, in pages; only advanced under extent_latch_
+  std::atomic<page_id_t> preallocated_end_{0};
+  std::mutex extent_latch_;
+  // logical size of the database in bytes, kept up to date by WritePage() so that reads do not have to stat the files
+  std::atomic<uint64_t> db_file_size_{0};
   int num_flushes_{0};
-  int num_writes_{0};
+  std::atomic<int> num_writes_{0};
+  std::atomic<int> num_reads_{0};
   bool flush_log_{false};
   std::future<void> *flush_log_f_{nullptr};
-  // With multiple buffer pool instances, need to protect file access
-  std::mutex db_io_latch_;
+  // io_uring instance for batched page I/O, nullptr if it is unavailable or disabled
+  IoUring *io_ring_{nullptr};
+  // serializes the submission side of io_ring_
+  std::mutex sq_latch_;
+  // serializes the completion side of io_ring_ and protects the done_ flags of submitted requests
+  std::mutex cq_latch_;
+  // wakes up the threads in WaitForRequests() whenever completions were reaped
+  std::condition_variable cq_cv_;
+  // set while a thread waits in the kernel for completions on behalf of all waiters, protected by cq_latch_
+  bool reaping_{false};
+  // number of requests submitted to io_ring_ that have not been reaped yet, at most IO_URING_ENTRIES
+  std::atomic<size_t> in_flight_{0};
 };
 
 }  // namespace bustub
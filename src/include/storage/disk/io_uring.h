@@ -0,0 +1,114 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// io_uring.h
+//
+// Identification: src/include/storage/disk/io_uring.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bustub {
+
+/**
+ * IoUring is a minimal Linux io_uring instance, set up and driven through the raw system calls so that it needs no
+ * library. It only offers what the DiskManager needs: positional reads and writes of a buffer, submitted in batches,
+ * and their completions.
+ *
+ * The submission side and the completion side are not thread-safe on their own; callers serialize each side with a
+ * latch of their own. One thread may wait for completions while another one submits.
+ *
+ * The ring is only usable on kernels that provide IORING_OP_READ/IORING_OP_WRITE and never drop completions (Linux
+ * 5.6 and later). Check IsAvailable() and fall back to synchronous I/O otherwise.
+ */
+class IoUring {
+ public:
+  /**
+   * Sets up a ring.
+   * @param entries the number of submission queue entries, rounded up to a power of two by the kernel
+   */
+  explicit IoUring(uint32_t entries);
+
+  ~IoUring();
+
+  IoUring(const IoUring &) = delete;
+  auto operator=(const IoUring &) -> IoUring & = delete;
+
+  /** @return true if the ring was set up and can be used */
+  auto IsAvailable() const -> bool { return ring_fd_ >= 0; }
+
+  /**
+   * Queue a read without submitting it.
+   * @param fd file to read from
+   * @param buf buffer that receives the data
+   * @param len number of bytes to read
+   * @param offset file offset of the first byte
+   * @param user_data returned with the completion
+   * @return false if the submission queue is full
+   */
+  auto PrepareRead(int fd, char *buf, uint32_t len, uint64_t offset, uint64_t user_data) -> bool;
+
+  /**
+   * Queue a write without submitting it.
+   * @param fd file to write to
+   * @param buf data to write
+   * @param len number of bytes to write
+   * @param offset file offset of the first byte
+   * @param user_data returned with the completion
+   * @return false if the submission queue is full
+   */
+  auto PrepareWrite(int fd, const char *buf, uint32_t len, uint64_t offset, uint64_t user_data) -> bool;
+
+  /**
+   * Hand all queued requests to the kernel.
+   * @return false if the kernel rejected the submission
+   */
+  auto Submit() -> bool;
+
+  /**
+   * Block until at least one completion is available.
+   */
+  void WaitForCompletion();
+
+  /**
+   * Take the next completion off the completion queue.
+   * @param[out] user_data the user_data of the completed request
+   * @param[out] result the number of bytes transferred, or -errno
+   * @return false if no completion is available
+   */
+  auto PopCompletion(uint64_t *user_data, int32_t *result) -> bool;
+
+ private:
+  /** Fill the next free submission queue entry. */
+  auto Prepare(uint8_t opcode, int fd, uint64_t addr, uint32_t len, uint64_t offset, uint64_t user_data) -> bool;
+
+  int ring_fd_{-1};
+  /** The shared submission/completion ring and the submission queue entries, as mapped from the kernel. */
+  void *ring_{nullptr};
+  size_t ring_size_{0};
+  void *sqes_{nullptr};
+  size_t sqes_size_{0};
+
+  /** Pointers into the submission queue ring. */
+  uint32_t *sq_head_;
+  uint32_t *sq_tail_;
+  uint32_t sq_mask_;
+  uint32_t *sq_array_;
+  /** Entries queued by Prepare*() that have not been submitted yet. */
+  uint32_t sq_pending_{0};
+
+  /** Pointers into the completion queue ring. */
+  uint32_t *cq_head_;
+  uint32_t *cq_tail_;
+  uint32_t cq_mask_;
+  void *cqes_;
+};
+
+}  // namespace bustub
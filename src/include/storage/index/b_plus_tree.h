@@ -10,14 +10,22 @@
 //===----------------------------------------------------------------------===//
 #pragma once
 
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <utility>
 #include <queue>
 #include <string>
 #include <vector>
 
 #include "concurrency/transaction.h"
+#include "storage/index/epoch_manager.h"
 #include "storage/index/index_iterator.h"
+#include "storage/index/swizzle_table.h"
 #include "storage/page/b_plus_tree_internal_page.h"
 #include "storage/page/b_plus_tree_leaf_page.h"
+#include "storage/page/page_guard.h"
 
 namespace bustub {
 
@@ -37,6 +45,8 @@ INDEX_TEMPLATE_ARGUMENTS
 class BPlusTree {
   using InternalPage = BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator>;
   using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
+  // Looks leaves up again when the one it was reading may have been unlinked.
+  friend class IndexIterator<KeyType, ValueType, KeyComparator>;
 
  public:
   explicit BPlusTree(std::string name, BufferPoolManager *buffer_pool_manager, const KeyComparator &comparator,
@@ -51,6 +61,13 @@ class BPlusTree {
   // Remove a key and its value from this B+ tree.
   void Remove(const KeyType &key, Transaction *transaction = nullptr);
 
+  /** How full bulk loading packs the pages by default, leaving room for some inserts before pages split. */
+  static constexpr double BULK_LOAD_FILL_FACTOR = 0.9;
+
+  // Build this empty B+ tree bottom-up from key & value pairs sorted by key.
+  auto BulkLoad(const std::function<bool(KeyType *, ValueType *)> &next, double fill_factor = BULK_LOAD_FILL_FACTOR,
+                Transaction *transaction = nullptr) -> bool;
+
   // return the value associated with a given key
   auto GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction = nullptr) -> bool;
 
@@ -65,38 +82,103 @@ class BPlusTree {
   // draw the B+ tree
   void Draw(BufferPoolManager *bpm, const std::string &outf);
 
-  // read data from file and insert one by one
+  // read data from file and bulk load it, or insert it one by one if the tree is not empty
   void InsertFromFile(const std::string &file_name, Transaction *transaction = nullptr);
 
   // read data from file and remove one by one
   void RemoveFromFile(const std::string &file_name, Transaction *transaction = nullptr);
-  // expose for test purpose
-  auto FindLeafPage(const KeyType &key, int opt, Transaction *transaction = nullptr, bool leftMost = false)
-      -> BPlusTreePage *;
 
  private:
+  /** The kinds of operation that latch their way down the tree. */
+  enum class Operation { INSERT, REMOVE };
+
+  /**
+   * The pages a write operation holds on to while it descends the tree (latch crabbing). The write set runs from the
+   * topmost page the operation may still modify down to the current page; each page is the parent of the next one.
+   * The root lock is held as long as the root page id may still change.
+   */
+  struct Context {
+    std::unique_lock<std::mutex> root_lock_;
+    std::deque<WritePageGuard> write_set_;
+  };
+
+  /**
+   * A page that an optimistic descent reads without a latch, and the version it read the page at. The page is kept
+   * in the buffer pool either by the swizzle table or by a pin of its own.
+   */
+  struct OptimisticPage {
+    BasicPageGuard pin_;
+    Page *page_{nullptr};
+    SwizzleTable::Node *node_{nullptr};
+    uint64_t version_{0};
+  };
+
+  /**
+   * The state of a bulk load: for every level of the tree, from the leaves up, the entries that are not in a page yet
+   * (in leaf_entries_ for the leaves, and at the index of the level in internal_entries_ above them), and the last page
+   * built, which stays latched until its right sibling is known. Levels are added as the tree grows, and deques keep
+   * the entries of a level in place while the levels above are added.
+   */
+  struct BulkLoadContext {
+    int leaf_size_;
+    int internal_size_;
+    std::vector<MappingType> leaf_entries_;
+    std::deque<std::vector<std::pair<KeyType, page_id_t>>> internal_entries_;
+    std::deque<WritePageGuard> last_pages_;
+    std::deque<int> page_counts_;
+    /** Every page built so far, given back to the tree if the load is abandoned. */
+    std::vector<page_id_t> page_ids_;
+  };
+
+  /** How many times an operation descends optimistically before it falls back to latch crabbing. */
+  static constexpr int OPTIMISTIC_ATTEMPTS = 4;
+
+  auto FetchRead(page_id_t page_id) -> ReadPageGuard;
+  auto FetchWrite(page_id_t page_id) -> WritePageGuard;
+  auto NewGuardedPage(page_id_t *page_id) -> WritePageGuard;
+
+  auto FetchSwizzledRead(std::atomic<SwizzleTable::Node *> *link, page_id_t page_id, SwizzleTable::Node **node)
+      -> ReadPageGuard;
+
+  auto VisitOptimistic(std::atomic<SwizzleTable::Node *> *link, page_id_t page_id, OptimisticPage *page) -> bool;
+  void SwizzleRoot(page_id_t page_id);
+  void SwizzleChild(OptimisticPage *parent, int index, page_id_t child_page_id, const OptimisticPage &child);
+  auto FindLeafOptimistic(const KeyType &key, bool left_most, OptimisticPage *leaf, bool *is_root) -> bool;
+
+  auto FindLeafRead(const KeyType &key, bool left_most = false) -> ReadPageGuard;
+  auto FindLeafReadPessimistic(const KeyType &key, bool left_most) -> ReadPageGuard;
+  void FindLeafWrite(const KeyType &key, Operation op, Context *ctx);
+  auto IsSafe(const BPlusTreePage *node, Operation op, bool is_root) const -> bool;
+
   void StartNewTree(const KeyType &key, const ValueType &value);
 
-  auto InsertIntoLeaf(BPlusTreePage *node, const KeyType &key, const ValueType &value,
-                      Transaction *transaction = nullptr) -> bool;
+  auto InsertIntoLeaf(const KeyType &key, const ValueType &value, Context *ctx) -> bool;
 
-  void InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, page_id_t new_page_id,
-                        Transaction *transaction = nullptr);
+  void InsertIntoParent(const KeyType &key, page_id_t new_page_id, Context *ctx);
 
-  auto Split(BPlusTreePage *node) -> BPlusTreePage *;
+  template <typename N>
+  auto Split(N *node, page_id_t *new_page_id) -> WritePageGuard;
 
   template <typename N>
-  auto CoalesceOrRedistribute(N *node, KeyType min_key, Transaction *transaction = nullptr) -> bool;
+  void CoalesceOrRedistribute(Context *ctx);
 
   template <typename N>
-  auto Coalesce(N *neighbor_node, N *node, BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *parent, int opt,
-                int index, Transaction *transaction = nullptr) -> bool;
+  void Coalesce(N *left_node, N *right_node, InternalPage *parent, int index);
 
   template <typename N>
-  void Redistribute(N *neighbor_node, N *node, BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *parent_page,
-                    int opt, int index);
+  void Redistribute(N *neighbor_node, N *node, InternalPage *parent, int index);
+
+  void AdjustRoot(WritePageGuard *old_root_guard);
+
+  auto BulkLoadPageSize(int max_size, double fill_factor) const -> int;
+
+  template <typename N, typename Entry>
+  void BulkLoadLevel(BulkLoadContext *ctx, size_t level, std::vector<Entry> *entries, bool last);
+
+  template <typename N, typename Entry>
+  void BulkLoadPage(BulkLoadContext *ctx, size_t level, const Entry *entries, int size);
 
-  auto AdjustRoot(BPlusTreePage *node) -> bool;
+  void FreePage(page_id_t page_id);
 
   void UpdateRootPageId(int insert_record = 0);
 
@@ -107,19 +189,18 @@ class BPlusTree {
 
   // member variable
   std::string index_name_;
-  page_id_t root_page_id_;
+  /** Written under root_latch_, and read without it by optimistic descents. */
+  std::atomic<page_id_t> root_page_id_;
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
   int leaf_max_size_;
   int internal_max_size_;
+  /** Serializes the changes to root_page_id_. */
   std::mutex root_latch_;
-  void RecursiveUpdate(KeyType min_key, const KeyType &key, page_id_t page_id);
-  void RemoveParent(BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *parent_page, int index);
-  BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *FindCertainLeafPage(int opt);
-  void RLatch(BPlusTreePage *child_page);
-  void RUnLatch(BPlusTreePage *child_page);
-  void WLatch(BPlusTreePage *child_page);
-  void WUnLatch(BPlusTreePage *child_page);
+  /** Direct links to the internal pages, for every descent but the write-latching ones. */
+  SwizzleTable swizzle_table_;
+  /** Tells when the pages unlinked from the tree can be handed back to the buffer pool. */
+  EpochManager epochs_;
 };
 
 }  // namespace bustub
@@ -0,0 +1,99 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// epoch_manager.h
+//
+// Identification: src/include/storage/index/epoch_manager.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <utility>
+#include <vector>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * EpochManager tells when a page unlinked from a B+ tree can be released, that is handed back to the buffer pool where
+ * it may become a page of anything else: once no operation on the tree can still hold its page id (epoch-based
+ * reclamation). Operations run within an epoch, from Enter() to Exit(). A page retired in an epoch is out of reach of
+ * the operations that start after it, so it is released once the operations of its epoch are over, which takes the
+ * epoch two steps ahead.
+ *
+ * Operations are counted per epoch parity in shards of counters, so that operations on different cores do not write to
+ * the same cache line. The epoch moves ahead when pages are retired, and when the last operation of the previous epoch
+ * leaves; there is no background thread.
+ */
+class EpochManager {
+ public:
+  /** Leaves the epoch it entered when it is destroyed. */
+  class Guard {
+   public:
+    explicit Guard(EpochManager *manager) : manager_(manager), epoch_(manager->Enter()) {}
+    Guard(const Guard &) = delete;
+    auto operator=(const Guard &) -> Guard & = delete;
+    ~Guard() { manager_->Exit(epoch_); }
+
+   private:
+    EpochManager *manager_;
+    uint64_t epoch_;
+  };
+
+  /**
+   * @param release releases a page that no operation can hold anymore, and returns false if it cannot be released yet,
+   * to be tried again later
+   */
+  explicit EpochManager(std::function<bool(page_id_t)> release) : release_(std::move(release)) {}
+
+  EpochManager(const EpochManager &) = delete;
+  auto operator=(const EpochManager &) -> EpochManager & = delete;
+
+  /** Releases the pages still waiting to be released. No operation can be running anymore. */
+  ~EpochManager();
+
+  /** @return the epoch the operation entered, to be passed to Exit() */
+  auto Enter() -> uint64_t;
+
+  /** Ends an operation, and moves the epoch ahead if it was the last one holding retired pages back. */
+  void Exit(uint64_t epoch);
+
+  /** Releases a page unlinked from the tree once no operation can still hold its page id. */
+  void Retire(page_id_t page_id);
+
+ private:
+  static constexpr size_t NUM_SHARDS = 16;
+
+  struct alignas(64) Counter {
+    std::atomic<int64_t> count_{0};
+  };
+
+  static auto Shard() -> size_t;
+
+  /** @return true if an operation that entered at an epoch of the given parity is not over yet */
+  auto IsActive(uint64_t parity) const -> bool;
+
+  /** Moves the epoch ahead as far as the operations allow, releasing the pages no operation can hold anymore. */
+  void TryAdvance();
+
+  std::atomic<uint64_t> epoch_{0};
+  Counter operations_[2][NUM_SHARDS];
+  /** Whether any page is waiting to be released; read without the latch. */
+  std::atomic<bool> has_retired_{false};
+  /** Protects the fields below, and the moves of the epoch. */
+  std::mutex latch_;
+  /** The pages retired at an epoch, by parity. */
+  std::vector<page_id_t> retired_[2];
+  std::function<bool(page_id_t)> release_;
+};
+
+}  // namespace bustub
@@ -19,48 +19,59 @@
 
 namespace bustub {
 
+/**
+ * GenericKeyEncoding writes the columns of an index key in a byte encoding that sorts like the key itself, so that two
+ * keys compare with a single memcmp instead of deserializing and comparing every column:
+ * - integers, booleans and timestamps are stored big-endian, with the sign bit of the signed types flipped;
+ * - decimals are stored like integers, after flipping every bit of negative numbers, or the sign bit of the others;
+ * - strings start with a byte that tells NULL (0) from the rest (1), then hold their bytes with every 0 byte escaped
+ *   as 0 0xFF, and end with 0 0.
+ * The NULL of a fixed-size type is stored as the smallest value of the type (the largest for timestamps), and sorts
+ * as such. Columns follow each other in the order of the key schema. An encoding that does not fit in the key is cut,
+ * so keys that only differ past its end compare equal, and the rest of the key is zero-filled.
+ */
+class GenericKeyEncoding {
+ public:
+  /** Encodes a tuple laid out by key_schema into size bytes at data. */
+  static void Encode(const Tuple &tuple, const Schema &key_schema, char *data, size_t size);
+
+  /** Encodes an integer as a BIGINT key, or as an INTEGER key if size is too small for a BIGINT. */
+  static void EncodeInteger(int64_t key, char *data, size_t size);
+
+  /** Decodes a column of a key encoded from a tuple laid out by key_schema. */
+  static auto Decode(const char *data, size_t size, const Schema &key_schema, uint32_t column_idx) -> Value;
+
+  /** Decodes a key encoded by EncodeInteger. */
+  static auto DecodeInteger(const char *data, size_t size) -> int64_t;
+};
+
 /**
  * Generic key is used for indexing with opaque data.
  *
  * This key type uses an fixed length array to hold data for indexing
  * purposes, the actual size of which is specified and instantiated
- * with a template argument.
+ * with a template argument. The data is encoded by GenericKeyEncoding.
  */
 template <size_t KeySize>
 class GenericKey {
  public:
-  inline void SetFromKey(const Tuple &tuple) {
-    // intialize to 0
-    memset(data_, 0, KeySize);
-    memcpy(data_, tuple.GetData(), tuple.GetLength());
+  inline void SetFromKey(const Tuple &tuple, const Schema &key_schema) {
+    GenericKeyEncoding::Encode(tuple, key_schema, data_, KeySize);
   }
 
   // NOTE: for test purpose only
-  inline void SetFromInteger(int64_t key) {
-    memset(data_, 0, KeySize);
-    memcpy(data_, &key, sizeof(int64_t));
-  }
+  inline void SetFromInteger(int64_t key) { GenericKeyEncoding::EncodeInteger(key, data_, KeySize); }
 
   inline auto ToValue(Schema *schema, uint32_t column_idx) const -> Value {
-    const char *data_ptr;
-    const auto &col = schema->GetColumn(column_idx);
-    const TypeId column_type = col.GetType();
-    const bool is_inlined = col.IsInlined();
-    if (is_inlined) {
-      data_ptr = (data_ + col.GetOffset());
-    } else {
-      int32_t offset = *reinterpret_cast<int32_t *>(const_cast<char *>(data_ + col.GetOffset()));
-      data_ptr = (data_ + offset);
-    }
-    return Value::DeserializeFrom(data_ptr, column_type);
+    return GenericKeyEncoding::Decode(data_, KeySize, *schema, column_idx);
   }
 
   // NOTE: for test purpose only
-  // interpret the first 8 bytes as int64_t from data vector
-  inline auto ToString() const -> int64_t { return *reinterpret_cast<int64_t *>(const_cast<char *>(data_)); }
+  // decode the integer set by SetFromInteger
+  inline auto ToString() const -> int64_t { return GenericKeyEncoding::DecodeInteger(data_, KeySize); }
 
   // NOTE: for test purpose only
-  // interpret the first 8 bytes as int64_t from data vector
+  // decode the integer set by SetFromInteger
   friend auto operator<<(std::ostream &os, const GenericKey &key) -> std::ostream & {
     os << key.ToString();
     return os;
@@ -71,36 +82,20 @@ class GenericKey {
 };
 
 /**
- * Function object returns true if lhs < rhs, used for trees
+ * Function object returns a negative number if lhs < rhs, 0 if they are equal, and a positive number otherwise, used
+ * for trees and hash tables. Keys are encoded so that their bytes sort like the keys, so the key schema is not needed.
  */
 template <size_t KeySize>
 class GenericComparator {
  public:
   inline auto operator()(const GenericKey<KeySize> &lhs, const GenericKey<KeySize> &rhs) const -> int {
-    uint32_t column_count = key_schema_->GetColumnCount();
-
-    for (uint32_t i = 0; i < column_count; i++) {
-      Value lhs_value = (lhs.ToValue(key_schema_, i));
-      Value rhs_value = (rhs.ToValue(key_schema_, i));
-
-      if (lhs_value.CompareLessThan(rhs_value) == CmpBool::CmpTrue) {
-        return -1;
-      }
-      if (lhs_value.CompareGreaterThan(rhs_value) == CmpBool::CmpTrue) {
-        return 1;
-      }
-    }
-    // equals
-    return 0;
+    return memcmp(lhs.data_, rhs.data_, KeySize);
   }
 
-  GenericComparator(const GenericComparator &other) : key_schema_{other.key_schema_} {}
+  GenericComparator(const GenericComparator &other) = default;
 
   // constructor
-  explicit GenericComparator(Schema *key_schema) : key_schema_(key_schema) {}
-
- private:
-  Schema *key_schema_;
+  explicit GenericComparator(Schema * /*key_schema*/) {}
 };
 
 }  // namespace bustub
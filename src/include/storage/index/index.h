@@ -12,6 +12,7 @@
 
 #pragma once
 
+#include <functional>
 #include <memory>
 #include <string>
 #include <utility>
@@ -159,6 +160,20 @@ class Index {
    */
   virtual void InsertEntry(const Tuple &key, RID rid, Transaction *transaction) = 0;
 
+  /**
+   * Insert a batch of entries into the index, such as every tuple of a table the index is built on. Indexes that can
+   * be built faster from the whole batch than one entry at a time override this.
+   * @param next Called for each entry in turn, sets its index key and RID, and returns false once there are no more
+   * @param transaction The transaction context
+   */
+  virtual void InsertEntries(const std::function<bool(Tuple *, RID *)> &next, Transaction *transaction) {
+    Tuple key;
+    RID rid;
+    while (next(&key, &rid)) {
+      InsertEntry(key, rid, transaction);
+    }
+  }
+
   /**
    * Delete an index entry by key.
    * @param key The index key
@@ -14,16 +14,33 @@
  */
 #pragma once
 #include "storage/page/b_plus_tree_leaf_page.h"
+#include "storage/page/page_guard.h"
 
 namespace bustub {
 
 #define INDEXITERATOR_TYPE IndexIterator<KeyType, ValueType, KeyComparator>
 
+INDEX_TEMPLATE_ARGUMENTS
+class BPlusTree;
+
+/**
+ * IndexIterator walks the leaves of a B+ tree from left to right. It keeps the leaf it points into pinned and
+ * read-latched, so dereferencing it touches neither the buffer pool nor the latch, and it lets go of the latch of a
+ * leaf before latching the next one. Since leaves may split, merge or trade items in between, it resumes every leaf
+ * after the last key of the previous one (or at the key it started from), and looks that key up in the tree again
+ * when the leaf it left may have been unlinked. The end iterator holds no page.
+ */
 INDEX_TEMPLATE_ARGUMENTS
 class IndexIterator {
  public:
-  // you may define your own constructor based on your member variables
-  IndexIterator(page_id_t page_id, page_id_t next_page_id, int size, int cursor, BufferPoolManager *buffer_pool);
+  /** Constructs the end iterator. */
+  IndexIterator() = default;
+  /** Constructs an iterator at a cursor of a leaf guarded by guard, or at the first item after it. */
+  IndexIterator(BPlusTree<KeyType, ValueType, KeyComparator> *tree, ReadPageGuard guard, int cursor);
+  /** Constructs an iterator at the first key not less than key, starting from the leaf guarded by guard. */
+  IndexIterator(BPlusTree<KeyType, ValueType, KeyComparator> *tree, ReadPageGuard guard, const KeyType &key);
+  IndexIterator(IndexIterator &&that) noexcept = default;
+  auto operator=(IndexIterator &&that) noexcept -> IndexIterator & = default;
   ~IndexIterator();  // NOLINT
 
   auto IsEnd() -> bool;
@@ -33,19 +50,34 @@ class IndexIterator {
   auto operator++() -> IndexIterator &;
 
   auto operator==(const IndexIterator &itr) const -> bool {
-    return page_id_ == itr.page_id_ && size_ == itr.size_ && cursor_ == itr.cursor_;
+    return page_id_ == itr.page_id_ && cursor_ == itr.cursor_;
   }
 
-  auto operator!=(const IndexIterator &itr) const -> bool {
-    return static_cast<bool>(page_id_ != itr.page_id_ || size_ != itr.size_ || cursor_ != itr.cursor_);
-  }
+  auto operator!=(const IndexIterator &itr) const -> bool { return !(*this == itr); }
 
  private:
-  page_id_t page_id_;
-  page_id_t next_page_id_;
-  int size_;
-  int cursor_;
-  BufferPoolManager *buffer_pool_;
+  using LeafPage = BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>;
+
+  /** Moves on to the next leaf, past empty ones, while the cursor is past the end of the current leaf. */
+  void SkipExhaustedLeaves();
+
+  /** Points the cursor at the first item of the current leaf from resume_key_ on, or after it once it was visited. */
+  void SeekResumeKey();
+
+  BPlusTree<KeyType, ValueType, KeyComparator> *tree_{nullptr};
+  ReadPageGuard guard_;
+  page_id_t page_id_{INVALID_PAGE_ID};
+  int cursor_{0};
+  /** The item the cursor points at, copied out of the leaf, which may not store keys next to their values. */
+  MappingType item_;
+  /**
+   * The key every leaf is read from, if any: the last key of the leaves left behind, or the key the iterator started
+   * from until then.
+   */
+  KeyType resume_key_;
+  bool has_resume_key_{false};
+  /** Whether resume_key_ was already visited, so that the next leaf is read from the first key after it. */
+  bool resume_key_visited_{false};
 };
 
 }  // namespace bustub
@@ -0,0 +1,109 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// swizzle_table.h
+//
+// Identification: src/include/storage/index/swizzle_table.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <unordered_map>
+#include <vector>
+
+#include "buffer/buffer_pool_manager.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+/**
+ * SwizzleTable keeps the internal pages of a B+ tree pinned in the buffer pool, and links each of them from its
+ * parent with a direct pointer to its frame, so that a descent through swizzled pages never goes through the page
+ * table of the buffer pool.
+ *
+ * A link is only a hint: it is followed if the node it points to is still swizzled for the page id that the parent
+ * page holds at that slot, and ignored otherwise. Links are therefore never invalidated when pages split, merge or
+ * move children around, and a page is unswizzled by dropping its node, before the page is deleted. A pinned page is
+ * never evicted, so swizzled pages only ever leave the buffer pool this way.
+ *
+ * Links are written while the parent page is latched, and a page is unswizzled to be deleted only while its parent is
+ * write-latched (or, for the root, while the root page id is locked), so a node cannot be dropped for that reason
+ * between the moment a link to it is resolved under the latch of the parent and the moment its page is latched.
+ * Readers that follow links without latches must check the version of the parent page afterwards, and must expect a
+ * frame they read to have been given to another page in the meantime.
+ *
+ * Pages are pinned through the LongPinBudget of the buffer pool, which bounds the pages kept pinned by all the tables
+ * on the pool together, so that its B+ trees cannot pin it down however many of them there are. The buffer pool may
+ * reclaim swizzled pages, whatever their parents are doing: such a page is unswizzled, and unpinned once the readers
+ * that latched it through its node are gone. Latched readers therefore check that the node is still swizzled for the
+ * page once they hold its latch. The table unpins its pages when it is destroyed, unless the buffer pool is gone by
+ * then.
+ */
+class SwizzleTable : public LongPinBudget::Holder {
+ public:
+  /** A swizzled page: its frame, and the links to its children, one per slot. */
+  struct Node {
+    /** The page this node is swizzled for, or INVALID_PAGE_ID if it is not in use. */
+    std::atomic<page_id_t> page_id_{INVALID_PAGE_ID};
+    /** The frame of the page. Left as it is when the node is dropped, since the frame outlives the node. */
+    std::atomic<Page *> page_{nullptr};
+    std::unique_ptr<std::atomic<Node *>[]> children_;
+  };
+
+  /**
+   * @param bpm the buffer pool the pages are pinned in
+   * @param capacity the number of pages that may be swizzled at once; 0 disables swizzling
+   * @param fanout the number of children of an internal page
+   */
+  SwizzleTable(BufferPoolManager *bpm, size_t capacity, int fanout);
+
+  /** Unpins every swizzled page. */
+  ~SwizzleTable() override;
+
+  SwizzleTable(const SwizzleTable &) = delete;
+  auto operator=(const SwizzleTable &) -> SwizzleTable & = delete;
+
+  /** @return the link from the tree to its root page */
+  auto RootLink() -> std::atomic<Node *> * { return &root_; }
+
+  /** @return the link from a swizzled page to the child at a slot */
+  auto ChildLink(Node *parent, int slot) -> std::atomic<Node *> * { return &parent->children_[slot]; }
+
+  /** @return the node a link points to, if it is swizzled for page_id; nullptr otherwise */
+  auto Resolve(const std::atomic<Node *> &link, page_id_t page_id) const -> Node *;
+
+  /**
+   * Swizzles a page, pinning it once more unless it is already swizzled, and points a link to it.
+   * @return the node of the page, or nullptr if the table is full
+   */
+  auto Swizzle(std::atomic<Node *> *link, page_id_t page_id) -> Node *;
+
+  /** Unswizzles a page if it is swizzled, giving back its pin. Must be called before the page is deleted. */
+  void Unswizzle(page_id_t page_id);
+
+  /** Unswizzles a page reclaimed by the buffer pool, and gives back its pin once no latched reader holds it. */
+  void Release(page_id_t page_id) override;
+
+  /** @return true if no more pages can be swizzled for now; a hint that may be stale by the time it is returned */
+  auto IsFull() const -> bool { return free_nodes_.load(std::memory_order_relaxed) == 0 || pins_->IsExhausted(); }
+
+ private:
+  std::shared_ptr<LongPinBudget> pins_;
+  int fanout_;
+  std::atomic<Node *> root_{nullptr};
+  std::atomic<size_t> free_nodes_;
+  /** Protects the fields below, and the frame of a node while it is not in use. */
+  std::mutex latch_;
+  std::vector<Node> nodes_;
+  std::vector<Node *> free_list_;
+  std::unordered_map<page_id_t, Node *> swizzled_;
+};
+
+}  // namespace bustub
@@ -11,14 +11,16 @@
 #pragma once
 
 #include <queue>
+#include <type_traits>
 #include <utility>
+#include "storage/page/b_plus_tree_key_search.h"
 #include "storage/page/b_plus_tree_page.h"
 
 namespace bustub {
 
 #define B_PLUS_TREE_INTERNAL_PAGE_TYPE BPlusTreeInternalPage<KeyType, ValueType, KeyComparator>
-#define INTERNAL_PAGE_HEADER_SIZE 24
-#define INTERNAL_PAGE_SIZE ((PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE) / (sizeof(MappingType)))
+#define INTERNAL_PAGE_HEADER_SIZE (24 + sizeof(BPlusTreeFences<KeyType>))
+#define INTERNAL_PAGE_SIZE ((PAGE_SIZE - INTERNAL_PAGE_HEADER_SIZE) / (sizeof(KeyType) + sizeof(ValueType)))
 /**
  * Store n indexed keys and n+1 child pointers (page_id) within internal page.
  * Pointer PAGE_ID(i) points to a subtree in which all keys K satisfy:
@@ -31,12 +33,33 @@ namespace bustub {
  *  --------------------------------------------------------------------------
  * | HEADER | KEY(1)+PAGE_ID(1) | KEY(2)+PAGE_ID(2) | ... | KEY(n)+PAGE_ID(n) |
  *  --------------------------------------------------------------------------
+ *
+ * or, for keys laid out apart from their values (see BPlusTreeSplitLayout),
+ * with room for INTERNAL_PAGE_SIZE keys before the first page id:
+ *  --------------------------------------------------------------------------
+ * | HEADER | KEY(1) | ... | KEY(n) | ... | PAGE_ID(1) | ... | PAGE_ID(n) |
+ *  --------------------------------------------------------------------------
+ *
+ * Header format (size in byte, 24 bytes + fences in total), laid out like the
+ * header of a leaf page:
+ *  --------------------------------------------------------------------------
+ * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) | PageId (4) |
+ *  --------------------------------------------------------------------------
+ * | NextPageId (4) | Fences |
+ *  --------------------------------------------------------------------------
  */
 INDEX_TEMPLATE_ARGUMENTS
 class BPlusTreeInternalPage : public BPlusTreePage {
  public:
   // must call initialize method after "create" a new node
-  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID, int max_size = INTERNAL_PAGE_SIZE);
+  void Init(page_id_t page_id, int max_size = INTERNAL_PAGE_SIZE);
+  // the number of key & value pairs a page has room for
+  static constexpr auto Capacity() -> int { return static_cast<int>(INTERNAL_PAGE_SIZE); }
+
+  auto GetNextPageId() const -> page_id_t;
+  void SetNextPageId(page_id_t next_page_id);
+  auto Fences() const -> const BPlusTreeFences<KeyType> * { return &fences_; }
+  auto Fences() -> BPlusTreeFences<KeyType> * { return &fences_; }
 
   auto KeyAt(int index) const -> KeyType;
   void SetKeyAt(int index, const KeyType &key);
@@ -44,33 +67,42 @@ class BPlusTreeInternalPage : public BPlusTreePage {
   auto ValueIndex(const ValueType &value) const -> int;
   auto ValueAt(int index) const -> ValueType;
 
+  auto KeyIndex(const KeyType &key, const KeyComparator &comparator) const -> int;
   auto Lookup(const KeyType &key, const KeyComparator &comparator) const -> ValueType;
   void PopulateNewRoot(const ValueType &old_value, const KeyType &new_key, const ValueType &new_value);
+  void Populate(const MappingType *items, int size);
   auto InsertNodeAfter(const ValueType &old_value, const KeyType &new_key, const ValueType &new_value) -> int;
-  auto Insert(const KeyType &key, const ValueType &value, const KeyComparator &comparator) -> int;
   void Remove(int index);
   auto RemoveAndReturnOnlyChild() -> ValueType;
 
   // Split and Merge utility methods
-  void MoveAllTo(BPlusTreeInternalPage *recipient, const KeyType &middle_key, int opt);
-  auto MoveHalfTo(BPlusTreeInternalPage *recipient, BufferPoolManager *buffer_pool_manager) -> KeyType;
-  void MoveFirstToEndOf(BPlusTreeInternalPage *recipient, BufferPoolManager *bufferPoolManager);
-  void MoveLastToFrontOf(BPlusTreeInternalPage *recipient, BufferPoolManager *bufferPoolManager);
-
-  void UpdateParentPageId(BufferPoolManager *buffer_pool_manager);
-  void UpdateNewParentId(page_id_t new_page_id, BufferPoolManager *buffer_pool_manager);
+  void MoveHalfTo(BPlusTreeInternalPage *recipient);
+  void MoveAllTo(BPlusTreeInternalPage *recipient, const KeyType &middle_key);
+  void MoveFirstToEndOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key);
+  void MoveLastToFrontOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key);
 
-  void FindSiblings(KeyType key, KeyComparator comparator, page_id_t *left_sibling_page_id,
-                    page_id_t *right_sibling_page_id, int *index);
+ private:
+  /** Whether the keys are stored apart from the values. */
+  static constexpr bool SPLIT_LAYOUT = BPlusTreeSplitLayout<KeyType>::value;
+  /** Whether the keys are searched with BPlusTreeKeySearch instead of the comparator. */
+  static constexpr bool KEY_SEARCH =
+      SPLIT_LAYOUT && std::is_same_v<KeyComparator, GenericComparator<sizeof(KeyType)>>;
 
-  auto LookupKey(const KeyType &key, const KeyComparator &comparator) -> int;
+  // The arrays of keys and of values, in the split layout only
+  auto Keys() const -> const KeyType *;
+  auto Keys() -> KeyType *;
+  auto Values() const -> const ValueType *;
+  auto Values() -> ValueType *;
 
- private:
-  void CopyNFrom(MappingType *items, int size);
+  auto ItemAt(int index) const -> MappingType;
+  void SetItem(int index, const MappingType &pair);
+  void MoveItems(int from, int to, int count);
+  void CopyNFrom(const BPlusTreeInternalPage *page, int index, int size);
   void CopyLastFrom(const MappingType &pair);
   void CopyFirstFrom(const MappingType &pair);
+  page_id_t next_page_id_;
+  BPlusTreeFences<KeyType> fences_;
   // Flexible array member for page data.
   MappingType array_[0];
-  void SetItem(int index, std::pair<KeyType, ValueType> item);
 };
 }  // namespace bustub
@@ -0,0 +1,153 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_key_search.h
+//
+// Identification: src/include/storage/page/b_plus_tree_key_search.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+
+#include "storage/index/generic_key.h"
+
+namespace bustub {
+
+/**
+ * Whether B+ tree pages keep the keys of a page apart from its values, in an array of their own, instead of storing
+ * each key next to its value. A search then only reads keys, packed into as few cache lines as they fit in, and can
+ * compare several of them at once; keys that fit in a machine word are laid out this way, larger keys are not.
+ */
+template <typename KeyType>
+struct BPlusTreeSplitLayout : std::false_type {};
+
+template <>
+struct BPlusTreeSplitLayout<GenericKey<4>> : std::true_type {};
+
+template <>
+struct BPlusTreeSplitLayout<GenericKey<8>> : std::true_type {};
+
+/**
+ * BPlusTreeKeySearch searches the sorted keys of a B+ tree page laid out apart from their values, when they are
+ * GenericKey<4> or GenericKey<8> ordered by GenericComparator. Such keys compare like big-endian unsigned integers, so
+ * they are loaded as native integers, with the sign bit flipped to compare them as signed ones. A binary search narrows
+ * the range down to a couple of cache lines, and the keys left are all compared with the one searched for, with AVX2 or
+ * SSE4.2 if the build targets it, and without branching otherwise.
+ */
+template <size_t KeySize>
+class BPlusTreeKeySearch {
+  static_assert(KeySize == 4 || KeySize == 8, "only keys of 4 or 8 bytes compare as integers");
+
+ public:
+  using Key = GenericKey<KeySize>;
+
+  /**
+   * @return the number of keys in keys[0, size) less than key, or not greater than key if inclusive; since the keys
+   * are sorted, the index of the first key at or above key (above key if inclusive)
+   */
+  static auto CountBelow(const Key *keys, int size, const Key &key, bool inclusive) -> int {
+    Word target = Load(key);
+    int lo = 0;
+    int hi = size;
+    while (hi - lo > SCAN_KEYS) {
+      int mid = lo + (hi - lo) / 2;
+      if (IsBelow(Load(keys[mid]), target, inclusive)) {
+        lo = mid + 1;
+      } else {
+        hi = mid;
+      }
+    }
+    return lo + Scan(keys + lo, hi - lo, target, inclusive);
+  }
+
+ private:
+  using Word = std::conditional_t<KeySize == 4, int32_t, int64_t>;
+  using UnsignedWord = std::make_unsigned_t<Word>;
+
+  /** The number of keys left to the linear scan: two cache lines worth of keys. */
+  static constexpr int SCAN_KEYS = 128 / KeySize;
+  static constexpr UnsignedWord SIGN_BIT = UnsignedWord{1} << (KeySize * 8 - 1);
+
+  static auto Load(const Key &key) -> Word {
+    UnsignedWord word;
+    memcpy(&word, key.data_, KeySize);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    if constexpr (KeySize == 4) {
+      word = __builtin_bswap32(word);
+    } else {
+      word = __builtin_bswap64(word);
+    }
+#endif
+    return static_cast<Word>(word ^ SIGN_BIT);
+  }
+
+  static auto IsBelow(Word key, Word target, bool inclusive) -> bool {
+    return inclusive ? key <= target : key < target;
+  }
+
+  /** @return the number of keys in keys[0, size) below target, comparing them all */
+  static auto Scan(const Key *keys, int size, Word target, bool inclusive) -> int {
+    int count = 0;
+    int i = 0;
+#if defined(__AVX2__)
+    constexpr int lanes = 32 / KeySize;
+    const __m256i swap = KeySize == 4 ? _mm256_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12, 3, 2, 1,
+                                                         0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)
+                                      : _mm256_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5,
+                                                         4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    const __m256i sign = KeySize == 4 ? _mm256_set1_epi32(INT32_MIN) : _mm256_set1_epi64x(INT64_MIN);
+    const __m256i pivot = KeySize == 4 ? _mm256_set1_epi32(target) : _mm256_set1_epi64x(target);
+    for (; i + lanes <= size; i += lanes) {
+      __m256i words = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(keys + i));
+      words = _mm256_xor_si256(_mm256_shuffle_epi8(words, swap), sign);
+      // Count the keys above target if inclusive, the keys below it otherwise.
+      __m256i lhs = inclusive ? words : pivot;
+      __m256i rhs = inclusive ? pivot : words;
+      int mask;
+      if constexpr (KeySize == 4) {
+        mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpgt_epi32(lhs, rhs)));
+      } else {
+        mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(lhs, rhs)));
+      }
+      count += inclusive ? lanes - __builtin_popcount(mask) : __builtin_popcount(mask);
+    }
+#elif defined(__SSE4_2__)
+    constexpr int lanes = 16 / KeySize;
+    const __m128i swap = KeySize == 4 ? _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12)
+                                      : _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8);
+    const __m128i sign = KeySize == 4 ? _mm_set1_epi32(INT32_MIN) : _mm_set1_epi64x(INT64_MIN);
+    const __m128i pivot = KeySize == 4 ? _mm_set1_epi32(target) : _mm_set1_epi64x(target);
+    for (; i + lanes <= size; i += lanes) {
+      __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i *>(keys + i));
+      words = _mm_xor_si128(_mm_shuffle_epi8(words, swap), sign);
+      // Count the keys above target if inclusive, the keys below it otherwise.
+      __m128i lhs = inclusive ? words : pivot;
+      __m128i rhs = inclusive ? pivot : words;
+      int mask;
+      if constexpr (KeySize == 4) {
+        mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(lhs, rhs)));
+      } else {
+        mask = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(lhs, rhs)));
+      }
+      count += inclusive ? lanes - __builtin_popcount(mask) : __builtin_popcount(mask);
+    }
+#endif
+    for (; i < size; i++) {
+      count += static_cast<int>(IsBelow(Load(keys[i]), target, inclusive));
+    }
+    return count;
+  }
+};
+
+}  // namespace bustub
@@ -10,16 +10,18 @@
 //===----------------------------------------------------------------------===//
 #pragma once
 
+#include <type_traits>
 #include <utility>
 #include <vector>
 
+#include "storage/page/b_plus_tree_key_search.h"
 #include "storage/page/b_plus_tree_page.h"
 
 namespace bustub {
 
 #define B_PLUS_TREE_LEAF_PAGE_TYPE BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>
-#define LEAF_PAGE_HEADER_SIZE 28
-#define LEAF_PAGE_SIZE ((PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) / sizeof(MappingType))
+#define LEAF_PAGE_HEADER_SIZE (24 + sizeof(BPlusTreeFences<KeyType>))
+#define LEAF_PAGE_SIZE ((PAGE_SIZE - LEAF_PAGE_HEADER_SIZE) / (sizeof(KeyType) + sizeof(ValueType)))
 
 /**
  * Store indexed key and record id(record id = page id combined with slot id,
@@ -31,12 +33,18 @@ namespace bustub {
  * | HEADER | KEY(1) + RID(1) | KEY(2) + RID(2) | ... | KEY(n) + RID(n)
  *  ----------------------------------------------------------------------
  *
- *  Header format (size in byte, 28 bytes in total):
+ * or, for keys laid out apart from their values (see BPlusTreeSplitLayout),
+ * with room for LEAF_PAGE_SIZE keys before the first RID:
+ *  ----------------------------------------------------------------------
+ * | HEADER | KEY(1) | KEY(2) | ... | KEY(n) | ... | RID(1) | ... | RID(n)
+ *  ----------------------------------------------------------------------
+ *
+ *  Header format (size in byte, 24 bytes + fences in total):
  *  ---------------------------------------------------------------------
  * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
  *  ---------------------------------------------------------------------
  *  -----------------------------------------------
- * | ParentPageId (4) | PageId (4) | NextPageId (4)
+ * | PageId (4) | NextPageId (4) | Fences
  *  -----------------------------------------------
  */
 INDEX_TEMPLATE_ARGUMENTS
@@ -44,32 +52,51 @@ class BPlusTreeLeafPage : public BPlusTreePage {
  public:
   // After creating a new leaf page from buffer pool, must call initialize
   // method to set default values
-  void Init(page_id_t page_id, page_id_t parent_id = INVALID_PAGE_ID, int max_size = LEAF_PAGE_SIZE);
+  void Init(page_id_t page_id, int max_size = LEAF_PAGE_SIZE);
+  // the number of key & value pairs a page has room for
+  static constexpr auto Capacity() -> int { return static_cast<int>(LEAF_PAGE_SIZE); }
   // helper methods
   auto GetNextPageId() const -> page_id_t;
   void SetNextPageId(page_id_t next_page_id);
+  auto Fences() const -> const BPlusTreeFences<KeyType> * { return &fences_; }
+  auto Fences() -> BPlusTreeFences<KeyType> * { return &fences_; }
   auto KeyAt(int index) const -> KeyType;
   auto KeyIndex(const KeyType &key, const KeyComparator &comparator) const -> int;
-  auto GetItem(int index) -> const MappingType &;
+  auto GetItem(int index) const -> MappingType;
 
   // insert and delete methods
   auto Insert(const KeyType &key, const ValueType &value, const KeyComparator &comparator) -> int;
   auto Lookup(const KeyType &key, ValueType *value, const KeyComparator &comparator) const -> bool;
   auto RemoveAndDeleteRecord(const KeyType &key, const KeyComparator &comparator) -> int;
+  void Populate(const MappingType *items, int size);
 
   // Split and Merge utility methods
   void MoveHalfTo(BPlusTreeLeafPage *recipient);
-  void MoveAllTo(BPlusTreeLeafPage *recipient, int opt);
+  void MoveAllTo(BPlusTreeLeafPage *recipient);
   void MoveFirstToEndOf(BPlusTreeLeafPage *recipient);
   void MoveLastToFrontOf(BPlusTreeLeafPage *recipient);
 
  private:
-  void CopyNFrom(MappingType *items, int size, int opt);
+  /** Whether the keys are stored apart from the values. */
+  static constexpr bool SPLIT_LAYOUT = BPlusTreeSplitLayout<KeyType>::value;
+  /** Whether the keys are searched with BPlusTreeKeySearch instead of the comparator. */
+  static constexpr bool KEY_SEARCH =
+      SPLIT_LAYOUT && std::is_same_v<KeyComparator, GenericComparator<sizeof(KeyType)>>;
+
+  // The arrays of keys and of values, in the split layout only
+  auto Keys() const -> const KeyType *;
+  auto Keys() -> KeyType *;
+  auto Values() const -> const ValueType *;
+  auto Values() -> ValueType *;
+
+  void SetItem(int index, const MappingType &item);
+  void MoveItems(int from, int to, int count);
+  void CopyNFrom(const BPlusTreeLeafPage *page, int index, int size);
   void CopyLastFrom(const MappingType &item);
   void CopyFirstFrom(const MappingType &item);
   page_id_t next_page_id_;
+  BPlusTreeFences<KeyType> fences_;
   // Flexible array member for page data.
   MappingType array_[0];
-  void SetItem(int index, std::pair<KeyType, ValueType> item);
 };
 }  // namespace bustub
@@ -12,6 +12,7 @@
 
 #include <cassert>
 #include <climits>
+#include <cstdint>
 #include <cstdlib>
 #include <string>
 
@@ -33,17 +34,19 @@ enum class IndexPageType { INVALID_INDEX_PAGE = 0, LEAF_PAGE, INTERNAL_PAGE };
  * It actually serves as a header part for each B+ tree page and
  * contains information shared by both leaf page and internal page.
  *
- * Header format (size in byte, 24 bytes in total):
+ * Pages do not point back to their parents: writers find the parent of a page among the pages they latched on the
+ * way down, so a split or a merge never has to touch the children it moves.
+ *
+ * Header format (size in byte, 20 bytes in total):
  * ----------------------------------------------------------------------------
  * | PageType (4) | LSN (4) | CurrentSize (4) | MaxSize (4) |
  * ----------------------------------------------------------------------------
- * | ParentPageId (4) | PageId(4) |
+ * | PageId(4) |
  * ----------------------------------------------------------------------------
  */
 class BPlusTreePage {
  public:
   auto IsLeafPage() const -> bool;
-  auto IsRootPage() const -> bool;
   void SetPageType(IndexPageType page_type);
 
   auto GetSize() const -> int;
@@ -54,9 +57,6 @@ class BPlusTreePage {
   void SetMaxSize(int max_size);
   auto GetMinSize() const -> int;
 
-  auto GetParentPageId() const -> page_id_t;
-  void SetParentPageId(page_id_t parent_page_id);
-
   auto GetPageId() const -> page_id_t;
   void SetPageId(page_id_t page_id);
 
@@ -68,8 +68,70 @@ class BPlusTreePage {
   lsn_t lsn_ __attribute__((__unused__));
   int size_ __attribute__((__unused__));
   int max_size_ __attribute__((__unused__));
-  page_id_t parent_page_id_ __attribute__((__unused__));
   page_id_t page_id_ __attribute__((__unused__));
 };
 
+/**
+ * The fences of a B+ tree page: the range of keys it covers, [low key, high key), unbounded on the side where it has no
+ * sibling. Together with the link from every page to its right sibling, they make the tree a B-link tree (Lehman and
+ * Yao): a descent that reads a child after its parent, with no latch held in between, can tell from the child alone
+ * whether it got to the right page. A page that split since hands the upper part of its range to its right sibling, so
+ * a key at or above the high key is found by moving right. Pages also merge into and trade items with their left
+ * sibling, which Lehman and Yao do not allow: a key below the low key, or a page that was unlinked by a merge, sends
+ * the descent back to the root instead.
+ *
+ * Format (size in byte, 4 + 2 * sizeof(KeyType) in total):
+ * ----------------------------------------------------------------------------
+ * | Flags (4) | LowKey | HighKey |
+ * ----------------------------------------------------------------------------
+ */
+template <typename KeyType>
+class BPlusTreeFences {
+ public:
+  /** Makes the range unbounded on both sides, for a page that is the only one on its level. */
+  void Init() { flags_ = 0; }
+
+  /** @return true if the page was merged into its left sibling or was the root of an emptied tree */
+  auto IsUnlinked() const -> bool { return (flags_ & UNLINKED) != 0; }
+  void SetUnlinked() { flags_ |= UNLINKED; }
+
+  auto HasLowKey() const -> bool { return (flags_ & HAS_LOW_KEY) != 0; }
+  void SetLowKey(const KeyType &key) {
+    low_key_ = key;
+    flags_ |= HAS_LOW_KEY;
+  }
+
+  void SetHighKey(const KeyType &key) {
+    high_key_ = key;
+    flags_ |= HAS_HIGH_KEY;
+  }
+
+  /** Takes over the upper end of the range of another page, as when taking over its items. */
+  void SetHighKeyOf(const BPlusTreeFences &that) {
+    high_key_ = that.high_key_;
+    flags_ = (flags_ & ~HAS_HIGH_KEY) | (that.flags_ & HAS_HIGH_KEY);
+  }
+
+  /** @return true if key is below the range of the page */
+  template <typename KeyComparator>
+  auto IsBelow(const KeyType &key, const KeyComparator &comparator) const -> bool {
+    return HasLowKey() && comparator(key, low_key_) < 0;
+  }
+
+  /** @return true if key is above the range of the page, and belongs to a page on its right */
+  template <typename KeyComparator>
+  auto IsAbove(const KeyType &key, const KeyComparator &comparator) const -> bool {
+    return (flags_ & HAS_HIGH_KEY) != 0 && comparator(key, high_key_) >= 0;
+  }
+
+ private:
+  static constexpr uint32_t HAS_LOW_KEY = 1;
+  static constexpr uint32_t HAS_HIGH_KEY = 2;
+  static constexpr uint32_t UNLINKED = 4;
+
+  uint32_t flags_;
+  KeyType low_key_;
+  KeyType high_key_;
+};
+
 }  // namespace bustub
@@ -45,7 +45,7 @@ class HashTableBucketPage {
    *
    * @return true if at least one key matched
    */
-  auto GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result) -> bool;
+  auto GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result) const -> bool;
 
   /**
    * Attempts to insert a key and value in the bucket.  Uses the occupied_
@@ -64,7 +64,7 @@ class HashTableBucketPage {
    */
   auto Remove(KeyType key, ValueType value, KeyComparator cmp) -> bool;
 
-  auto FindElement(KeyType key, ValueType value, KeyComparator cmp) -> bool;
+  auto FindElement(KeyType key, ValueType value, KeyComparator cmp) const -> bool;
 
   /**
    * Gets the key at an index in the bucket.
@@ -134,16 +134,16 @@ class HashTableBucketPage {
   /**
    * @return whether the bucket is empty
    */
-  auto IsEmpty() -> bool;
+  auto IsEmpty() const -> bool;
 
   /**
    * Prints the bucket's occupancy information
    */
   void PrintBucket();
 
-  void GetAllPairs(std::vector<MappingType> *vec);
+  void GetAllPairs(std::vector<MappingType> *vec) const;
 
-  size_t GetSize();
+  size_t GetSize() const;
 
   void Clear();
 
@@ -12,8 +12,11 @@
 
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <cstring>
 #include <iostream>
+#include <memory>
 
 #include "common/config.h"
 #include "common/rwlatch.h"
@@ -24,14 +27,21 @@ namespace bustub {
  * Page is the basic unit of storage within the database system. Page provides a wrapper for actual data pages being
  * held in main memory. Page also contains book-keeping information that is used by the buffer pool manager, e.g.
  * pin count, dirty flag, page id, etc.
+ *
+ * The data of a page lives apart from its book-keeping information. The buffer pool keeps the data of its frames in
+ * an arena of PAGE_SIZE-aligned blocks, so that they can be read and written with direct I/O as they are, without
+ * padding every Page to that alignment.
  */
 class Page {
   // There is book-keeping information inside the page that should only be relevant to the buffer pool manager.
   friend class BufferPoolManagerInstance;
 
  public:
-  /** Constructor. Zeros out the page data. */
-  Page() { ResetMemory(); }
+  /** Constructor. The page owns its data, which it zeros out. */
+  Page() : owned_data_(new char[PAGE_SIZE]), data_(owned_data_.get()) { ResetMemory(); }
+
+  /** Constructor. The page uses the given PAGE_SIZE bytes, owned by the caller, as its data, which it zeros out. */
+  explicit Page(char *data) : data_(data) { ResetMemory(); }
 
   /** Default destructor. */
   ~Page() = default;
@@ -48,11 +58,17 @@ class Page {
   /** @return true if the page in memory has been modified from the page on disk, false otherwise */
   inline auto IsDirty() -> bool { return is_dirty_; }
 
-  /** Acquire the page write latch. */
-  inline void WLatch() { rwlatch_.WLock(); }
+  /** Acquire the page write latch. The version of the page is odd until the latch is released. */
+  inline void WLatch() {
+    rwlatch_.WLock();
+    version_.fetch_add(1, std::memory_order_acq_rel);
+  }
 
   /** Release the page write latch. */
-  inline void WUnlatch() { rwlatch_.WUnlock(); }
+  inline void WUnlatch() {
+    version_.fetch_add(1, std::memory_order_release);
+    rwlatch_.WUnlock();
+  }
 
   /** Acquire the page read latch. */
   inline void RLatch() { rwlatch_.RLock(); }
@@ -60,6 +76,19 @@ class Page {
   /** Release the page read latch. */
   inline void RUnlatch() { rwlatch_.RUnlock(); }
 
+  /**
+   * @return the version of the page, which changes every time the page is write-latched and again when it is
+   * released, and likewise when the frame is given to another page. A reader that reads the page without a latch, at
+   * an even version, read a consistent page, still held by the frame, if the version is still the same afterwards.
+   */
+  inline auto GetVersion() -> uint64_t { return version_.load(std::memory_order_acquire); }
+
+  /** @return true if the page has not been write-latched since it was at the given (even) version */
+  inline auto ValidateVersion(uint64_t version) -> bool {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return version_.load(std::memory_order_relaxed) == version;
+  }
+
   /** @return the page LSN. */
   inline auto GetLSN() -> lsn_t { return *reinterpret_cast<lsn_t *>(GetData() + OFFSET_LSN); }
 
@@ -75,19 +104,32 @@ class Page {
   static constexpr size_t OFFSET_LSN = 4;
 
  private:
+  /**
+   * Marks the frame as being given to another page, whose contents are being written into it: the version is odd
+   * until EndReassign(), and readers of the previous page cannot validate what they read.
+   */
+  inline void BeginReassign() { version_.fetch_add(1, std::memory_order_acq_rel); }
+
+  /** Marks the frame as holding its new page. */
+  inline void EndReassign() { version_.fetch_add(1, std::memory_order_release); }
+
   /** Zeroes out the data that is held within the page. */
   inline void ResetMemory() { memset(data_, OFFSET_PAGE_START, PAGE_SIZE); }
 
+  /** The data of the page if the page owns it, or null if it lives in the arena of a buffer pool. */
+  std::unique_ptr<char[]> owned_data_;
   /** The actual data that is stored within a page. */
-  char data_[PAGE_SIZE]{};
-  /** The ID of this page. */
-  page_id_t page_id_ = INVALID_PAGE_ID;
+  char *data_;
+  /** The ID of this page. Atomic so that the buffer pool can inspect frames without holding a page table latch. */
+  std::atomic<page_id_t> page_id_{INVALID_PAGE_ID};
   /** The pin count of this page. */
-  int pin_count_ = 0;
+  std::atomic<int> pin_count_{0};
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
-  bool is_dirty_ = false;
+  std::atomic<bool> is_dirty_{false};
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
+  /** Version of the page, for readers that do not take the latch. */
+  std::atomic<uint64_t> version_{0};
 };
 
 }  // namespace bustub
@@ -0,0 +1,177 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_guard.h
+//
+// Identification: src/include/storage/page/page_guard.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "storage/page/page.h"
+
+namespace bustub {
+
+class BufferPoolManager;
+class ReadPageGuard;
+class WritePageGuard;
+
+/**
+ * BasicPageGuard owns one pin of a page of a buffer pool, and unpins the page when it is dropped or destroyed. Guards
+ * are move-only, so every pin is released exactly once, however the scope that took it is left.
+ *
+ * A guard without a page (default constructed, moved from, dropped, or returned by a buffer pool that is out of
+ * frames) is not valid, and only its destructor, Drop() and IsValid() may be called on it.
+ *
+ * A guard built without a buffer pool does not own a pin: it stands for a page that someone else keeps pinned, and
+ * dropping a read or write guard around it only releases the latch.
+ */
+class BasicPageGuard {
+  friend class ReadPageGuard;
+  friend class WritePageGuard;
+
+ public:
+  BasicPageGuard() = default;
+  BasicPageGuard(BufferPoolManager *bpm, Page *page) : bpm_(bpm), page_(page) {}
+
+  BasicPageGuard(const BasicPageGuard &) = delete;
+  auto operator=(const BasicPageGuard &) -> BasicPageGuard & = delete;
+
+  /** Takes over the pin held by another guard, which becomes invalid. */
+  BasicPageGuard(BasicPageGuard &&that) noexcept;
+
+  /** Drops the pin held by this guard, then takes over the pin held by another guard. */
+  auto operator=(BasicPageGuard &&that) noexcept -> BasicPageGuard &;
+
+  ~BasicPageGuard();
+
+  /** Unpins the page, marking it dirty if it was written through this guard. Dropping twice does nothing. */
+  void Drop();
+
+  /**
+   * Latches the page for reading, and moves the pin into the returned guard. This guard becomes invalid.
+   */
+  auto UpgradeRead() -> ReadPageGuard;
+
+  /**
+   * Latches the page for writing, and moves the pin into the returned guard. This guard becomes invalid.
+   */
+  auto UpgradeWrite() -> WritePageGuard;
+
+  /** @return true if this guard holds a page */
+  auto IsValid() const -> bool { return page_ != nullptr; }
+
+  /** @return the id of the guarded page */
+  auto PageId() const -> page_id_t { return page_->GetPageId(); }
+
+  /** @return the guarded page */
+  auto GetPage() const -> Page * { return page_; }
+
+  auto GetData() const -> const char * { return page_->GetData(); }
+
+  template <class T>
+  auto As() const -> const T * {
+    return reinterpret_cast<const T *>(GetData());
+  }
+
+  /** @return the page data for writing; the page is written back when the guard is dropped */
+  auto GetDataMut() -> char * {
+    is_dirty_ = true;
+    return page_->GetData();
+  }
+
+  template <class T>
+  auto AsMut() -> T * {
+    return reinterpret_cast<T *>(GetDataMut());
+  }
+
+ private:
+  BufferPoolManager *bpm_{nullptr};
+  Page *page_{nullptr};
+  bool is_dirty_{false};
+};
+
+/**
+ * ReadPageGuard owns one pin and the read latch of a page. Dropping it releases the latch, then the pin.
+ */
+class ReadPageGuard {
+  friend class BasicPageGuard;
+
+ public:
+  ReadPageGuard() = default;
+
+  /** Wraps a page that the caller has already pinned (unless bpm is nullptr) and read-latched. */
+  ReadPageGuard(BufferPoolManager *bpm, Page *page) : guard_(bpm, page) {}
+
+  ReadPageGuard(const ReadPageGuard &) = delete;
+  auto operator=(const ReadPageGuard &) -> ReadPageGuard & = delete;
+  ReadPageGuard(ReadPageGuard &&that) noexcept = default;
+  auto operator=(ReadPageGuard &&that) noexcept -> ReadPageGuard &;
+
+  ~ReadPageGuard();
+
+  /** Releases the read latch and the pin. Dropping twice does nothing. */
+  void Drop();
+
+  auto IsValid() const -> bool { return guard_.IsValid(); }
+  auto PageId() const -> page_id_t { return guard_.PageId(); }
+  auto GetPage() const -> Page * { return guard_.GetPage(); }
+  auto GetData() const -> const char * { return guard_.GetData(); }
+
+  template <class T>
+  auto As() const -> const T * {
+    return guard_.As<T>();
+  }
+
+ private:
+  BasicPageGuard guard_;
+};
+
+/**
+ * WritePageGuard owns one pin and the write latch of a page. Dropping it releases the latch, then the pin.
+ */
+class WritePageGuard {
+  friend class BasicPageGuard;
+
+ public:
+  WritePageGuard() = default;
+
+  /** Wraps a page that the caller has already pinned and write-latched. */
+  WritePageGuard(BufferPoolManager *bpm, Page *page) : guard_(bpm, page) {}
+
+  WritePageGuard(const WritePageGuard &) = delete;
+  auto operator=(const WritePageGuard &) -> WritePageGuard & = delete;
+  WritePageGuard(WritePageGuard &&that) noexcept = default;
+  auto operator=(WritePageGuard &&that) noexcept -> WritePageGuard &;
+
+  ~WritePageGuard();
+
+  /** Releases the write latch and the pin, writing the page back if it was modified. Dropping twice does nothing. */
+  void Drop();
+
+  auto IsValid() const -> bool { return guard_.IsValid(); }
+  auto PageId() const -> page_id_t { return guard_.PageId(); }
+  auto GetPage() const -> Page * { return guard_.GetPage(); }
+  auto GetData() const -> const char * { return guard_.GetData(); }
+
+  template <class T>
+  auto As() const -> const T * {
+    return guard_.As<T>();
+  }
+
+  auto GetDataMut() -> char * { return guard_.GetDataMut(); }
+
+  template <class T>
+  auto AsMut() -> T * {
+    return guard_.AsMut<T>();
+  }
+
+ private:
+  BasicPageGuard guard_;
+};
+
+}  // namespace bustub
@@ -14,6 +14,7 @@
 
 #include <cassert>
 
+#include "buffer/buffer_pool_manager.h"
 #include "common/rid.h"
 #include "concurrency/transaction.h"
 #include "storage/table/tuple.h"
@@ -21,6 +22,7 @@
 namespace bustub {
 
 class TableHeap;
+class TablePage;
 
 /**
  * TableIterator enables the sequential scan of a TableHeap.
@@ -32,7 +34,12 @@ class TableIterator {
   TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
 
   TableIterator(const TableIterator &other)
-      : table_heap_(other.table_heap_), tuple_(new Tuple(*other.tuple_)), txn_(other.txn_) {}
+      : table_heap_(other.table_heap_),
+        tuple_(new Tuple(*other.tuple_)),
+        txn_(other.txn_),
+        read_ahead_window_(other.read_ahead_window_),
+        read_ahead_distance_(other.read_ahead_distance_),
+        pages_visited_(other.pages_visited_) {}
 
   ~TableIterator() { delete tuple_; }
 
@@ -54,13 +61,40 @@ class TableIterator {
     table_heap_ = other.table_heap_;
     *tuple_ = *other.tuple_;
     txn_ = other.txn_;
+    read_ahead_window_ = other.read_ahead_window_;
+    read_ahead_distance_ = other.read_ahead_distance_;
+    pages_visited_ = other.pages_visited_;
     return *this;
   }
 
  private:
+  /**
+   * Called whenever the iterator moves on to the next page of the table. Asks the buffer pool to read the pages after
+   * it ahead. The window starts at one page and doubles on every page the scan moves on to, up to
+   * TABLE_SCAN_READ_AHEAD_MAX and a quarter of the buffer pool, so short scans read little ahead and long scans keep a
+   * full window in flight. A new batch is requested once the scan has consumed half of the previous one. Once the scan
+   * uses the scan ring, the window is capped at half of the ring so that read-ahead pages are not recycled before the
+   * scan reaches them.
+   * @param page the page the iterator has just moved to, pinned by the caller
+   */
+  void ReadAhead(TablePage *page);
+
+  /**
+   * A scan fetches its pages as AccessType::SCAN once it has visited more than a quarter of the buffer pool, so that a
+   * large scan recycles the buffer pool's scan ring while the pages of small tables stay cached like any other page.
+   * @return the access type for the next page fetches of this iterator
+   */
+  auto ScanAccessType() -> AccessType;
+
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  /** Number of pages to keep read ahead of the current page. */
+  size_t read_ahead_window_{0};
+  /** Number of pages requested ahead of the current page. */
+  size_t read_ahead_distance_{0};
+  /** Number of pages the iterator has moved on to. */
+  size_t pages_visited_{0};
 };
 
 }  // namespace bustub
@@ -10,11 +10,17 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <cstdlib>
 #include <cstring>
 #include <iostream>
-#include <mutex>  // NOLINT
+#include <memory>
 #include <string>
 #include <thread>  // NOLINT
 
@@ -26,17 +32,32 @@ namespace bustub {
 
 static char *buffer_used;
 
+/**
+ * @return the bounce buffer of the calling thread, an aligned page for direct I/O of unaligned buffers, allocated on
+ * first use and reused afterwards, or nullptr if it could not be allocated
+ */
+static auto BounceBuffer() -> char * {
+  thread_local std::unique_ptr<char, decltype(&std::free)> bounce(nullptr, &std::free);
+  if (bounce == nullptr) {
+    bounce.reset(static_cast<char *>(std::aligned_alloc(PAGE_SIZE, PAGE_SIZE)));
+  }
+  return bounce.get();
+}
+
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
  */
-DiskManager::DiskManager(const std::string &db_file) : file_name_(db_file) {
+DiskManager::DiskManager(const std::string &db_file, size_t segment_size, bool preallocate_segments)
+    : file_name_(db_file), segment_size_(segment_size), preallocate_segments_(preallocate_segments) {
+  assert(segment_size_ % PAGE_SIZE == 0);
   std::string::size_type n = file_name_.rfind('.');
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  free_map_name_ = file_name_.substr(0, n) + ".fsm";
 
   log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
   // directory or file does not exist
@@ -49,27 +70,71 @@ DiskManager::DiskManager(const std::string &db_file) : file_name_(db_file) {
     }
   }
 
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
-    db_io_.clear();
-    // create a new file
-    db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out | std::ios::in);
-    if (!db_io_.is_open()) {
-      throw Exception("can't open db file");
+  // Not every file system supports direct I/O (e.g. tmpfs); fall back to buffered I/O there.
+  direct_io_ = enable_direct_io;
+  db_fd_ = OpenDbFile(db_file);
+  if (db_fd_ < 0 && direct_io_ && errno == EINVAL) {
+    direct_io_ = false;
+    db_fd_ = OpenDbFile(db_file);
+  }
+  // directory does not exist
+  if (db_fd_ < 0) {
+    throw Exception("can't open db file");
+  }
+#ifdef STATX_DIOALIGN
+  struct statx statx_buf;
+  if (direct_io_ && statx(db_fd_, "", AT_EMPTY_PATH, STATX_DIOALIGN, &statx_buf) == 0 &&
+      (statx_buf.stx_mask & STATX_DIOALIGN) != 0 && statx_buf.stx_dio_mem_align > 0) {
+    direct_io_alignment_ = statx_buf.stx_dio_mem_align;
+  }
+#endif
+  PreallocateSegment(db_fd_);
+  segment_fds_.push_back(db_fd_);
+  // The database ends in the last segment: segments are created in order, so the first missing file ends the search.
+  struct stat stat_buf;
+  if (fstat(db_fd_, &stat_buf) == 0) {
+    db_file_size_ = static_cast<uint64_t>(stat_buf.st_size);
+  }
+  for (size_t segment = 1; segment_size_ > 0 && stat(SegmentFileName(segment).c_str(), &stat_buf) == 0; ++segment) {
+    db_file_size_ = static_cast<uint64_t>(segment) * segment_size_ + static_cast<uint64_t>(stat_buf.st_size);
+  }
+  ReadFreeMap();
+  if (enable_io_uring) {
+    io_ring_ = new IoUring(IO_URING_ENTRIES);
+    if (!io_ring_->IsAvailable()) {
+      delete io_ring_;
+      io_ring_ = nullptr;
     }
   }
   buffer_used = nullptr;
 }
 
+DiskManager::~DiskManager() {
+  delete io_ring_;
+  for (int fd : segment_fds_) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
+
 /**
  * Close all file streams
  */
 void DiskManager::ShutDown() {
   {
-    std::scoped_lock scoped_db_io_latch(db_io_latch_);
-    db_io_.close();
+    std::scoped_lock free_guard(free_pages_latch_);
+    WriteFreeMap();
+  }
+  {
+    std::scoped_lock segments_guard(segments_latch_);
+    for (int &fd : segment_fds_) {
+      if (fd >= 0) {
+        close(fd);
+        fd = -1;
+      }
+    }
+    db_fd_ = -1;
   }
   log_io_.close();
 }
@@ -77,49 +142,549 @@ void DiskManager::ShutDown() {
 /**
  * Write the contents of the specified page into disk file
  */
-void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
-  // set write cursor to offset
+auto DiskManager::WritePage(page_id_t page_id, const char *page_data) -> bool {
   num_writes_ += 1;
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
-    LOG_DEBUG("I/O error while writing");
-    return;
+  off_t offset;
+  int fd = LocatePage(page_id, &offset);
+  if (fd < 0) {
+    LOG_DEBUG("I/O error while opening segment");
+    return false;
+  }
+  if (!IsAligned(page_data)) {
+    char *bounce = BounceBuffer();
+    if (bounce == nullptr) {
+      LOG_DEBUG("could not allocate a bounce buffer for writing");
+      return false;
+    }
+    memcpy(bounce, page_data, PAGE_SIZE);
+    page_data = bounce;
+  }
+  size_t written = 0;
+  while (written < PAGE_SIZE) {
+    ssize_t rc = pwrite(fd, page_data + written, PAGE_SIZE - written, offset + written);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    // check for I/O error
+    if (rc <= 0) {
+      LOG_DEBUG("I/O error while writing");
+      return false;
+    }
+    written += rc;
+  }
+  GrowFileSize(page_id);
+  return true;
+}
+
+void DiskManager::GrowFileSize(page_id_t page_id) {
+  // concurrent writers past the end race for the largest offset
+  uint64_t end = (static_cast<uint64_t>(page_id) + 1) * PAGE_SIZE;
+  uint64_t file_size = db_file_size_.load();
+  while (file_size < end && !db_file_size_.compare_exchange_weak(file_size, end)) {
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
 }
 
 /**
  * Read the contents of the specified page into the given memory area
  */
 void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
-  std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  int offset = page_id * PAGE_SIZE;
+  num_reads_ += 1;
   // check if read beyond file length
-  if (offset > GetFileSize(file_name_)) {
+  if (static_cast<uint64_t>(page_id) * PAGE_SIZE > db_file_size_) {
     LOG_DEBUG("I/O error reading past end of file");
-    // std::cerr << "I/O error while reading" << std::endl;
-  } else {
-    // set read cursor to offset
-    db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
-    if (db_io_.bad()) {
+    memset(page_data, 0, PAGE_SIZE);
+    return;
+  }
+  off_t offset;
+  int fd = LocatePage(page_id, &offset);
+  if (fd < 0) {
+    LOG_DEBUG("I/O error while opening segment");
+    return;
+  }
+  char *buf = page_data;
+  if (!IsAligned(page_data)) {
+    buf = BounceBuffer();
+    if (buf == nullptr) {
+      LOG_DEBUG("could not allocate a bounce buffer for reading");
+      return;
+    }
+  }
+  size_t read_count = 0;
+  while (read_count < PAGE_SIZE) {
+    ssize_t rc = pread(fd, buf + read_count, PAGE_SIZE - read_count, offset + read_count);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc < 0) {
       LOG_DEBUG("I/O error while reading");
       return;
     }
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
-      LOG_DEBUG("Read less than a page");
-      db_io_.clear();
-      // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
+    if (rc == 0) {
+      break;
+    }
+    read_count += rc;
+  }
+  // if file ends before reading PAGE_SIZE
+  if (read_count < PAGE_SIZE) {
+    LOG_DEBUG("Read less than a page");
+    memset(buf + read_count, 0, PAGE_SIZE - read_count);
+  }
+  if (buf != page_data) {
+    memcpy(page_data, buf, PAGE_SIZE);
+  }
+}
+
+/**
+ * Start a batch of page reads and writes
+ */
+void DiskManager::SubmitRequests(std::vector<DiskRequest> *requests) {
+  std::unique_lock sq_guard(sq_latch_, std::defer_lock);
+  if (io_ring_ != nullptr) {
+    sq_guard.lock();
+  }
+  for (auto &request : *requests) {
+    request.done_ = false;
+    if (io_ring_ != nullptr && PrepareRequest(&request)) {
+      continue;
+    }
+    if (request.is_write_) {
+      WritePage(request.page_id_, request.data_);
+    } else {
+      ReadPage(request.page_id_, request.data_);
+    }
+    request.done_ = true;
+  }
+  if (io_ring_ != nullptr && !io_ring_->Submit()) {
+    throw Exception("io_uring submission failed");
+  }
+}
+
+auto DiskManager::PrepareRequest(DiskRequest *request) -> bool {
+  // Reads past the end are answered right away, and bounding the requests in flight by the size of the submission
+  // queue keeps the completion queue, which is twice as large, from overflowing. Unaligned buffers need the bounce
+  // buffer of the synchronous path under direct I/O.
+  if ((!request->is_write_ && static_cast<uint64_t>(request->page_id_) * PAGE_SIZE > db_file_size_) ||
+      in_flight_ >= IO_URING_ENTRIES || !IsAligned(request->data_)) {
+    return false;
+  }
+  off_t offset;
+  int fd = LocatePage(request->page_id_, &offset);
+  if (fd < 0) {
+    return false;
+  }
+  auto user_data = reinterpret_cast<uint64_t>(request);
+  auto prepare = [&] {
+    return request->is_write_ ? io_ring_->PrepareWrite(fd, request->data_, PAGE_SIZE, offset, user_data)
+                              : io_ring_->PrepareRead(fd, request->data_, PAGE_SIZE, offset, user_data);
+  };
+  if (!prepare()) {
+    // The submission queue is full of entries the kernel has not seen yet.
+    if (!io_ring_->Submit() || !prepare()) {
+      return false;
+    }
+  }
+  ++in_flight_;
+  if (request->is_write_) {
+    num_writes_ += 1;
+  } else {
+    num_reads_ += 1;
+  }
+  return true;
+}
+
+/**
+ * Wait for a batch of page reads and writes
+ */
+void DiskManager::WaitForRequests(std::vector<DiskRequest> *requests) {
+  if (io_ring_ == nullptr) {
+    return;
+  }
+  auto all_done = [requests] {
+    return std::all_of(requests->begin(), requests->end(), [](const DiskRequest &request) { return request.done_; });
+  };
+  // One waiter at a time blocks in the kernel and reaps the completions for everybody; the others wait until it has
+  // reaped something, or until it leaves and one of them has to take over.
+  std::unique_lock cq_guard(cq_latch_);
+  while (true) {
+    ReapCompletions();
+    if (all_done()) {
+      break;
+    }
+    if (reaping_) {
+      cq_cv_.wait(cq_guard);
+      continue;
+    }
+    reaping_ = true;
+    cq_guard.unlock();
+    io_ring_->WaitForCompletion();
+    cq_guard.lock();
+    reaping_ = false;
+  }
+  cq_cv_.notify_all();
+}
+
+void DiskManager::ReapCompletions() {
+  uint64_t user_data;
+  int32_t result;
+  bool reaped = false;
+  while (io_ring_->PopCompletion(&user_data, &result)) {
+    auto *request = reinterpret_cast<DiskRequest *>(user_data);
+    --in_flight_;
+    if (result == PAGE_SIZE) {
+      if (request->is_write_) {
+        GrowFileSize(request->page_id_);
+      }
+    } else if (!request->is_write_ && result >= 0) {
+      // if file ends before reading PAGE_SIZE
+      memset(request->data_ + result, 0, PAGE_SIZE - result);
+    } else {
+      LOG_DEBUG("I/O error in io_uring request, retrying synchronously");
+      if (request->is_write_) {
+        WritePage(request->page_id_, request->data_);
+      } else {
+        ReadPage(request->page_id_, request->data_);
+      }
+    }
+    request->done_ = true;
+    reaped = true;
+  }
+  if (reaped) {
+    cq_cv_.notify_all();
+  }
+}
+
+/**
+ * Write a batch of pages sorted by page id
+ */
+void DiskManager::WritePages(std::vector<DiskRequest> *writes) {
+  std::sort(writes->begin(), writes->end(),
+            [](const DiskRequest &a, const DiskRequest &b) { return a.page_id_ < b.page_id_; });
+  size_t begin = 0;
+  while (begin < writes->size()) {
+    DiskRequest *first = &(*writes)[begin];
+    off_t offset;
+    int fd = IsAligned(first->data_) ? LocatePage(first->page_id_, &offset) : -1;
+    if (fd < 0) {
+      // Unaligned buffers need the bounce buffer of WritePage(), which also reports errors.
+      first->done_ = WritePage(first->page_id_, first->data_);
+      ++begin;
+      continue;
+    }
+    // A run ends at a gap between page ids, at an unaligned buffer and at the end of a segment.
+    size_t end = begin + 1;
+    while (end < writes->size() && end - begin < MAX_PAGES_PER_WRITE) {
+      const DiskRequest &request = (*writes)[end];
+      uint64_t position = static_cast<uint64_t>(request.page_id_) * PAGE_SIZE;
+      if (request.page_id_ != (*writes)[end - 1].page_id_ + 1 || !IsAligned(request.data_) ||
+          (segment_size_ > 0 && position % segment_size_ == 0)) {
+        break;
+      }
+      ++end;
+    }
+    WriteRun(fd, offset, first, end - begin);
+    begin = end;
+  }
+}
+
+void DiskManager::WriteRun(int fd, off_t offset, DiskRequest *first, size_t count) {
+  std::vector<iovec> iov(count);
+  for (size_t i = 0; i < count; ++i) {
+    iov[i].iov_base = first[i].data_;
+    iov[i].iov_len = PAGE_SIZE;
+  }
+  iovec *next = iov.data();
+  int remaining = static_cast<int>(count);
+  while (remaining > 0) {
+    ssize_t rc = pwritev(fd, next, remaining, offset);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    // check for I/O error
+    if (rc <= 0) {
+      LOG_DEBUG("I/O error while writing");
+      break;
+    }
+    offset += rc;
+    // skip the pages that are written completely and resume within a partially written one
+    while (remaining > 0 && static_cast<size_t>(rc) >= next->iov_len) {
+      rc -= next->iov_len;
+      ++next;
+      --remaining;
+    }
+    if (rc > 0) {
+      next->iov_base = static_cast<char *>(next->iov_base) + rc;
+      next->iov_len -= rc;
+    }
+  }
+  // After an I/O error, the pages from the one that was partially written on are not done.
+  size_t written = count - remaining;
+  num_writes_ += static_cast<int>(written);
+  if (written > 0) {
+    GrowFileSize(first[written - 1].page_id_);
+  }
+  for (size_t i = 0; i < written; ++i) {
+    first[i].done_ = true;
+  }
+}
+
+/**
+ * Sync all the database files
+ */
+void DiskManager::SyncPages() {
+  std::shared_lock segments_guard(segments_latch_);
+  for (int fd : segment_fds_) {
+    if (fd >= 0 && fdatasync(fd) != 0) {
+      LOG_DEBUG("I/O error while syncing");
+    }
+  }
+  segments_guard.unlock();
+  std::scoped_lock free_guard(free_pages_latch_);
+  WriteFreeMap();
+}
+
+/**
+ * Free a page for reuse
+ */
+void DiskManager::DeallocatePage(page_id_t page_id) {
+  if (page_id < 0 || page_id >= GetNumPages()) {
+    return;
+  }
+  std::scoped_lock free_guard(free_pages_latch_);
+  AddFreePage(page_id);
+}
+
+void DiskManager::AddFreePage(page_id_t page_id) {
+  if (free_pages_[static_cast<uint32_t>(page_id) % free_stride_].insert(page_id).second) {
+    ++num_free_pages_;
+    free_map_dirty_ = true;
+  }
+}
+
+/**
+ * Take a free page for reuse
+ */
+auto DiskManager::AllocateFreePage(uint32_t stride, uint32_t offset) -> page_id_t {
+  std::scoped_lock free_guard(free_pages_latch_);
+  // The stride is the same on every call but the first, as the number of buffer pool instances does not change.
+  if (stride != free_stride_) {
+    SetFreeStride(stride);
+  }
+  auto &free_pages = free_pages_[offset];
+  if (free_pages.empty()) {
+    return INVALID_PAGE_ID;
+  }
+  page_id_t page_id = *free_pages.begin();
+  free_pages.erase(free_pages.begin());
+  --num_free_pages_;
+  free_map_dirty_ = true;
+  return page_id;
+}
+
+void DiskManager::SetFreeStride(uint32_t stride) {
+  std::vector<std::set<page_id_t>> free_pages(stride);
+  for (auto &residue_pages : free_pages_) {
+    for (page_id_t page_id : residue_pages) {
+      free_pages[static_cast<uint32_t>(page_id) % stride].insert(page_id);
+    }
+  }
+  free_pages_ = std::move(free_pages);
+  free_stride_ = stride;
+}
+
+auto DiskManager::GetNumFreePages() -> size_t {
+  std::scoped_lock free_guard(free_pages_latch_);
+  return num_free_pages_;
+}
+
+/**
+ * Reserve disk space for a new page
+ */
+void DiskManager::ReservePage(page_id_t page_id) {
+  page_id_t num_reserved = num_reserved_pages_.load();
+  while (num_reserved <= page_id && !num_reserved_pages_.compare_exchange_weak(num_reserved, page_id + 1)) {
+  }
+  if (page_id < preallocated_end_) {
+    return;
+  }
+  std::scoped_lock extent_guard(extent_latch_);
+  if (page_id < preallocated_end_) {
+    return;
+  }
+  page_id_t begin = std::max(preallocated_end_.load(), GetNumFilePages());
+  page_id_t end = (page_id / EXTENT_SIZE + 1) * EXTENT_SIZE;
+#ifdef __linux__
+  // Preallocated segments have their disk space already.
+  while (begin < end && !preallocate_segments_) {
+    off_t offset;
+    int fd = LocatePage(begin, &offset);
+    if (fd < 0) {
+      break;
+    }
+    uint64_t length = static_cast<uint64_t>(end - begin) * PAGE_SIZE;
+    if (segment_size_ > 0) {
+      length = std::min<uint64_t>(length, segment_size_ - offset);
+    }
+    // The file size stays as it is, so reading a reserved page that was never written still reads zeroes. File
+    // systems without fallocate support simply allocate on write.
+    fallocate(fd, FALLOC_FL_KEEP_SIZE, offset, static_cast<off_t>(length));
+    begin += static_cast<page_id_t>(length / PAGE_SIZE);
+  }
+#endif
+  preallocated_end_ = end;
+}
+
+/**
+ * Truncate the free pages at the end of the database
+ */
+auto DiskManager::Compact() -> size_t {
+  std::scoped_lock free_guard(free_pages_latch_);
+  const page_id_t num_pages = GetNumFilePages();
+  // Free pages past the end were truncated before.
+  page_id_t end = num_pages;
+  while (end > 0 && IsFree(end - 1)) {
+    --end;
+  }
+  if (end == num_pages) {
+    return 0;
+  }
+  off_t offset;
+  // Open every segment up to the end, so that none of them is left behind on disk.
+  if (LocatePage(num_pages - 1, &offset) < 0) {
+    LOG_DEBUG("I/O error while opening segment");
+    return 0;
+  }
+  uint64_t size = static_cast<uint64_t>(end) * PAGE_SIZE;
+  std::scoped_lock segments_guard(segments_latch_);
+  if (segment_size_ > 0) {
+    while (segment_fds_.size() > 1 && (segment_fds_.size() - 1) * segment_size_ >= size) {
+      close(segment_fds_.back());
+      unlink(SegmentFileName(segment_fds_.size() - 1).c_str());
+      segment_fds_.pop_back();
+    }
+    size -= (segment_fds_.size() - 1) * segment_size_;
+  }
+  if (ftruncate(segment_fds_.back(), static_cast<off_t>(size)) != 0) {
+    LOG_DEBUG("I/O error while truncating");
+    return 0;
+  }
+  db_file_size_ = static_cast<uint64_t>(end) * PAGE_SIZE;
+  // Truncation also releases the disk space preallocated past the end.
+  preallocated_end_ = std::min(preallocated_end_.load(), end);
+  return num_pages - end;
+}
+
+void DiskManager::ReadFreeMap() {
+  std::ifstream free_map(free_map_name_, std::ios::binary);
+  if (!free_map.is_open()) {
+    return;
+  }
+  const page_id_t num_pages = GetNumFilePages();
+  char byte;
+  for (page_id_t page_id = 0; page_id < num_pages && free_map.get(byte); page_id += 8) {
+    for (page_id_t bit = 0; bit < 8 && page_id + bit < num_pages; ++bit) {
+      if ((byte >> bit & 1) != 0) {
+        AddFreePage(page_id + bit);
+      }
     }
   }
+  free_map_dirty_ = false;
+}
+
+void DiskManager::WriteFreeMap() {
+  if (!free_map_dirty_) {
+    return;
+  }
+  if (num_free_pages_ == 0) {
+    remove(free_map_name_.c_str());
+    free_map_dirty_ = false;
+    return;
+  }
+  page_id_t last = 0;
+  for (const auto &residue_pages : free_pages_) {
+    if (!residue_pages.empty()) {
+      last = std::max(last, *residue_pages.rbegin());
+    }
+  }
+  std::vector<char> bitmap(last / 8 + 1);
+  for (const auto &residue_pages : free_pages_) {
+    for (page_id_t page_id : residue_pages) {
+      bitmap[page_id / 8] = static_cast<char>(bitmap[page_id / 8] | 1 << page_id % 8);
+    }
+  }
+  // Replace the bitmap with a rename, so that a crash leaves either the old or the new one behind.
+  std::string tmp_name = free_map_name_ + ".tmp";
+  int fd = open(tmp_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0) {
+    LOG_DEBUG("I/O error while writing free map");
+    return;
+  }
+  size_t written = 0;
+  while (written < bitmap.size()) {
+    ssize_t rc = write(fd, bitmap.data() + written, bitmap.size() - written);
+    if (rc < 0 && errno == EINTR) {
+      continue;
+    }
+    if (rc <= 0) {
+      break;
+    }
+    written += rc;
+  }
+  bool ok = written == bitmap.size() && fdatasync(fd) == 0;
+  close(fd);
+  if (!ok || rename(tmp_name.c_str(), free_map_name_.c_str()) != 0) {
+    LOG_DEBUG("I/O error while writing free map");
+    return;
+  }
+  free_map_dirty_ = false;
+}
+
+auto DiskManager::OpenDbFile(const std::string &file_name) -> int {
+  return open(file_name.c_str(), O_RDWR | O_CREAT | (direct_io_ ? O_DIRECT : 0), 0644);
+}
+
+auto DiskManager::SegmentFileName(size_t segment) const -> std::string {
+  return segment == 0 ? file_name_ : file_name_ + "." + std::to_string(segment);
+}
+
+auto DiskManager::LocatePage(page_id_t page_id, off_t *offset) -> int {
+  uint64_t position = static_cast<uint64_t>(page_id) * PAGE_SIZE;
+  if (segment_size_ == 0) {
+    *offset = static_cast<off_t>(position);
+    return db_fd_;
+  }
+  size_t segment = position / segment_size_;
+  *offset = static_cast<off_t>(position % segment_size_);
+  {
+    std::shared_lock segments_guard(segments_latch_);
+    if (segment < segment_fds_.size()) {
+      return segment_fds_[segment];
+    }
+  }
+  return OpenSegment(segment);
+}
+
+auto DiskManager::OpenSegment(size_t segment) -> int {
+  std::scoped_lock segments_guard(segments_latch_);
+  while (segment_fds_.size() <= segment) {
+    int fd = OpenDbFile(SegmentFileName(segment_fds_.size()));
+    if (fd < 0) {
+      return -1;
+    }
+    PreallocateSegment(fd);
+    segment_fds_.push_back(fd);
+  }
+  return segment_fds_[segment];
+}
+
+void DiskManager::PreallocateSegment(int fd) {
+  if (!preallocate_segments_ || segment_size_ == 0) {
+    return;
+  }
+#ifdef __linux__
+  // Reserve the blocks of the whole segment without changing its size, so the cached database size stays exact. File
+  // systems without fallocate support simply allocate on write.
+  fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(segment_size_));
+#endif
 }
 
 /**
@@ -194,6 +759,11 @@ auto DiskManager::GetNumFlushes() const -> int { return num_flushes_; }
  */
 auto DiskManager::GetNumWrites() const -> int { return num_writes_; }
 
+/**
+ * Returns number of Reads made so far
+ */
+auto DiskManager::GetNumReads() const -> int { return num_reads_; }
+
 /**
  * Returns true if the log is currently being flushed
  */
@@ -0,0 +1,184 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// io_uring.cpp
+//
+// Identification: src/storage/disk/io_uring.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/io_uring.h"
+
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <thread>  // NOLINT
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#define BUSTUB_HAVE_IO_URING 1
+#endif
+
+namespace bustub {
+
+#ifdef BUSTUB_HAVE_IO_URING
+
+template <typename T>
+static auto RingPointer(void *ring, uint32_t offset) -> T * {
+  return reinterpret_cast<T *>(static_cast<char *>(ring) + offset);
+}
+
+IoUring::IoUring(uint32_t entries) {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+  if (ring_fd < 0) {
+    return;
+  }
+  // IORING_FEAT_RW_CUR_POS came with IORING_OP_READ/IORING_OP_WRITE in Linux 5.6.
+  const uint32_t required = IORING_FEAT_SINGLE_MMAP | IORING_FEAT_NODROP | IORING_FEAT_RW_CUR_POS;
+  if ((params.features & required) != required) {
+    close(ring_fd);
+    return;
+  }
+  // With IORING_FEAT_SINGLE_MMAP the submission and completion rings share one mapping.
+  ring_size_ = std::max(params.sq_off.array + params.sq_entries * sizeof(uint32_t),
+                        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+  ring_ = mmap(nullptr, ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+  if (ring_ == MAP_FAILED) {
+    ring_ = nullptr;
+    close(ring_fd);
+    return;
+  }
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+  if (sqes_ == MAP_FAILED) {
+    sqes_ = nullptr;
+    munmap(ring_, ring_size_);
+    ring_ = nullptr;
+    close(ring_fd);
+    return;
+  }
+  sq_head_ = RingPointer<uint32_t>(ring_, params.sq_off.head);
+  sq_tail_ = RingPointer<uint32_t>(ring_, params.sq_off.tail);
+  sq_mask_ = *RingPointer<uint32_t>(ring_, params.sq_off.ring_mask);
+  sq_array_ = RingPointer<uint32_t>(ring_, params.sq_off.array);
+  cq_head_ = RingPointer<uint32_t>(ring_, params.cq_off.head);
+  cq_tail_ = RingPointer<uint32_t>(ring_, params.cq_off.tail);
+  cq_mask_ = *RingPointer<uint32_t>(ring_, params.cq_off.ring_mask);
+  cqes_ = RingPointer<void>(ring_, params.cq_off.cqes);
+  ring_fd_ = ring_fd;
+}
+
+IoUring::~IoUring() {
+  if (ring_fd_ < 0) {
+    return;
+  }
+  munmap(sqes_, sqes_size_);
+  munmap(ring_, ring_size_);
+  close(ring_fd_);
+}
+
+auto IoUring::Prepare(uint8_t opcode, int fd, uint64_t addr, uint32_t len, uint64_t offset, uint64_t user_data)
+    -> bool {
+  // Only this side writes the tail, but the kernel advances the head as it consumes entries.
+  uint32_t tail = *sq_tail_ + sq_pending_;
+  if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) > sq_mask_) {
+    return false;
+  }
+  uint32_t index = tail & sq_mask_;
+  auto *sqe = static_cast<io_uring_sqe *>(sqes_) + index;
+  memset(sqe, 0, sizeof(*sqe));
+  sqe->opcode = opcode;
+  sqe->fd = fd;
+  sqe->addr = addr;
+  sqe->len = len;
+  sqe->off = offset;
+  sqe->user_data = user_data;
+  sq_array_[index] = index;
+  ++sq_pending_;
+  return true;
+}
+
+auto IoUring::PrepareRead(int fd, char *buf, uint32_t len, uint64_t offset, uint64_t user_data) -> bool {
+  return Prepare(IORING_OP_READ, fd, reinterpret_cast<uint64_t>(buf), len, offset, user_data);
+}
+
+auto IoUring::PrepareWrite(int fd, const char *buf, uint32_t len, uint64_t offset, uint64_t user_data) -> bool {
+  return Prepare(IORING_OP_WRITE, fd, reinterpret_cast<uint64_t>(buf), len, offset, user_data);
+}
+
+auto IoUring::Submit() -> bool {
+  if (sq_pending_ == 0) {
+    return true;
+  }
+  // Publish the new entries before telling the kernel about them.
+  uint32_t to_submit = sq_pending_;
+  sq_pending_ = 0;
+  __atomic_store_n(sq_tail_, *sq_tail_ + to_submit, __ATOMIC_RELEASE);
+  while (to_submit > 0) {
+    int submitted = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_, to_submit, 0, 0, nullptr, 0));
+    if (submitted < 0) {
+      if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+        std::this_thread::yield();
+        continue;
+      }
+      return false;
+    }
+    to_submit -= submitted;
+  }
+  return true;
+}
+
+void IoUring::WaitForCompletion() {
+  while (syscall(__NR_io_uring_enter, ring_fd_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 && errno == EINTR) {
+  }
+}
+
+auto IoUring::PopCompletion(uint64_t *user_data, int32_t *result) -> bool {
+  uint32_t head = *cq_head_;
+  if (head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+    return false;
+  }
+  const auto *cqe = static_cast<io_uring_cqe *>(cqes_) + (head & cq_mask_);
+  *user_data = cqe->user_data;
+  *result = cqe->res;
+  // Hand the entry back to the kernel only after it has been read.
+  __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+  return true;
+}
+
+#else
+
+IoUring::IoUring(uint32_t entries) {}
+
+IoUring::~IoUring() = default;
+
+auto IoUring::Prepare(uint8_t opcode, int fd, uint64_t addr, uint32_t len, uint64_t offset, uint64_t user_data)
+    -> bool {
+  return false;
+}
+
+auto IoUring::PrepareRead(int fd, char *buf, uint32_t len, uint64_t offset, uint64_t user_data) -> bool {
+  return false;
+}
+
+auto IoUring::PrepareWrite(int fd, const char *buf, uint32_t len, uint64_t offset, uint64_t user_data) -> bool {
+  return false;
+}
+
+auto IoUring::Submit() -> bool { return false; }
+
+void IoUring::WaitForCompletion() {}
+
+auto IoUring::PopCompletion(uint64_t *user_data, int32_t *result) -> bool { return false; }
+
+#endif
+
+}  // namespace bustub
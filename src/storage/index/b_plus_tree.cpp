@@ -9,7 +9,10 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <string>
+#include <type_traits>
+#include <utility>
 
 #include "common/exception.h"
 #include "common/logger.h"
@@ -25,8 +28,15 @@ BPLUSTREE_TYPE::BPlusTree(std::string name, BufferPoolManager *buffer_pool_manag
       root_page_id_(INVALID_PAGE_ID),
       buffer_pool_manager_(buffer_pool_manager),
       comparator_(comparator),
-      leaf_max_size_(leaf_max_size),
-      internal_max_size_(internal_max_size) {
+      leaf_max_size_(std::min(leaf_max_size, LeafPage::Capacity())),
+      // An internal page of max size 3 splits into a page with a single child, which has no sibling to merge with.
+      internal_max_size_(std::clamp(internal_max_size, 4, InternalPage::Capacity())),
+      // Leave most of the buffer pool to the leaves and to the other users of the pool.
+      swizzle_table_(buffer_pool_manager, buffer_pool_manager->GetPoolSize() / 8, internal_max_size_),
+      // The pages left when the tree is destroyed are released then, unless the buffer pool is already gone.
+      epochs_([buffer_pool_manager, pins = buffer_pool_manager->GetLongPinBudget()](page_id_t page_id) {
+        return pins->IsClosed() || buffer_pool_manager->DeletePage(page_id);
+      }) {
   UpdateRootPageId();
 }
 
@@ -45,23 +55,17 @@ auto BPLUSTREE_TYPE::IsEmpty() const -> bool { return root_page_id_ == INVALID_P
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result, Transaction *transaction) -> bool {
-  auto leaf_page = FindLeafPage(key, 0);
-  if (transaction->GetLastPageSetElement()->GetPageId() != leaf_page->GetPageId()) {
-    RLatch(leaf_page);
-  }
-  ValueType res;
-  bool flag = reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *>(leaf_page)->Lookup(key, &res,
-                                                                                                          comparator_);
-  if (transaction->GetLastPageSetElement()->GetPageId() == leaf_page->GetPageId()) {
-    transaction->DeleteLastPageSetElement();
-    RUnLatch(leaf_page);
-  }
-  buffer_pool_manager_->UnpinPage(leaf_page->GetPageId(), false);
-  if (flag) {
-    result->push_back(res);
-    return true;
+  EpochManager::Guard epoch(&epochs_);
+  ReadPageGuard leaf_guard = FindLeafRead(key);
+  if (!leaf_guard.IsValid()) {
+    return false;
+  }
+  ValueType value;
+  if (!leaf_guard.As<LeafPage>()->Lookup(key, &value, comparator_)) {
+    return false;
   }
-  return false;
+  result->push_back(value);
+  return true;
 }
 
 /*****************************************************************************
@@ -76,14 +80,40 @@ auto BPLUSTREE_TYPE::GetValue(const KeyType &key, std::vector<ValueType> *result
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transaction *transaction) -> bool {
+  EpochManager::Guard epoch(&epochs_);
+  // Most inserts only touch their leaf: reach it without latching the pages above.
+  for (int attempt = 0; attempt < OPTIMISTIC_ATTEMPTS; attempt++) {
+    OptimisticPage leaf;
+    bool is_root;
+    if (!FindLeafOptimistic(key, false, &leaf, &is_root)) {
+      continue;
+    }
+    if (leaf.page_ == nullptr) {
+      break;
+    }
+    WritePageGuard leaf_guard = leaf.pin_.UpgradeWrite();
+    if (leaf_guard.GetPage()->GetVersion() != leaf.version_ + 1) {
+      continue;
+    }
+    ValueType existing_value;
+    if (leaf_guard.As<LeafPage>()->Lookup(key, &existing_value, comparator_)) {
+      return false;
+    }
+    if (!IsSafe(leaf_guard.As<BPlusTreePage>(), Operation::INSERT, is_root)) {
+      break;
+    }
+    leaf_guard.AsMut<LeafPage>()->Insert(key, value, comparator_);
+    return true;
+  }
+
+  Context ctx;
+  ctx.root_lock_ = std::unique_lock<std::mutex>(root_latch_);
   if (IsEmpty()) {
     StartNewTree(key, value);
     return true;
   }
-  auto leaf_page = FindLeafPage(key, 1, transaction);
-  bool flag = InsertIntoLeaf(leaf_page, key, value, transaction);
-
-  return flag;
+  FindLeafWrite(key, Operation::INSERT, &ctx);
+  return InsertIntoLeaf(key, value, &ctx);
 }
 
 /*
@@ -94,43 +124,37 @@ auto BPLUSTREE_TYPE::Insert(const KeyType &key, const ValueType &value, Transact
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::StartNewTree(const KeyType &key, const ValueType &value) {
-  auto new_root_page = reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *>(
-      buffer_pool_manager_->NewPage(&root_page_id_, nullptr)->GetData());
-  new_root_page->Init(root_page_id_, INVALID_PAGE_ID, leaf_max_size_);
-  new_root_page->SetPageType(IndexPageType::LEAF_PAGE);
-  new_root_page->SetNextPageId(INVALID_PAGE_ID);
+  page_id_t root_page_id;
+  WritePageGuard root_guard = NewGuardedPage(&root_page_id);
+  auto *root = root_guard.AsMut<LeafPage>();
+  root->Init(root_page_id, leaf_max_size_);
+  root->Insert(key, value, comparator_);
+  root_page_id_ = root_page_id;
   UpdateRootPageId();
-  InsertIntoLeaf(new_root_page, key, value);
 }
 
 /*
- * Insert constant key & value pair into leaf page
- * User needs to first find the right leaf page as insertion target, then look
- * through leaf page to see whether insert key exist or not. If exist, return
- * immdiately, otherwise insert entry. Remember to deal with split if necessary.
+ * Insert constant key & value pair into the leaf page at the end of the write
+ * set. Look through the leaf page to see whether insert key exist or not. If
+ * exist, return immdiately, otherwise insert entry. Remember to deal with split
+ * if necessary.
  * @return: since we only support unique key, if user try to insert duplicate
  * keys return false, otherwise return true.
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::InsertIntoLeaf(BPlusTreePage *node, const KeyType &key, const ValueType &value,
-                                    Transaction *transaction) -> bool {
-  auto leaf_page = reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *>(node);
-  ValueType exist_value;
-  if (leaf_page->Lookup(key, &exist_value, comparator_)) {
-    buffer_pool_manager_->UnpinPage(leaf_page->GetPageId(), false);
+auto BPLUSTREE_TYPE::InsertIntoLeaf(const KeyType &key, const ValueType &value, Context *ctx) -> bool {
+  WritePageGuard &leaf_guard = ctx->write_set_.back();
+  ValueType existing_value;
+  if (leaf_guard.As<LeafPage>()->Lookup(key, &existing_value, comparator_)) {
     return false;
   }
-  auto leaf_page_size = leaf_page->Insert(key, value, comparator_);
-  if (leaf_page_size < leaf_max_size_) {
-    buffer_pool_manager_->UnpinPage(leaf_page->GetPageId(), true);
+  auto *leaf = leaf_guard.AsMut<LeafPage>();
+  if (leaf->Insert(key, value, comparator_) < leaf->GetMaxSize()) {
     return true;
   }
-  auto new_leaf_page = reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *>(Split(leaf_page));
-  new_leaf_page->SetNextPageId(leaf_page->GetNextPageId());
-  leaf_page->SetNextPageId(new_leaf_page->GetPageId());
-  buffer_pool_manager_->UnpinPage(new_leaf_page->GetPageId(), true);
-  buffer_pool_manager_->UnpinPage(leaf_page->GetPageId(), true);
-
+  page_id_t new_page_id;
+  WritePageGuard new_guard = Split(leaf, &new_page_id);
+  InsertIntoParent(new_guard.As<LeafPage>()->KeyAt(0), new_page_id, ctx);
   return true;
 }
 
@@ -142,73 +166,53 @@ auto BPLUSTREE_TYPE::InsertIntoLeaf(BPlusTreePage *node, const KeyType &key, con
  * of key & value pairs from input page to newly created page
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::Split(BPlusTreePage *node) -> BPlusTreePage * {
-  if (node->IsLeafPage()) {
-    page_id_t new_page_id;
-    auto new_page = reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *>(
-        buffer_pool_manager_->NewPage(&new_page_id, nullptr)->GetData());
-    new_page->Init(new_page_id, node->GetParentPageId(), leaf_max_size_);
-    new_page->SetPageType(IndexPageType::LEAF_PAGE);
-    reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *>(node)->MoveHalfTo(new_page);
-    KeyType key = new_page->KeyAt(0);
-    InsertIntoParent(node, key, new_page_id, nullptr);
-
-    return new_page;
-  }
-  page_id_t new_page_id;
-  auto new_page = reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(
-      buffer_pool_manager_->NewPage(&new_page_id, nullptr)->GetData());
-  new_page->Init(new_page_id, node->GetParentPageId(), internal_max_size_);
-  new_page->SetPageType(IndexPageType::INTERNAL_PAGE);
-  auto key = reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(node)->MoveHalfTo(
-      new_page, buffer_pool_manager_);
-  new_page->UpdateParentPageId(buffer_pool_manager_);
-  InsertIntoParent(node, key, new_page_id, nullptr);
-
-  return new_page;
+template <typename N>
+auto BPLUSTREE_TYPE::Split(N *node, page_id_t *new_page_id) -> WritePageGuard {
+  WritePageGuard new_guard = NewGuardedPage(new_page_id);
+  auto *new_node = new_guard.AsMut<N>();
+  new_node->Init(*new_page_id, std::is_same_v<N, LeafPage> ? leaf_max_size_ : internal_max_size_);
+  node->MoveHalfTo(new_node);
+  // The new page is the right sibling of the page, and takes over the upper part of its range.
+  new_node->SetNextPageId(node->GetNextPageId());
+  node->SetNextPageId(*new_page_id);
+  new_node->Fences()->SetLowKey(new_node->KeyAt(0));
+  new_node->Fences()->SetHighKeyOf(*node->Fences());
+  node->Fences()->SetHighKey(new_node->KeyAt(0));
+  return new_guard;
 }
 
 /*
  * Insert key & value pair into internal page after split
- * @param   old_node      input page from split() method
- * @param   key
- * @param   new_node      returned page from split() method
- * User needs to first find the parent page of old_node, parent node must be
- * adjusted to take info of new_node into account. Remember to deal with split
- * recursively if necessary.
- */
-INDEX_TEMPLATE_ARGUMENTS
-void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &key, page_id_t new_page_id,
-                                      Transaction *transaction) {
-  if (old_node->GetPageId() == root_page_id_) {
-    auto new_root_page = reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(
-        buffer_pool_manager_->NewPage(&root_page_id_, nullptr)->GetData());
-    new_root_page->Init(root_page_id_, INVALID_PAGE_ID, internal_max_size_);
-    new_root_page->SetPageType(IndexPageType::INTERNAL_PAGE);
-    new_root_page->PopulateNewRoot(old_node->GetPageId(), key, new_page_id);
+ * @param   key           the first key of the new page
+ * @param   new_page_id   the page returned from split() method
+ * The page that was split is at the end of the write set, right after its
+ * parent. The parent must be adjusted to take info of the new page into
+ * account. Remember to deal with split recursively if necessary.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::InsertIntoParent(const KeyType &key, page_id_t new_page_id, Context *ctx) {
+  // Keep the split page latched until its parent knows about the new page.
+  WritePageGuard old_guard = std::move(ctx->write_set_.back());
+  ctx->write_set_.pop_back();
+  if (ctx->write_set_.empty()) {
+    // The root was split, and the root lock is still held since the root was not safe.
+    page_id_t root_page_id;
+    WritePageGuard root_guard = NewGuardedPage(&root_page_id);
+    auto *root = root_guard.AsMut<InternalPage>();
+    root->Init(root_page_id, internal_max_size_);
+    root->PopulateNewRoot(old_guard.PageId(), key, new_page_id);
+    root_page_id_ = root_page_id;
     UpdateRootPageId();
-    old_node->SetParentPageId(root_page_id_);
-    buffer_pool_manager_->UnpinPage(root_page_id_, true);
-    auto new_page = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(new_page_id));
-    new_page->SetParentPageId(root_page_id_);
-    buffer_pool_manager_->UnpinPage(new_page_id, true);
-    if (!old_node->IsLeafPage()) {
-      buffer_pool_manager_->UnpinPage(old_node->GetPageId(), true);
-    }
     return;
   }
-  auto parent_page = reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(
-      buffer_pool_manager_->FetchPage(old_node->GetParentPageId()));
-  if (!old_node->IsLeafPage()) {
-    buffer_pool_manager_->UnpinPage(old_node->GetPageId(), true);
-  }
-  auto parent_page_size = parent_page->Insert(key, new_page_id, comparator_);
-  if (parent_page_size >= internal_max_size_) {
-    auto new_page = Split(parent_page);
-    buffer_pool_manager_->UnpinPage(new_page->GetPageId(), true);
-  } else {
-    buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), true);
+  WritePageGuard &parent_guard = ctx->write_set_.back();
+  auto *parent = parent_guard.AsMut<InternalPage>();
+  if (parent->InsertNodeAfter(old_guard.PageId(), key, new_page_id) < parent->GetMaxSize()) {
+    return;
   }
+  page_id_t sibling_page_id;
+  WritePageGuard sibling_guard = Split(parent, &sibling_page_id);
+  InsertIntoParent(sibling_guard.As<InternalPage>()->KeyAt(0), sibling_page_id, ctx);
 }
 
 /*****************************************************************************
@@ -223,158 +227,114 @@ void BPLUSTREE_TYPE::InsertIntoParent(BPlusTreePage *old_node, const KeyType &ke
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::Remove(const KeyType &key, Transaction *transaction) {
-  if (IsEmpty()) {
+  EpochManager::Guard epoch(&epochs_);
+  // Most removals only touch their leaf: reach it without latching the pages above.
+  for (int attempt = 0; attempt < OPTIMISTIC_ATTEMPTS; attempt++) {
+    OptimisticPage leaf;
+    bool is_root;
+    if (!FindLeafOptimistic(key, false, &leaf, &is_root)) {
+      continue;
+    }
+    if (leaf.page_ == nullptr) {
+      return;
+    }
+    WritePageGuard leaf_guard = leaf.pin_.UpgradeWrite();
+    if (leaf_guard.GetPage()->GetVersion() != leaf.version_ + 1) {
+      continue;
+    }
+    ValueType value;
+    if (!leaf_guard.As<LeafPage>()->Lookup(key, &value, comparator_)) {
+      return;
+    }
+    if (!IsSafe(leaf_guard.As<BPlusTreePage>(), Operation::REMOVE, is_root)) {
+      break;
+    }
+    leaf_guard.AsMut<LeafPage>()->RemoveAndDeleteRecord(key, comparator_);
     return;
   }
-  auto leaf_page =
-      reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *>(FindLeafPage(key, 2, transaction));
-  auto index = leaf_page->KeyIndex(key, comparator_);
-  if (comparator_(leaf_page->KeyAt(index), key) != 0) {
+
+  Context ctx;
+  ctx.root_lock_ = std::unique_lock<std::mutex>(root_latch_);
+  if (IsEmpty()) {
     return;
   }
-  bool delete_min = false;
-  if (index == 0 && comparator_(leaf_page->KeyAt(index), key) == 0) {
-    delete_min = true;
-  }
-  KeyType min_key = leaf_page->KeyAt(0);
-  auto leaf_page_size = leaf_page->RemoveAndDeleteRecord(key, comparator_);
-
-  if (leaf_page_size >= leaf_page->GetMinSize()) {
-    if (delete_min && leaf_page->GetPageId() != root_page_id_ && leaf_page_size > 0) {
-      auto parent_page = reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(
-          buffer_pool_manager_->FetchPage(leaf_page->GetParentPageId()));
-      int key_index = parent_page->LookupKey(min_key, comparator_);
-      auto last_key = parent_page->KeyAt(key_index);
-      parent_page->SetKeyAt(key_index, leaf_page->KeyAt(0));
-      if (key_index == 0) {
-        RecursiveUpdate(last_key, parent_page->KeyAt(0), parent_page->GetParentPageId());
-      }
-      buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), false);
-    }
-    buffer_pool_manager_->UnpinPage(leaf_page->GetPageId(), true);
+  FindLeafWrite(key, Operation::REMOVE, &ctx);
+  WritePageGuard &leaf_guard = ctx.write_set_.back();
+  ValueType value;
+  if (!leaf_guard.As<LeafPage>()->Lookup(key, &value, comparator_)) {
     return;
   }
-
-  CoalesceOrRedistribute(leaf_page, min_key, transaction);
+  leaf_guard.AsMut<LeafPage>()->RemoveAndDeleteRecord(key, comparator_);
+  CoalesceOrRedistribute<LeafPage>(&ctx);
 }
 
 /*
- * User needs to first find the sibling of input page. If sibling's size + input
- * page's size > page's max size, then redistribute. Otherwise, merge.
+ * Rebalance the page at the end of the write set after it lost an entry. If
+ * its sibling's size + its size fits in one page, then merge. Otherwise,
+ * redistribute.
  * Using template N to represent either internal page or leaf page.
- * @return: true means target leaf page should be deleted, false means no
- * deletion happens
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-auto BPLUSTREE_TYPE::CoalesceOrRedistribute(N *node, KeyType min_key, Transaction *transaction) -> bool {
-  auto node_page = reinterpret_cast<BPlusTreePage *>(node);
-  if (node_page->GetPageId() == root_page_id_) {
-    return AdjustRoot(node_page);
-  }
-  page_id_t left_sibling_page_id = INVALID_PAGE_ID;
-  page_id_t right_sibling_page_id = INVALID_PAGE_ID;
-  int index = 0;
-  auto parent_page = reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(
-      buffer_pool_manager_->FetchPage(node_page->GetParentPageId()));
-  parent_page->FindSiblings(min_key, comparator_, &left_sibling_page_id, &right_sibling_page_id, &index);
-  if (left_sibling_page_id == INVALID_PAGE_ID) {
-    // deal with right_sibling
-    auto right_sibling_page = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(right_sibling_page_id));
-    if (right_sibling_page->GetSize() >= right_sibling_page->GetMinSize() + 1) {
-      // redistribute
-      Redistribute(right_sibling_page, node_page, parent_page, 1, index);
-    } else {
-      Coalesce(right_sibling_page, node_page, parent_page, 1, index, transaction);
-    }
-
-  } else if (right_sibling_page_id == INVALID_PAGE_ID) {
-    // deal with left_sibling
-    auto left_sibling_page = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(left_sibling_page_id));
-    if (left_sibling_page->GetSize() >= left_sibling_page->GetMinSize() + 1) {
-      Redistribute(left_sibling_page, node_page, parent_page, 0, index);
-    } else {
-      Coalesce(left_sibling_page, node_page, parent_page, 0, index, transaction);
+void BPLUSTREE_TYPE::CoalesceOrRedistribute(Context *ctx) {
+  WritePageGuard node_guard = std::move(ctx->write_set_.back());
+  ctx->write_set_.pop_back();
+  if (ctx->write_set_.empty()) {
+    // Either the page was safe, and its ancestors were released on the way down, or it is the root.
+    if (ctx->root_lock_.owns_lock()) {
+      AdjustRoot(&node_guard);
     }
+    return;
+  }
+  auto *node = node_guard.AsMut<N>();
+  WritePageGuard &parent_guard = ctx->write_set_.back();
+  auto *parent = parent_guard.AsMut<InternalPage>();
+  if (node->GetSize() >= node->GetMinSize()) {
+    return;
+  }
+  int index = parent->ValueIndex(node_guard.PageId());
+  WritePageGuard sibling_guard = FetchWrite(parent->ValueAt(index == 0 ? 1 : index - 1));
+  auto *sibling = sibling_guard.AsMut<N>();
+  if (node->GetSize() + sibling->GetSize() >= node->GetMaxSize()) {
+    Redistribute(sibling, node, parent, index);
+    return;
+  }
+  // Always merge the right page into the left one, so no other leaf has to be relinked.
+  page_id_t right_page_id;
+  if (index == 0) {
+    right_page_id = sibling_guard.PageId();
+    Coalesce(node, sibling, parent, 1);
   } else {
-    auto left_sibling_page = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(left_sibling_page_id));
-    if (left_sibling_page->GetSize() >= left_sibling_page->GetMinSize() + 1) {
-      Redistribute(left_sibling_page, node_page, parent_page, 0, index);
-    } else {
-      auto right_sibling_page =
-          reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(right_sibling_page_id));
-      if (right_sibling_page->GetSize() >= right_sibling_page->GetMinSize() + 1) {
-        // redistribute
-        buffer_pool_manager_->UnpinPage(left_sibling_page_id, false);
-        Redistribute(right_sibling_page, node_page, parent_page, 1, index);
-      } else {
-        buffer_pool_manager_->UnpinPage(right_sibling_page_id, false);
-        Coalesce(left_sibling_page, node_page, parent_page, 0, index, transaction);
-      }
-    }
+    right_page_id = node_guard.PageId();
+    Coalesce(sibling, node, parent, index);
   }
-
-  return false;
+  node_guard.Drop();
+  sibling_guard.Drop();
+  FreePage(right_page_id);
+  CoalesceOrRedistribute<InternalPage>(ctx);
 }
 
 /*
- * Move all the key & value pairs from one page to its sibling page, and notify
- * buffer pool manager to delete this page. Parent page must be adjusted to
- * take info of deletion into account. Remember to deal with coalesce or
- * redistribute recursively if necessary.
+ * Move all the key & value pairs from one page to its left sibling page.
+ * Parent page must be adjusted to take info of deletion into account; the
+ * caller deletes the emptied page and rebalances the parent.
  * Using template N to represent either internal page or leaf page.
- * @param   neighbor_node      sibling page of input "node"
- * @param   node               input from method coalesceOrRedistribute()
- * @param   parent             parent page of input "node"
- * @return  true means parent node should be deleted, false means no deletion
- * happend
+ * @param   left_node          left sibling of right_node
+ * @param   right_node         page that is emptied into left_node
+ * @param   parent             parent page of both
+ * @param   index              index of right_node in parent
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-auto BPLUSTREE_TYPE::Coalesce(N *neighbor_node, N *node,
-                              BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *parent, int opt, int index,
-                              Transaction *transaction) -> bool {
-  // opt == 0: coalesce node with his left neighbor; opt == 1: coalesce node with his right neighbor
-  if (node->IsLeafPage()) {
-    auto node_page = reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *>(node);
-    auto neighbor_node_page = reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *>(neighbor_node);
-    node_page->MoveAllTo(neighbor_node_page, opt);
-    if (opt == 0) {
-      neighbor_node_page->SetNextPageId(node_page->GetNextPageId());
-    } else if (index > 0) {
-      auto left_node_page_id = parent->ValueAt(index - 1);
-      auto left_node_page = reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *>(
-          buffer_pool_manager_->FetchPage(left_node_page_id));
-      left_node_page->SetNextPageId(neighbor_node_page->GetPageId());
-      buffer_pool_manager_->UnpinPage(left_node_page_id, true);
-    }
-    RemoveParent(parent, index);
-    auto node_page_id = node_page->GetPageId();
-    buffer_pool_manager_->UnpinPage(node_page_id, true);
-    buffer_pool_manager_->DeletePage(node_page_id);
-    buffer_pool_manager_->UnpinPage(neighbor_node_page->GetPageId(), true);
+void BPLUSTREE_TYPE::Coalesce(N *left_node, N *right_node, InternalPage *parent, int index) {
+  if constexpr (std::is_same_v<N, LeafPage>) {
+    right_node->MoveAllTo(left_node);
   } else {
-    // coalesce internal node
-    auto node_page = reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(node);
-    auto neighbor_node_page =
-        reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(neighbor_node);
-    auto node_page_id = node_page->GetPageId();
-    node_page->UpdateNewParentId(neighbor_node_page->GetPageId(), buffer_pool_manager_);
-    if (opt == 0) {
-      node_page->MoveAllTo(neighbor_node_page, parent->KeyAt(index), opt);
-      RemoveParent(parent, index);
-    } else {
-      node_page->MoveAllTo(neighbor_node_page, parent->KeyAt(index + 1), opt);
-      parent->SetValueAt(index, neighbor_node_page->GetPageId());
-      RemoveParent(parent, index + 1);
-    }
-    // TODO:fix it
-    buffer_pool_manager_->UnpinPage(node_page_id, true);
-    buffer_pool_manager_->DeletePage(node_page_id);
-    buffer_pool_manager_->UnpinPage(neighbor_node_page->GetPageId(), true);
+    right_node->MoveAllTo(left_node, parent->KeyAt(index));
   }
-
-  return false;
+  left_node->Fences()->SetHighKeyOf(*right_node->Fences());
+  right_node->Fences()->SetUnlinked();
+  parent->Remove(index);
 }
 
 /*
@@ -385,72 +345,33 @@ auto BPLUSTREE_TYPE::Coalesce(N *neighbor_node, N *node,
  * Using template N to represent either internal page or leaf page.
  * @param   neighbor_node      sibling page of input "node"
  * @param   node               input from method coalesceOrRedistribute()
+ * @param   parent             parent page of both
+ * @param   index              index of node in parent
  */
 INDEX_TEMPLATE_ARGUMENTS
 template <typename N>
-void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node,
-                                  BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *parent_page, int opt,
-                                  int index) {
-  // opt == 0:redistribute with left sibling; opt == 1:redistribute with right sibling
-
-  if (neighbor_node->IsLeafPage()) {
-    auto neighbor_node_page = reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *>(neighbor_node);
-    auto node_page = reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *>(node);
-    if (opt == 0) {
-      neighbor_node_page->MoveLastToFrontOf(node_page);
-      bool is_change = comparator_(neighbor_node_page->KeyAt(0), parent_page->KeyAt(index - 1)) != 0;
-      auto last_key = parent_page->KeyAt(index - 1);
-      parent_page->SetKeyAt(index - 1, neighbor_node_page->KeyAt(0));
-      if (index - 1 == 0 && is_change) {
-        RecursiveUpdate(last_key, parent_page->KeyAt(0), parent_page->GetParentPageId());
-      }
+void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node, InternalPage *parent, int index) {
+  if (index == 0) {
+    if constexpr (std::is_same_v<N, LeafPage>) {
+      neighbor_node->MoveFirstToEndOf(node);
     } else {
-      neighbor_node_page->MoveFirstToEndOf(node_page);
-      parent_page->SetKeyAt(index + 1, neighbor_node_page->KeyAt(0));
-    }
-    bool is_change = comparator_(node_page->KeyAt(0), parent_page->KeyAt(index)) != 0;
-    auto last_key = parent_page->KeyAt(index);
-    parent_page->SetKeyAt(index, node_page->KeyAt(0));
-    if (index == 0 && is_change) {
-      RecursiveUpdate(last_key, parent_page->KeyAt(0), parent_page->GetParentPageId());
+      neighbor_node->MoveFirstToEndOf(node, parent->KeyAt(1));
     }
+    parent->SetKeyAt(1, neighbor_node->KeyAt(0));
+    node->Fences()->SetHighKey(neighbor_node->KeyAt(0));
+    neighbor_node->Fences()->SetLowKey(neighbor_node->KeyAt(0));
+    return;
+  }
+  if constexpr (std::is_same_v<N, LeafPage>) {
+    neighbor_node->MoveLastToFrontOf(node);
   } else {
-    // internal node
-    auto neighbor_node_page =
-        reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(neighbor_node);
-    auto node_page = reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(node);
-    if (opt == 1) {
-      index++;
-    }
-    auto parent_key = parent_page->KeyAt(index);
-    auto last_key = parent_page->KeyAt(index);
-    bool is_change = false;
-    if (opt == 1) {
-      auto neighbor_key = neighbor_node_page->KeyAt(1);
-      neighbor_node_page->MoveFirstToEndOf(node_page, buffer_pool_manager_);
-      node_page->SetKeyAt(node_page->GetSize() - 1, parent_key);
-      if (comparator_(last_key, neighbor_key) != 0) {
-        is_change = true;
-      }
-      parent_page->SetKeyAt(index, neighbor_key);
-    } else {
-      auto neighbor_key = neighbor_node_page->KeyAt(neighbor_node_page->GetSize() - 1);
-      neighbor_node_page->MoveLastToFrontOf(node_page, buffer_pool_manager_);
-      node_page->SetKeyAt(1, parent_key);
-      if (comparator_(last_key, neighbor_key) != 0) {
-        is_change = true;
-      }
-      parent_page->SetKeyAt(index, neighbor_key);
-    }
-
-    if (index == 0 && is_change) {
-      RecursiveUpdate(last_key, parent_page->KeyAt(0), parent_page->GetParentPageId());
-    }
+    neighbor_node->MoveLastToFrontOf(node, parent->KeyAt(index));
   }
-  buffer_pool_manager_->UnpinPage(neighbor_node->GetPageId(), true);
-  buffer_pool_manager_->UnpinPage(node->GetPageId(), true);
-  buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), true);
+  parent->SetKeyAt(index, node->KeyAt(0));
+  neighbor_node->Fences()->SetHighKey(node->KeyAt(0));
+  node->Fences()->SetLowKey(node->KeyAt(0));
 }
+
 /*
  * Update root page if necessary
  * NOTE: size of root page can be less than min size and this method is only
@@ -458,41 +379,183 @@ void BPLUSTREE_TYPE::Redistribute(N *neighbor_node, N *node,
  * case 1: when you delete the last element in root page, but root page still
  * has one last child
  * case 2: when you delete the last element in whole b+ tree
- * @return : true means root page should be deleted, false means no deletion
- * happend
- */
-INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) -> bool {
-  if (old_root_node->IsLeafPage()) {
-    if (old_root_node->GetSize() == 0) {
-      // delete all the tree
-      auto old_root_node_id = old_root_node->GetPageId();
-      buffer_pool_manager_->UnpinPage(old_root_node_id, true);
-      buffer_pool_manager_->DeletePage(old_root_node_id);
-      root_page_id_ = INVALID_PAGE_ID;
-      UpdateRootPageId();
-      return true;
-    }
-    buffer_pool_manager_->UnpinPage(old_root_node->GetPageId(), true);
-    return false;
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::AdjustRoot(WritePageGuard *old_root_guard) {
+  auto *old_root = old_root_guard->As<BPlusTreePage>();
+  if (old_root->IsLeafPage()) {
+    if (old_root->GetSize() > 0) {
+      return;
+    }
+    root_page_id_ = INVALID_PAGE_ID;
+    old_root_guard->AsMut<LeafPage>()->Fences()->SetUnlinked();
+  } else {
+    if (old_root->GetSize() > 1) {
+      return;
+    }
+    root_page_id_ = old_root_guard->AsMut<InternalPage>()->RemoveAndReturnOnlyChild();
+    old_root_guard->AsMut<InternalPage>()->Fences()->SetUnlinked();
   }
-  if (old_root_node->GetSize() > 1) {
-    buffer_pool_manager_->UnpinPage(old_root_node->GetPageId(), true);
+  UpdateRootPageId();
+  auto old_root_page_id = old_root_guard->PageId();
+  old_root_guard->Drop();
+  FreePage(old_root_page_id);
+}
+
+/*
+ * Give a page that was just unlinked from the tree back to the buffer pool.
+ * Descents that do not latch their way down may still get to the page through
+ * a stale page id, and rely on its fences to tell that they went astray, so
+ * the page is only deleted once every operation that may hold its page id is
+ * over; until then it could not become a page of anything else.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::FreePage(page_id_t page_id) {
+  swizzle_table_.Unswizzle(page_id);
+  epochs_.Retire(page_id);
+}
+
+/*****************************************************************************
+ * BULK LOADING
+ *****************************************************************************/
+/*
+ * Build the tree bottom-up from key & value pairs pulled from next until it
+ * returns false, sorted by key. Pages are filled left to right up to
+ * fill_factor of their capacity, and each level is built as the level below
+ * completes its pages, so pages are written in the order they are allocated,
+ * and only the last pages of each level are held at a time. Duplicate keys
+ * keep their first value, as Insert does.
+ * @return: false if the tree is not empty, or if the pairs are not sorted, in
+ * which case the tree is left empty
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::BulkLoad(const std::function<bool(KeyType *, ValueType *)> &next, double fill_factor,
+                              Transaction *transaction) -> bool {
+  std::scoped_lock lock(root_latch_);
+  if (!IsEmpty()) {
     return false;
   }
-  auto new_root_page_id =
-      reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(old_root_node)->ValueAt(0);
-  auto new_root_page = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(new_root_page_id));
-  new_root_page->SetParentPageId(INVALID_PAGE_ID);
-  buffer_pool_manager_->UnpinPage(new_root_page_id, true);
-  buffer_pool_manager_->UnpinPage(root_page_id_, true);
-  buffer_pool_manager_->DeletePage(root_page_id_);
-  root_page_id_ = new_root_page_id;
+  BulkLoadContext ctx;
+  ctx.leaf_size_ = BulkLoadPageSize(leaf_max_size_, fill_factor);
+  ctx.internal_size_ = std::max(BulkLoadPageSize(internal_max_size_, fill_factor), 2);
+  KeyType key;
+  ValueType value;
+  KeyType last_key;
+  bool has_last_key = false;
+  while (next(&key, &value)) {
+    if (has_last_key) {
+      int order = comparator_(key, last_key);
+      if (order == 0) {
+        continue;
+      }
+      if (order < 0) {
+        ctx.last_pages_.clear();
+        for (page_id_t page_id : ctx.page_ids_) {
+          FreePage(page_id);
+        }
+        return false;
+      }
+    }
+    last_key = key;
+    has_last_key = true;
+    ctx.leaf_entries_.emplace_back(key, value);
+    BulkLoadLevel<LeafPage>(&ctx, 0, &ctx.leaf_entries_, false);
+  }
+  if (ctx.leaf_entries_.empty()) {
+    return true;
+  }
+  // Complete the levels from the leaves up, until one of them fits in a single page: the root.
+  BulkLoadLevel<LeafPage>(&ctx, 0, &ctx.leaf_entries_, true);
+  size_t level = 0;
+  while (ctx.page_counts_[level] > 1) {
+    level++;
+    BulkLoadLevel<InternalPage>(&ctx, level, &ctx.internal_entries_[level], true);
+  }
+  page_id_t root_page_id = ctx.last_pages_[level].PageId();
+  ctx.last_pages_.clear();
+  root_page_id_ = root_page_id;
   UpdateRootPageId();
-
   return true;
 }
 
+/*
+ * The number of entries bulk loading puts in a page with max_size: as close
+ * to fill_factor of what the page holds before it splits as the minimum size
+ * of a page allows.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::BulkLoadPageSize(int max_size, double fill_factor) const -> int {
+  int size = static_cast<int>(fill_factor * (max_size - 1) + 0.5);
+  return std::clamp(size, std::max(max_size / 2, 1), max_size - 1);
+}
+
+/*
+ * Build pages out of the pending entries of a level. A page is only built
+ * once enough entries follow it to fill a page of minimum size, so that the
+ * last page of the level is never underfull. Once the level below is
+ * complete (last is true), what is left goes to one last page, or to two
+ * halves if it does not fit in one.
+ * Using template N to represent either internal page or leaf page.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+template <typename N, typename Entry>
+void BPLUSTREE_TYPE::BulkLoadLevel(BulkLoadContext *ctx, size_t level, std::vector<Entry> *entries, bool last) {
+  int max_size = std::is_same_v<N, LeafPage> ? leaf_max_size_ : internal_max_size_;
+  int page_size = std::is_same_v<N, LeafPage> ? ctx->leaf_size_ : ctx->internal_size_;
+  int size = static_cast<int>(entries->size());
+  if (!last) {
+    if (size >= page_size + max_size / 2) {
+      BulkLoadPage<N>(ctx, level, entries->data(), page_size);
+      entries->erase(entries->begin(), entries->begin() + page_size);
+    }
+    return;
+  }
+  if (size == 0) {
+    return;
+  }
+  if (size < max_size) {
+    BulkLoadPage<N>(ctx, level, entries->data(), size);
+  } else {
+    BulkLoadPage<N>(ctx, level, entries->data(), size / 2);
+    BulkLoadPage<N>(ctx, level, entries->data() + size / 2, size - size / 2);
+  }
+  entries->clear();
+}
+
+/*
+ * Build the next page of a level out of entries, link it to the page before
+ * it, and hand its first key and its page id over to the level above.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+template <typename N, typename Entry>
+void BPLUSTREE_TYPE::BulkLoadPage(BulkLoadContext *ctx, size_t level, const Entry *entries, int size) {
+  while (ctx->last_pages_.size() <= level) {
+    ctx->last_pages_.emplace_back();
+    ctx->page_counts_.push_back(0);
+  }
+  page_id_t page_id;
+  WritePageGuard guard = NewGuardedPage(&page_id);
+  ctx->page_ids_.push_back(page_id);
+  auto *node = guard.AsMut<N>();
+  node->Init(page_id, std::is_same_v<N, LeafPage> ? leaf_max_size_ : internal_max_size_);
+  node->Populate(entries, size);
+  KeyType first_key = entries[0].first;
+  WritePageGuard &left_guard = ctx->last_pages_[level];
+  if (left_guard.IsValid()) {
+    auto *left = left_guard.AsMut<N>();
+    left->SetNextPageId(page_id);
+    left->Fences()->SetHighKey(first_key);
+    node->Fences()->SetLowKey(first_key);
+  }
+  left_guard = std::move(guard);
+  ctx->page_counts_[level]++;
+  while (ctx->internal_entries_.size() <= level + 1) {
+    ctx->internal_entries_.emplace_back();
+  }
+  ctx->internal_entries_[level + 1].emplace_back(first_key, page_id);
+  BulkLoadLevel<InternalPage>(ctx, level + 1, &ctx->internal_entries_[level + 1], false);
+}
+
 /*****************************************************************************
  * INDEX ITERATOR
  *****************************************************************************/
@@ -503,9 +566,12 @@ auto BPLUSTREE_TYPE::AdjustRoot(BPlusTreePage *old_root_node) -> bool {
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::Begin() -> INDEXITERATOR_TYPE {
-  BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *first_leaf_page = FindCertainLeafPage(0);
-  return INDEXITERATOR_TYPE(first_leaf_page->GetPageId(), first_leaf_page->GetNextPageId(), first_leaf_page->GetSize(),
-                            0, buffer_pool_manager_);
+  EpochManager::Guard epoch(&epochs_);
+  ReadPageGuard leaf_guard = FindLeafRead(KeyType(), true);
+  if (!leaf_guard.IsValid()) {
+    return End();
+  }
+  return INDEXITERATOR_TYPE(this, std::move(leaf_guard), 0);
 }
 
 /*
@@ -515,9 +581,12 @@ auto BPLUSTREE_TYPE::Begin() -> INDEXITERATOR_TYPE {
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto BPLUSTREE_TYPE::Begin(const KeyType &key) -> INDEXITERATOR_TYPE {
-  auto *leaf_page = reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *>(FindLeafPage(key, 0));
-  return INDEXITERATOR_TYPE(leaf_page->GetPageId(), leaf_page->GetNextPageId(), leaf_page->GetSize(),
-                            leaf_page->KeyIndex(key, comparator_), buffer_pool_manager_);
+  EpochManager::Guard epoch(&epochs_);
+  ReadPageGuard leaf_guard = FindLeafRead(key);
+  if (!leaf_guard.IsValid()) {
+    return End();
+  }
+  return INDEXITERATOR_TYPE(this, std::move(leaf_guard), key);
 }
 
 /*
@@ -526,107 +595,302 @@ auto BPLUSTREE_TYPE::Begin(const KeyType &key) -> INDEXITERATOR_TYPE {
  * @return : index iterator
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::End() -> INDEXITERATOR_TYPE {
-  BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *last_leaf_page = FindCertainLeafPage(1);
-  return INDEXITERATOR_TYPE(last_leaf_page->GetPageId(), last_leaf_page->GetNextPageId(), last_leaf_page->GetSize(),
-                            last_leaf_page->GetSize(), buffer_pool_manager_);
-}
+auto BPLUSTREE_TYPE::End() -> INDEXITERATOR_TYPE { return INDEXITERATOR_TYPE(); }
 
 /*****************************************************************************
  * UTILITIES AND DEBUG
  *****************************************************************************/
 /*
- * Find leaf page containing particular key, if leftMost flag == true, find
- * the left most leaf page
+ * Fetch a page through a guard, throwing an "out of memory" exception if every
+ * frame of the buffer pool is pinned
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto BPLUSTREE_TYPE::FindLeafPage(const KeyType &key, int opt, Transaction *transaction, bool leftMost)
-    -> BPlusTreePage * {
-  // opt == 0:GetValue; opt == 1:Insert; opt == 2:Remove
-  auto find_page = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(root_page_id_));
-  root_latch_.lock();
-  if (opt == 0) {
-    RLatch(find_page);
-    root_latch_.unlock();
-  } else if (opt == 1) {
-    WLatch(find_page);
-    if (find_page->GetSize() + 1 <= find_page->GetMaxSize()) {
-      root_latch_.unlock();
-    }
+auto BPLUSTREE_TYPE::FetchRead(page_id_t page_id) -> ReadPageGuard {
+  auto guard = buffer_pool_manager_->FetchPageRead(page_id);
+  if (!guard.IsValid()) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "BPlusTree: every frame of the buffer pool is pinned");
+  }
+  return guard;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::FetchWrite(page_id_t page_id) -> WritePageGuard {
+  auto guard = buffer_pool_manager_->FetchPageWrite(page_id);
+  if (!guard.IsValid()) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "BPlusTree: every frame of the buffer pool is pinned");
+  }
+  return guard;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::NewGuardedPage(page_id_t *page_id) -> WritePageGuard {
+  auto guard = buffer_pool_manager_->NewPageGuarded(page_id);
+  if (!guard.IsValid()) {
+    throw Exception(ExceptionType::OUT_OF_MEMORY, "BPlusTree: cannot allocate a new page");
+  }
+  return guard.UpgradeWrite();
+}
+
+/*
+ * Visit a page for an optimistic descent, through a link of the swizzle table
+ * if the link points to the page, and through the buffer pool otherwise.
+ * @param   link    the link to the page, or nullptr if its parent is not swizzled
+ * @return : false if the page is being written, and the descent has to be retried
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::VisitOptimistic(std::atomic<SwizzleTable::Node *> *link, page_id_t page_id, OptimisticPage *page)
+    -> bool {
+  page->node_ = link == nullptr ? nullptr : swizzle_table_.Resolve(*link, page_id);
+  if (page->node_ != nullptr) {
+    page->page_ = page->node_->page_.load(std::memory_order_acquire);
   } else {
-    WLatch(find_page);
-    if (find_page->GetSize() >= find_page->GetMinSize() + 1) {
-      root_latch_.unlock();
-    }
-  }
-  transaction->AddIntoPageSet(reinterpret_cast<Page *>(find_page));
-  while (!find_page->IsLeafPage()) {
-    auto next_find_page = reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(find_page);
-    find_page =
-        reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(next_find_page->Lookup(key, comparator_)));
-    if (opt == 0) {
-      RLatch(find_page);
-      auto page_queue = transaction->GetPageSet();
-      transaction->ClearPageSet();
-      while (!page_queue->empty()) {
-        auto first_page = page_queue->front();
-        page_queue->pop_front();
-        first_page->RUnlatch();
-        if (first_page->GetPageId() == root_page_id_) {
-          root_latch_.unlock();
-        }
-        buffer_pool_manager_->UnpinPage(first_page->GetPageId(), false);
-      }
-    } else if (opt == 1) {
-      WLatch(find_page);
-      if (find_page->GetSize() + 1 <= find_page->GetMaxSize()) {
-        auto page_queue = transaction->GetPageSet();
-        transaction->ClearPageSet();
-        while (!page_queue->empty()) {
-          auto first_page = page_queue->front();
-          page_queue->pop_front();
-          first_page->WUnlatch();
-          if (first_page->GetPageId() == root_page_id_) {
-            root_latch_.unlock();
-          }
-          buffer_pool_manager_->UnpinPage(first_page->GetPageId(), false);
-        }
-      }
+    page->pin_ = buffer_pool_manager_->FetchPageBasic(page_id);
+    if (!page->pin_.IsValid()) {
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "BPlusTree: every frame of the buffer pool is pinned");
+    }
+    page->page_ = page->pin_.GetPage();
+  }
+  page->version_ = page->page_->GetVersion();
+  if ((page->version_ & 1) != 0) {
+    return false;
+  }
+  // The page may have been unswizzled, to be deleted, before its version was read.
+  return page->node_ == nullptr || page->node_->page_id_.load(std::memory_order_acquire) == page_id;
+}
+
+/*
+ * Swizzle the root page, unless the root changed in the meantime.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::SwizzleRoot(page_id_t page_id) {
+  std::scoped_lock root_lock(root_latch_);
+  if (root_page_id_ == page_id) {
+    swizzle_table_.Swizzle(swizzle_table_.RootLink(), page_id);
+  }
+}
+
+/*
+ * Swizzle a child of a swizzled page if it is an internal page, unless the
+ * page changed since it was read. The page is read-latched meanwhile, so that
+ * the child cannot be deleted before it is swizzled.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::SwizzleChild(OptimisticPage *parent, int index, page_id_t child_page_id,
+                                  const OptimisticPage &child) {
+  parent->page_->RLatch();
+  // The type of a page never changes, so it can be read without the latch of the child.
+  if (parent->page_->ValidateVersion(parent->version_) &&
+      !reinterpret_cast<const BPlusTreePage *>(child.page_->GetData())->IsLeafPage()) {
+    swizzle_table_.Swizzle(swizzle_table_.ChildLink(parent->node_, index), child_page_id);
+  }
+  parent->page_->RUnlatch();
+}
+
+/*
+ * Find the leaf page containing particular key (or the left most leaf page)
+ * without latching any page (optimistic lock coupling). Every page on the way
+ * is read at a version, and the version is checked again once the page has
+ * been read, so that a page read in the middle of a change is never trusted.
+ * A child is not checked against its parent: its fences tell whether it still
+ * covers the key. A child that split since its parent was read is left for its
+ * right sibling, as in a B-link tree, and a descent that got to a page that
+ * lost the key to its left sibling or was unlinked fails. Internal pages are
+ * reached through the swizzle table whenever possible.
+ * @param   leaf      set to the leaf page, pinned but not latched, or left
+ *                    empty if the tree is empty
+ * @param   is_root   set to whether the leaf page is the root page
+ * @return : false if the descent went astray, and has to be retried
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::FindLeafOptimistic(const KeyType &key, bool left_most, OptimisticPage *leaf, bool *is_root)
+    -> bool {
+  page_id_t page_id = root_page_id_;
+  if (page_id == INVALID_PAGE_ID) {
+    return true;
+  }
+  OptimisticPage node;
+  if (!VisitOptimistic(swizzle_table_.RootLink(), page_id, &node) || root_page_id_ != page_id) {
+    return false;
+  }
+  *is_root = true;
+  while (true) {
+    bool is_leaf = reinterpret_cast<const BPlusTreePage *>(node.page_->GetData())->IsLeafPage();
+    const BPlusTreeFences<KeyType> *fences;
+    page_id_t next_page_id;
+    if (is_leaf) {
+      fences = reinterpret_cast<const LeafPage *>(node.page_->GetData())->Fences();
+      next_page_id = reinterpret_cast<const LeafPage *>(node.page_->GetData())->GetNextPageId();
     } else {
-      WLatch(find_page);
-      if (find_page->GetSize() >= find_page->GetMinSize() + 1) {
-        auto page_queue = transaction->GetPageSet();
-        transaction->ClearPageSet();
-        while (!page_queue->empty()) {
-          auto first_page = page_queue->front();
-          page_queue->pop_front();
-          first_page->WUnlatch();
-          if (first_page->GetPageId() == root_page_id_) {
-            root_latch_.unlock();
-          }
-          buffer_pool_manager_->UnpinPage(first_page->GetPageId(), false);
-        }
+      fences = reinterpret_cast<const InternalPage *>(node.page_->GetData())->Fences();
+      next_page_id = reinterpret_cast<const InternalPage *>(node.page_->GetData())->GetNextPageId();
+    }
+    if (fences->IsUnlinked() || (left_most ? fences->HasLowKey() : fences->IsBelow(key, comparator_))) {
+      return false;
+    }
+    if (!left_most && fences->IsAbove(key, comparator_)) {
+      if (!node.page_->ValidateVersion(node.version_)) {
+        return false;
       }
+      OptimisticPage right;
+      if (!VisitOptimistic(nullptr, next_page_id, &right)) {
+        return false;
+      }
+      node = std::move(right);
+      *is_root = false;
+      continue;
+    }
+    if (is_leaf) {
+      break;
+    }
+    if (node.node_ == nullptr && *is_root && !swizzle_table_.IsFull()) {
+      SwizzleRoot(page_id);
+    }
+    auto *internal = reinterpret_cast<const InternalPage *>(node.page_->GetData());
+    // The page may be read in the middle of a change: keep within its bounds until the read is validated. Max sizes
+    // never exceed the capacity of a page.
+    int size = internal->GetSize();
+    if (size < 1 || size > internal_max_size_) {
+      return false;
+    }
+    int index = left_most ? 0 : internal->KeyIndex(key, comparator_);
+    page_id = internal->ValueAt(index);
+    if (!node.page_->ValidateVersion(node.version_)) {
+      return false;
+    }
+    auto *link = node.node_ == nullptr ? nullptr : swizzle_table_.ChildLink(node.node_, index);
+    OptimisticPage child;
+    if (!VisitOptimistic(link, page_id, &child)) {
+      return false;
+    }
+    if (link != nullptr && child.node_ == nullptr && !swizzle_table_.IsFull()) {
+      SwizzleChild(&node, index, page_id, child);
+    }
+    node = std::move(child);
+    *is_root = false;
+  }
+  *leaf = std::move(node);
+  return true;
+}
+
+/*
+ * Read-latch a page reached through a link of the swizzle table. If the link
+ * points to the page, the page is latched in place, without going through the
+ * buffer pool. Otherwise it is fetched, and swizzled if it is an internal page.
+ * @param   link    the link to the page, or nullptr if its parent is not swizzled
+ * @param   node    set to the swizzled node of the page, or nullptr if it has none
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::FetchSwizzledRead(std::atomic<SwizzleTable::Node *> *link, page_id_t page_id,
+                                       SwizzleTable::Node **node) -> ReadPageGuard {
+  *node = link == nullptr ? nullptr : swizzle_table_.Resolve(*link, page_id);
+  if (*node != nullptr) {
+    Page *page = (*node)->page_.load(std::memory_order_acquire);
+    page->RLatch();
+    // The buffer pool may have reclaimed the page before it was latched.
+    if ((*node)->page_id_.load() == page_id) {
+      return ReadPageGuard(nullptr, page);
+    }
+    page->RUnlatch();
+    *node = nullptr;
+  }
+  ReadPageGuard guard = FetchRead(page_id);
+  if (link != nullptr && !guard.As<BPlusTreePage>()->IsLeafPage()) {
+    *node = swizzle_table_.Swizzle(link, page_id);
+  }
+  return guard;
+}
+
+/*
+ * Find leaf page containing particular key, if left_most flag == true, find
+ * the left most leaf page. The leaf page is reached optimistically, and then
+ * read-latched if it did not change on the way; after a few failed attempts
+ * the pages are read-latched all the way down instead.
+ * @return : a guard of the leaf page, or an invalid guard if the tree is empty
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::FindLeafRead(const KeyType &key, bool left_most) -> ReadPageGuard {
+  for (int attempt = 0; attempt < OPTIMISTIC_ATTEMPTS; attempt++) {
+    OptimisticPage leaf;
+    bool is_root;
+    if (!FindLeafOptimistic(key, left_most, &leaf, &is_root)) {
+      continue;
+    }
+    if (leaf.page_ == nullptr) {
+      return {};
+    }
+    ReadPageGuard leaf_guard = leaf.pin_.UpgradeRead();
+    if (leaf_guard.GetPage()->ValidateVersion(leaf.version_)) {
+      return leaf_guard;
     }
-    transaction->AddIntoPageSet(reinterpret_cast<Page *>(find_page));
-    // buffer_pool_manager_->UnpinPage(last_page_id, false);
   }
-  return find_page;
+  return FindLeafReadPessimistic(key, left_most);
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
-BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *BPlusTree<KeyType, ValueType, KeyComparator>::FindCertainLeafPage(
-    int opt) {
-  auto find_page = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(root_page_id_));
-  while (!find_page->IsLeafPage()) {
-    auto last_page_id = find_page->GetPageId();
-    auto next_find_page = reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(find_page);
-    int index = (opt == 0 ? 0 : next_find_page->GetSize() - 1);
-    find_page = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager_->FetchPage(next_find_page->ValueAt(index)));
+/*
+ * Find leaf page containing particular key (or the left most leaf page).
+ * Pages are read-latched from the root down, and each page is released once
+ * its child is latched. Internal pages are reached through the swizzle table
+ * whenever possible.
+ * @return : a guard of the leaf page, or an invalid guard if the tree is empty
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::FindLeafReadPessimistic(const KeyType &key, bool left_most) -> ReadPageGuard {
+  std::unique_lock<std::mutex> root_lock(root_latch_);
+  if (IsEmpty()) {
+    return {};
+  }
+  SwizzleTable::Node *node;
+  ReadPageGuard guard = FetchSwizzledRead(swizzle_table_.RootLink(), root_page_id_, &node);
+  root_lock.unlock();
+  while (!guard.As<BPlusTreePage>()->IsLeafPage()) {
+    auto *internal = guard.As<InternalPage>();
+    int index = left_most ? 0 : internal->KeyIndex(key, comparator_);
+    auto *link = node == nullptr ? nullptr : swizzle_table_.ChildLink(node, index);
+    guard = FetchSwizzledRead(link, internal->ValueAt(index), &node);
+  }
+  return guard;
+}
 
-    buffer_pool_manager_->UnpinPage(last_page_id, false);
+/*
+ * Find leaf page containing particular key for a write operation. The caller
+ * holds the root lock. Pages are write-latched from the root down into the
+ * write set, and all the pages above a page that is safe for the operation are
+ * released, together with the root lock.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_TYPE::FindLeafWrite(const KeyType &key, Operation op, Context *ctx) {
+  ctx->write_set_.push_back(FetchWrite(root_page_id_));
+  const WritePageGuard *guard = &ctx->write_set_.back();
+  if (IsSafe(guard->As<BPlusTreePage>(), op, true)) {
+    ctx->root_lock_.unlock();
+  }
+  while (!guard->As<BPlusTreePage>()->IsLeafPage()) {
+    ctx->write_set_.push_back(FetchWrite(guard->As<InternalPage>()->Lookup(key, comparator_)));
+    guard = &ctx->write_set_.back();
+    if (IsSafe(guard->As<BPlusTreePage>(), op, false)) {
+      while (ctx->write_set_.size() > 1) {
+        ctx->write_set_.pop_front();
+      }
+      if (ctx->root_lock_.owns_lock()) {
+        ctx->root_lock_.unlock();
+      }
+    }
   }
-  return reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *>(find_page);
+}
+
+/*
+ * A page is safe for an operation if the operation cannot make it split or
+ * underflow, so that the pages above it are not going to change.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto BPLUSTREE_TYPE::IsSafe(const BPlusTreePage *node, Operation op, bool is_root) const -> bool {
+  if (op == Operation::INSERT) {
+    return node->GetSize() + 1 < node->GetMaxSize();
+  }
+  if (is_root) {
+    return node->GetSize() > (node->IsLeafPage() ? 1 : 2);
+  }
+  return node->GetSize() > node->GetMinSize();
 }
 
 /*
@@ -639,7 +903,10 @@ BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *BPlusTree<KeyType, ValueTy
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
-  auto *header_page = static_cast<HeaderPage *>(buffer_pool_manager_->FetchPage(HEADER_PAGE_ID));
+  auto header_guard = buffer_pool_manager_->FetchPageWrite(HEADER_PAGE_ID);
+  // HeaderPage reads and writes the frame through Page::GetData(), so mark the page dirty up front.
+  header_guard.GetDataMut();
+  auto *header_page = static_cast<HeaderPage *>(header_guard.GetPage());
   if (insert_record != 0) {
     // create a new record<index_name + root_page_id> in header_page
     header_page->InsertRecord(index_name_, root_page_id_);
@@ -647,23 +914,41 @@ void BPLUSTREE_TYPE::UpdateRootPageId(int insert_record) {
     // update root_page_id in header_page
     header_page->UpdateRecord(index_name_, root_page_id_);
   }
-  buffer_pool_manager_->UnpinPage(HEADER_PAGE_ID, true);
 }
 
 /*
  * This method is used for test only
- * Read data from file and insert one by one
+ * Read data from file and bulk load it into an empty tree, or insert one by
+ * one otherwise
  */
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::InsertFromFile(const std::string &file_name, Transaction *transaction) {
   int64_t key;
   std::ifstream input(file_name);
-  while (input) {
-    input >> key;
+  std::vector<MappingType> items;
+  while (input >> key) {
     KeyType index_key;
     index_key.SetFromInteger(key);
-    RID rid(key);
-    Insert(index_key, rid, transaction);
+    items.emplace_back(index_key, RID(key));
+  }
+  std::stable_sort(items.begin(), items.end(), [this](const MappingType &left, const MappingType &right) {
+    return comparator_(left.first, right.first) < 0;
+  });
+  size_t next_item = 0;
+  auto next = [&items, &next_item](KeyType *index_key, ValueType *value) {
+    if (next_item == items.size()) {
+      return false;
+    }
+    *index_key = items[next_item].first;
+    *value = items[next_item].second;
+    next_item++;
+    return true;
+  };
+  if (BulkLoad(next, BULK_LOAD_FILL_FACTOR, transaction)) {
+    return;
+  }
+  for (const auto &item : items) {
+    Insert(item.first, item.second, transaction);
   }
 }
 /*
@@ -748,12 +1033,6 @@ void BPLUSTREE_TYPE::ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::o
       out << leaf_prefix << leaf->GetPageId() << " -> " << leaf_prefix << leaf->GetNextPageId() << ";\n";
       out << "{rank=same " << leaf_prefix << leaf->GetPageId() << " " << leaf_prefix << leaf->GetNextPageId() << "};\n";
     }
-
-    // Print parent links if there is a parent
-    if (leaf->GetParentPageId() != INVALID_PAGE_ID) {
-      out << internal_prefix << leaf->GetParentPageId() << ":p" << leaf->GetPageId() << " -> " << leaf_prefix
-          << leaf->GetPageId() << ";\n";
-    }
   } else {
     auto *inner = reinterpret_cast<InternalPage *>(page);
     // Print node name
@@ -780,14 +1059,12 @@ void BPLUSTREE_TYPE::ToGraph(BPlusTreePage *page, BufferPoolManager *bpm, std::o
     out << "</TR>";
     // Print table end
     out << "</TABLE>>];\n";
-    // Print Parent link
-    if (inner->GetParentPageId() != INVALID_PAGE_ID) {
-      out << internal_prefix << inner->GetParentPageId() << ":p" << inner->GetPageId() << " -> " << internal_prefix
-          << inner->GetPageId() << ";\n";
-    }
     // Print leaves
     for (int i = 0; i < inner->GetSize(); i++) {
       auto child_page = reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(inner->ValueAt(i))->GetData());
+      // Print child link
+      out << internal_prefix << inner->GetPageId() << ":p" << child_page->GetPageId() << " -> "
+          << (child_page->IsLeafPage() ? leaf_prefix : internal_prefix) << child_page->GetPageId() << ";\n";
       ToGraph(child_page, bpm, out);
       if (i > 0) {
         auto sibling_page = reinterpret_cast<BPlusTreePage *>(bpm->FetchPage(inner->ValueAt(i - 1))->GetData());
@@ -814,8 +1091,7 @@ INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_TYPE::ToString(BPlusTreePage *page, BufferPoolManager *bpm) const {
   if (page->IsLeafPage()) {
     auto *leaf = reinterpret_cast<LeafPage *>(page);
-    std::cout << "Leaf Page: " << leaf->GetPageId() << " parent: " << leaf->GetParentPageId()
-              << " next: " << leaf->GetNextPageId() << std::endl;
+    std::cout << "Leaf Page: " << leaf->GetPageId() << " next: " << leaf->GetNextPageId() << std::endl;
     for (int i = 0; i < leaf->GetSize(); i++) {
       std::cout << leaf->KeyAt(i) << ",";
     }
@@ -823,7 +1099,7 @@ void BPLUSTREE_TYPE::ToString(BPlusTreePage *page, BufferPoolManager *bpm) const
     std::cout << std::endl;
   } else {
     auto *internal = reinterpret_cast<InternalPage *>(page);
-    std::cout << "Internal Page: " << internal->GetPageId() << " parent: " << internal->GetParentPageId() << std::endl;
+    std::cout << "Internal Page: " << internal->GetPageId() << std::endl;
     for (int i = 0; i < internal->GetSize(); i++) {
       std::cout << internal->KeyAt(i) << ": " << internal->ValueAt(i) << ",";
     }
@@ -836,66 +1112,6 @@ void BPLUSTREE_TYPE::ToString(BPlusTreePage *page, BufferPoolManager *bpm) const
   bpm->UnpinPage(page->GetPageId(), false);
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
-void BPlusTree<KeyType, ValueType, KeyComparator>::RecursiveUpdate(KeyType min_key, const KeyType &key,
-                                                                   page_id_t page_id) {
-  if (page_id == INVALID_PAGE_ID) {
-    return;
-  }
-  auto update_page = reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(
-      buffer_pool_manager_->FetchPage(page_id));
-  auto index = update_page->LookupKey(min_key, comparator_);
-  min_key = update_page->KeyAt(index);
-  update_page->SetKeyAt(index, key);
-
-  while (index == 0 && update_page->GetPageId() != root_page_id_) {
-    auto parent_page = reinterpret_cast<BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *>(
-        buffer_pool_manager_->FetchPage(update_page->GetParentPageId()));
-    if (parent_page->ValueAt(0) == update_page->GetPageId()) {
-      index = 0;
-    } else {
-      index = parent_page->LookupKey(min_key, comparator_);
-    }
-    min_key = parent_page->KeyAt(index);
-    parent_page->SetKeyAt(index, key);
-    buffer_pool_manager_->UnpinPage(update_page->GetPageId(), true);
-    update_page = parent_page;
-  }
-  buffer_pool_manager_->UnpinPage(update_page->GetPageId(), true);
-}
-
-template <typename KeyType, typename ValueType, typename KeyComparator>
-void BPlusTree<KeyType, ValueType, KeyComparator>::RemoveParent(
-    BPlusTreeInternalPage<KeyType, page_id_t, KeyComparator> *parent_page, int index) {
-  auto min_key = parent_page->KeyAt(1);
-  parent_page->Remove(index);
-  if (parent_page->GetSize() >= parent_page->GetMinSize()) {
-    buffer_pool_manager_->UnpinPage(parent_page->GetPageId(), true);
-    return;
-  }
-  CoalesceOrRedistribute(parent_page, min_key);
-}
-
-template <typename KeyType, typename ValueType, typename KeyComparator>
-void BPlusTree<KeyType, ValueType, KeyComparator>::RLatch(BPlusTreePage *child_page) {
-  reinterpret_cast<Page *>(child_page)->RLatch();
-}
-
-template <typename KeyType, typename ValueType, typename KeyComparator>
-void BPlusTree<KeyType, ValueType, KeyComparator>::RUnLatch(BPlusTreePage *child_page) {
-  reinterpret_cast<Page *>(child_page)->RUnlatch();
-}
-
-template <typename KeyType, typename ValueType, typename KeyComparator>
-void BPlusTree<KeyType, ValueType, KeyComparator>::WLatch(BPlusTreePage *child_page) {
-  reinterpret_cast<Page *>(child_page)->WLatch();
-}
-
-template <typename KeyType, typename ValueType, typename KeyComparator>
-void BPlusTree<KeyType, ValueType, KeyComparator>::WUnLatch(BPlusTreePage *child_page) {
-  reinterpret_cast<Page *>(child_page)->WUnlatch();
-}
-
 template class BPlusTree<GenericKey<4>, RID, GenericComparator<4>>;
 template class BPlusTree<GenericKey<8>, RID, GenericComparator<8>>;
 template class BPlusTree<GenericKey<16>, RID, GenericComparator<16>>;
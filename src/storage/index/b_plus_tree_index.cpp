@@ -9,6 +9,10 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+
 #include "storage/index/b_plus_tree_index.h"
 
 namespace bustub {
@@ -25,16 +29,52 @@ INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
   // construct insert index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, *GetKeySchema());
 
   container_.Insert(index_key, rid, transaction);
 }
 
+/*
+ * Sort the entries by key, then build the tree bottom-up from them if it is
+ * still empty, or insert them one by one otherwise.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void BPLUSTREE_INDEX_TYPE::InsertEntries(const std::function<bool(Tuple *, RID *)> &next, Transaction *transaction) {
+  std::vector<std::pair<KeyType, RID>> entries;
+  Tuple key;
+  RID rid;
+  while (next(&key, &rid)) {
+    KeyType index_key;
+    index_key.SetFromKey(key, *GetKeySchema());
+    entries.emplace_back(index_key, rid);
+  }
+  std::stable_sort(entries.begin(), entries.end(),
+                   [this](const std::pair<KeyType, RID> &left, const std::pair<KeyType, RID> &right) {
+                     return comparator_(left.first, right.first) < 0;
+                   });
+  size_t next_entry = 0;
+  auto next_sorted = [&entries, &next_entry](KeyType *index_key, RID *rid) {
+    if (next_entry == entries.size()) {
+      return false;
+    }
+    *index_key = entries[next_entry].first;
+    *rid = entries[next_entry].second;
+    next_entry++;
+    return true;
+  };
+  if (container_.BulkLoad(next_sorted, BPLUSTREE_TYPE::BULK_LOAD_FILL_FACTOR, transaction)) {
+    return;
+  }
+  for (const auto &entry : entries) {
+    container_.Insert(entry.first, entry.second, transaction);
+  }
+}
+
 INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::DeleteEntry(const Tuple &key, RID rid, Transaction *transaction) {
   // construct delete index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, *GetKeySchema());
 
   container_.Remove(index_key, transaction);
 }
@@ -43,7 +83,7 @@ INDEX_TEMPLATE_ARGUMENTS
 void BPLUSTREE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) {
   // construct scan index key
   KeyType index_key;
-  index_key.SetFromKey(key);
+  index_key.SetFromKey(key, *GetKeySchema());
 
   container_.GetValue(index_key, result, transaction);
 }
@@ -0,0 +1,95 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// epoch_manager.cpp
+//
+// Identification: src/storage/index/epoch_manager.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/index/epoch_manager.h"
+
+#include <thread>  // NOLINT
+
+namespace bustub {
+
+EpochManager::~EpochManager() {
+  for (auto &retired : retired_) {
+    for (page_id_t page_id : retired) {
+      release_(page_id);
+    }
+  }
+}
+
+auto EpochManager::Shard() -> size_t {
+  static thread_local size_t shard = std::hash<std::thread::id>{}(std::this_thread::get_id()) % NUM_SHARDS;
+  return shard;
+}
+
+auto EpochManager::Enter() -> uint64_t {
+  size_t shard = Shard();
+  while (true) {
+    uint64_t epoch = epoch_.load();
+    operations_[epoch & 1][shard].count_.fetch_add(1);
+    // The epoch may have moved ahead twice before the operation was counted, past the pages it is about to reach.
+    if (epoch_.load() == epoch) {
+      return epoch;
+    }
+    operations_[epoch & 1][shard].count_.fetch_sub(1);
+  }
+}
+
+void EpochManager::Exit(uint64_t epoch) {
+  operations_[epoch & 1][Shard()].count_.fetch_sub(1);
+  if (has_retired_.load(std::memory_order_relaxed)) {
+    std::unique_lock guard(latch_, std::try_to_lock);
+    if (guard.owns_lock()) {
+      TryAdvance();
+    }
+  }
+}
+
+void EpochManager::Retire(page_id_t page_id) {
+  std::scoped_lock guard(latch_);
+  retired_[epoch_.load() & 1].push_back(page_id);
+  has_retired_.store(true, std::memory_order_relaxed);
+  TryAdvance();
+}
+
+auto EpochManager::IsActive(uint64_t parity) const -> bool {
+  for (const auto &counter : operations_[parity]) {
+    if (counter.count_.load() != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void EpochManager::TryAdvance() {
+  // Two steps take the pages retired in the current epoch out of reach of every operation.
+  for (int step = 0; step < 2; step++) {
+    uint64_t epoch = epoch_.load();
+    uint64_t previous = (epoch + 1) & 1;
+    if (IsActive(previous)) {
+      return;
+    }
+    // Every operation that started before the pages retired in the previous epoch were unlinked is over.
+    std::vector<page_id_t> kept;
+    for (page_id_t page_id : retired_[previous]) {
+      if (!release_(page_id)) {
+        kept.push_back(page_id);
+      }
+    }
+    retired_[previous] = std::move(kept);
+    epoch_.store(epoch + 1);
+    if (retired_[0].empty() && retired_[1].empty()) {
+      has_retired_.store(false, std::memory_order_relaxed);
+      return;
+    }
+  }
+}
+
+}  // namespace bustub
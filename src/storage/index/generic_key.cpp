@@ -0,0 +1,216 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// generic_key.cpp
+//
+// Identification: src/storage/index/generic_key.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/index/generic_key.h"
+
+#include <string>
+
+#include "common/exception.h"
+
+namespace bustub {
+
+namespace {
+
+/** Writes an encoded key, dropping the bytes that do not fit. */
+class KeyWriter {
+ public:
+  KeyWriter(char *data, size_t size) : data_(data), size_(size) {}
+
+  void PutByte(uint8_t byte) {
+    if (offset_ < size_) {
+      data_[offset_] = static_cast<char>(byte);
+    }
+    offset_++;
+  }
+
+  void PutBigEndian(uint64_t bits, size_t width) {
+    for (size_t i = width; i > 0; i--) {
+      PutByte(static_cast<uint8_t>(bits >> (8 * (i - 1))));
+    }
+  }
+
+ private:
+  char *data_;
+  size_t size_;
+  size_t offset_{0};
+};
+
+/** Reads an encoded key, as if it went on with zero bytes past its end. */
+class KeyReader {
+ public:
+  KeyReader(const char *data, size_t size) : data_(data), size_(size) {}
+
+  auto GetByte() -> uint8_t {
+    uint8_t byte = offset_ < size_ ? static_cast<uint8_t>(data_[offset_]) : 0;
+    offset_++;
+    return byte;
+  }
+
+  auto GetBigEndian(size_t width) -> uint64_t {
+    uint64_t bits = 0;
+    for (size_t i = 0; i < width; i++) {
+      bits = (bits << 8) | GetByte();
+    }
+    return bits;
+  }
+
+  /** Reads an escaped string up to its end marker, or up to the end of the key if it was cut. */
+  auto GetString() -> std::string {
+    std::string bytes;
+    while (offset_ < size_) {
+      uint8_t byte = GetByte();
+      if (byte == 0) {
+        if (GetByte() == 0) {
+          break;
+        }
+      }
+      bytes.push_back(static_cast<char>(byte));
+    }
+    return bytes;
+  }
+
+ private:
+  const char *data_;
+  size_t size_;
+  size_t offset_{0};
+};
+
+auto SignBit(size_t width) -> uint64_t { return uint64_t{1} << (8 * width - 1); }
+
+/** Sign-extends the low width bytes of bits. */
+auto SignExtend(uint64_t bits, size_t width) -> int64_t {
+  int shift = static_cast<int>(64 - 8 * width);
+  return static_cast<int64_t>(bits << shift) >> shift;
+}
+
+auto EncodeDecimal(double value) -> uint64_t {
+  // -0.0 is equal to 0.0, so it must be encoded the same way.
+  if (value == 0) {
+    value = 0;
+  }
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return (bits & SignBit(8)) != 0 ? ~bits : bits | SignBit(8);
+}
+
+auto DecodeDecimal(uint64_t bits) -> double {
+  bits = (bits & SignBit(8)) != 0 ? bits & ~SignBit(8) : ~bits;
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+}  // namespace
+
+void GenericKeyEncoding::Encode(const Tuple &tuple, const Schema &key_schema, char *data, size_t size) {
+  memset(data, 0, size);
+  KeyWriter writer(data, size);
+  for (uint32_t i = 0; i < key_schema.GetColumnCount(); i++) {
+    const Value value = tuple.GetValue(&key_schema, i);
+    const TypeId type = key_schema.GetColumn(i).GetType();
+    const size_t width = Type::GetTypeSize(type);
+    switch (type) {
+      case TypeId::BOOLEAN:
+      case TypeId::TINYINT:
+        writer.PutBigEndian(static_cast<uint64_t>(value.GetAs<int8_t>()) ^ SignBit(width), width);
+        break;
+      case TypeId::SMALLINT:
+        writer.PutBigEndian(static_cast<uint64_t>(value.GetAs<int16_t>()) ^ SignBit(width), width);
+        break;
+      case TypeId::INTEGER:
+        writer.PutBigEndian(static_cast<uint64_t>(value.GetAs<int32_t>()) ^ SignBit(width), width);
+        break;
+      case TypeId::BIGINT:
+        writer.PutBigEndian(static_cast<uint64_t>(value.GetAs<int64_t>()) ^ SignBit(width), width);
+        break;
+      case TypeId::DECIMAL:
+        writer.PutBigEndian(EncodeDecimal(value.GetAs<double>()), width);
+        break;
+      case TypeId::TIMESTAMP:
+        writer.PutBigEndian(value.GetAs<uint64_t>(), width);
+        break;
+      case TypeId::VARCHAR: {
+        if (value.IsNull()) {
+          writer.PutByte(0);
+          break;
+        }
+        writer.PutByte(1);
+        const char *bytes = value.GetData();
+        for (uint32_t j = 0; j < value.GetLength(); j++) {
+          writer.PutByte(static_cast<uint8_t>(bytes[j]));
+          if (bytes[j] == 0) {
+            writer.PutByte(0xFF);
+          }
+        }
+        writer.PutByte(0);
+        writer.PutByte(0);
+        break;
+      }
+      default:
+        throw Exception(ExceptionType::UNKNOWN_TYPE, "GenericKeyEncoding: cannot encode a column of this type");
+    }
+  }
+}
+
+void GenericKeyEncoding::EncodeInteger(int64_t key, char *data, size_t size) {
+  memset(data, 0, size);
+  KeyWriter writer(data, size);
+  size_t width = size < sizeof(int64_t) ? sizeof(int32_t) : sizeof(int64_t);
+  writer.PutBigEndian(static_cast<uint64_t>(key) ^ SignBit(width), width);
+}
+
+auto GenericKeyEncoding::Decode(const char *data, size_t size, const Schema &key_schema, uint32_t column_idx)
+    -> Value {
+  KeyReader reader(data, size);
+  for (uint32_t i = 0; i < column_idx; i++) {
+    const TypeId type = key_schema.GetColumn(i).GetType();
+    if (type != TypeId::VARCHAR) {
+      reader.GetBigEndian(Type::GetTypeSize(type));
+    } else if (reader.GetByte() != 0) {
+      reader.GetString();
+    }
+  }
+  const TypeId type = key_schema.GetColumn(column_idx).GetType();
+  const size_t width = Type::GetTypeSize(type);
+  switch (type) {
+    case TypeId::BOOLEAN:
+    case TypeId::TINYINT:
+      return {type, static_cast<int8_t>(SignExtend(reader.GetBigEndian(width) ^ SignBit(width), width))};
+    case TypeId::SMALLINT:
+      return {type, static_cast<int16_t>(SignExtend(reader.GetBigEndian(width) ^ SignBit(width), width))};
+    case TypeId::INTEGER:
+      return {type, static_cast<int32_t>(SignExtend(reader.GetBigEndian(width) ^ SignBit(width), width))};
+    case TypeId::BIGINT:
+      return {type, SignExtend(reader.GetBigEndian(width) ^ SignBit(width), width)};
+    case TypeId::DECIMAL:
+      return {type, DecodeDecimal(reader.GetBigEndian(width))};
+    case TypeId::TIMESTAMP:
+      return {type, reader.GetBigEndian(width)};
+    case TypeId::VARCHAR: {
+      if (reader.GetByte() == 0) {
+        return {type, nullptr, 0, false};
+      }
+      std::string bytes = reader.GetString();
+      return {type, bytes.data(), static_cast<uint32_t>(bytes.size()), true};
+    }
+    default:
+      throw Exception(ExceptionType::UNKNOWN_TYPE, "GenericKeyEncoding: cannot decode a column of this type");
+  }
+}
+
+auto GenericKeyEncoding::DecodeInteger(const char *data, size_t size) -> int64_t {
+  KeyReader reader(data, size);
+  size_t width = size < sizeof(int64_t) ? sizeof(int32_t) : sizeof(int64_t);
+  return SignExtend(reader.GetBigEndian(width) ^ SignBit(width), width);
+}
+
+}  // namespace bustub
@@ -2,7 +2,10 @@
  * index_iterator.cpp
  */
 #include <cassert>
+#include <utility>
 
+#include "common/exception.h"
+#include "storage/index/b_plus_tree.h"
 #include "storage/index/index_iterator.h"
 
 namespace bustub {
@@ -13,44 +16,107 @@ namespace bustub {
  */
 
 INDEX_TEMPLATE_ARGUMENTS
-INDEXITERATOR_TYPE::IndexIterator(page_id_t page_id, page_id_t next_page_id, int size, int cursor,
-                                  BufferPoolManager *buffer_pool)
-    : page_id_(page_id), next_page_id_(next_page_id), size_(size), cursor_(cursor), buffer_pool_(buffer_pool) {}
+INDEXITERATOR_TYPE::IndexIterator(BPlusTree<KeyType, ValueType, KeyComparator> *tree, ReadPageGuard guard, int cursor)
+    : tree_(tree), guard_(std::move(guard)), page_id_(guard_.PageId()), cursor_(cursor) {
+  SkipExhaustedLeaves();
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+INDEXITERATOR_TYPE::IndexIterator(BPlusTree<KeyType, ValueType, KeyComparator> *tree, ReadPageGuard guard,
+                                  const KeyType &key)
+    : tree_(tree),
+      guard_(std::move(guard)),
+      page_id_(guard_.PageId()),
+      resume_key_(key),
+      has_resume_key_(true) {
+  SeekResumeKey();
+  SkipExhaustedLeaves();
+}
 
 INDEX_TEMPLATE_ARGUMENTS
 INDEXITERATOR_TYPE::~IndexIterator() = default;  // NOLINT
 
 INDEX_TEMPLATE_ARGUMENTS
-auto INDEXITERATOR_TYPE::IsEnd() -> bool { return (cursor_ == size_ && next_page_id_ == INVALID_PAGE_ID); }
+auto INDEXITERATOR_TYPE::IsEnd() -> bool { return page_id_ == INVALID_PAGE_ID; }
 
 INDEX_TEMPLATE_ARGUMENTS
 auto INDEXITERATOR_TYPE::operator*() -> const MappingType & {
-  auto result_page =
-      reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *>(buffer_pool_->FetchPage(page_id_));
-  const MappingType &result = result_page->GetItem(cursor_);
-  buffer_pool_->UnpinPage(result_page->GetPageId(), false);
-  return result;
+  item_ = guard_.As<LeafPage>()->GetItem(cursor_);
+  return item_;
 }
 
 INDEX_TEMPLATE_ARGUMENTS
 auto INDEXITERATOR_TYPE::operator++() -> INDEXITERATOR_TYPE & {
   ++cursor_;
-  if (cursor_ < size_ || next_page_id_ == INVALID_PAGE_ID) {
-    return *this;
-  }
-  auto now_page =
-      reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *>(buffer_pool_->FetchPage(page_id_));
-  auto next_page = reinterpret_cast<BPlusTreeLeafPage<KeyType, ValueType, KeyComparator> *>(
-      buffer_pool_->FetchPage(now_page->GetNextPageId()));
-  buffer_pool_->UnpinPage(now_page->GetPageId(), false);
-  cursor_ = 0;
-  size_ = next_page->GetSize();
-  page_id_ = next_page->GetPageId();
-  next_page_id_ = next_page->GetNextPageId();
-  buffer_pool_->UnpinPage(next_page->GetPageId(), false);
+  SkipExhaustedLeaves();
   return *this;
 }
 
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::SeekResumeKey() {
+  auto *leaf = guard_.As<LeafPage>();
+  const KeyComparator &comparator = tree_->comparator_;
+  cursor_ = leaf->KeyIndex(resume_key_, comparator);
+  if (resume_key_visited_ && cursor_ < leaf->GetSize() && comparator(leaf->KeyAt(cursor_), resume_key_) == 0) {
+    cursor_++;
+  }
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void INDEXITERATOR_TYPE::SkipExhaustedLeaves() {
+  while (page_id_ != INVALID_PAGE_ID && cursor_ >= guard_.As<LeafPage>()->GetSize()) {
+    // The next leaf is read by page id once this one is no longer latched: it must not be deleted in between.
+    EpochManager::Guard epoch(&tree_->epochs_);
+    auto *leaf = guard_.As<LeafPage>();
+    page_id_t next_page_id = leaf->GetNextPageId();
+    if (next_page_id == INVALID_PAGE_ID) {
+      guard_.Drop();
+      page_id_ = INVALID_PAGE_ID;
+      cursor_ = 0;
+      return;
+    }
+    // A leaf read again after the next one was unlinked may have handed its last keys over: never move back.
+    if (leaf->GetSize() > 0 &&
+        (!has_resume_key_ || tree_->comparator_(leaf->KeyAt(leaf->GetSize() - 1), resume_key_) >= 0)) {
+      resume_key_ = leaf->KeyAt(leaf->GetSize() - 1);
+      has_resume_key_ = true;
+      resume_key_visited_ = true;
+    }
+    // Writers rebalancing leaves latch them in either order, so this leaf must not stay latched while the next one is
+    // latched. It stays pinned instead, and its version tells whether the next leaf was unlinked in the meantime.
+    BufferPoolManager *buffer_pool = tree_->buffer_pool_manager_;
+    Page *page = guard_.GetPage();
+    uint64_t version = page->GetVersion();
+    BasicPageGuard pin = buffer_pool->FetchPageBasic(page_id_);
+    guard_.Drop();
+    ReadPageGuard next_guard = buffer_pool->FetchPageRead(next_page_id);
+    if (!pin.IsValid() || !next_guard.IsValid()) {
+      page_id_ = INVALID_PAGE_ID;
+      throw Exception(ExceptionType::OUT_OF_MEMORY, "IndexIterator: every frame of the buffer pool is pinned");
+    }
+    if (page->ValidateVersion(version)) {
+      guard_ = std::move(next_guard);
+      page_id_ = next_page_id;
+    } else {
+      // This leaf changed, and may since have been unlinked and reused for another page of the tree: look the resume
+      // key up from the root instead of reading it again.
+      next_guard.Drop();
+      pin.Drop();
+      guard_ = has_resume_key_ ? tree_->FindLeafRead(resume_key_) : tree_->FindLeafRead(KeyType(), true);
+      if (!guard_.IsValid()) {
+        page_id_ = INVALID_PAGE_ID;
+        cursor_ = 0;
+        return;
+      }
+      page_id_ = guard_.PageId();
+    }
+    cursor_ = 0;
+    if (has_resume_key_) {
+      SeekResumeKey();
+    }
+  }
+}
+
 template class IndexIterator<GenericKey<4>, RID, GenericComparator<4>>;
 
 template class IndexIterator<GenericKey<8>, RID, GenericComparator<8>>;
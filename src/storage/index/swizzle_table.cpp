@@ -0,0 +1,102 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// swizzle_table.cpp
+//
+// Identification: src/storage/index/swizzle_table.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/index/swizzle_table.h"
+
+namespace bustub {
+
+SwizzleTable::SwizzleTable(BufferPoolManager *bpm, size_t capacity, int fanout)
+    : pins_(bpm->GetLongPinBudget()), fanout_(fanout), free_nodes_(capacity), nodes_(capacity) {
+  free_list_.reserve(capacity);
+  for (auto &node : nodes_) {
+    node.children_ = std::make_unique<std::atomic<Node *>[]>(fanout_);
+    free_list_.push_back(&node);
+  }
+}
+
+SwizzleTable::~SwizzleTable() { pins_->Forget(this); }
+
+auto SwizzleTable::Resolve(const std::atomic<Node *> &link, page_id_t page_id) const -> Node * {
+  Node *node = link.load(std::memory_order_acquire);
+  if (node == nullptr || node->page_id_.load(std::memory_order_acquire) != page_id) {
+    return nullptr;
+  }
+  return node;
+}
+
+auto SwizzleTable::Swizzle(std::atomic<Node *> *link, page_id_t page_id) -> Node * {
+  std::scoped_lock lock(latch_);
+  Node *node;
+  auto it = swizzled_.find(page_id);
+  if (it != swizzled_.end()) {
+    node = it->second;
+  } else {
+    if (free_list_.empty()) {
+      return nullptr;
+    }
+    Page *page = pins_->Pin(page_id, this);
+    if (page == nullptr) {
+      return nullptr;
+    }
+    node = free_list_.back();
+    free_list_.pop_back();
+    free_nodes_.store(free_list_.size(), std::memory_order_relaxed);
+    node->page_.store(page, std::memory_order_relaxed);
+    for (int i = 0; i < fanout_; i++) {
+      node->children_[i].store(nullptr, std::memory_order_relaxed);
+    }
+    // Publish the frame and the cleared links together with the page id.
+    node->page_id_.store(page_id, std::memory_order_release);
+    swizzled_.emplace(page_id, node);
+  }
+  link->store(node, std::memory_order_release);
+  return node;
+}
+
+void SwizzleTable::Unswizzle(page_id_t page_id) {
+  std::scoped_lock lock(latch_);
+  auto it = swizzled_.find(page_id);
+  if (it == swizzled_.end()) {
+    return;
+  }
+  Node *node = it->second;
+  swizzled_.erase(it);
+  node->page_id_.store(INVALID_PAGE_ID, std::memory_order_release);
+  pins_->Unpin(page_id);
+  free_list_.push_back(node);
+  free_nodes_.store(free_list_.size(), std::memory_order_relaxed);
+}
+
+void SwizzleTable::Release(page_id_t page_id) {
+  Node *node;
+  {
+    std::scoped_lock lock(latch_);
+    auto it = swizzled_.find(page_id);
+    if (it == swizzled_.end()) {
+      return;
+    }
+    node = it->second;
+    swizzled_.erase(it);
+    node->page_id_.store(INVALID_PAGE_ID);
+  }
+  // Readers that latched the page through the node before it was dropped hold no pin of their own: wait for them.
+  // Readers that latch it from now on see the node dropped.
+  Page *page = node->page_.load(std::memory_order_relaxed);
+  page->WLatch();
+  page->WUnlatch();
+  pins_->Unpin(page_id);
+  std::scoped_lock lock(latch_);
+  free_list_.push_back(node);
+  free_nodes_.store(free_list_.size(), std::memory_order_relaxed);
+}
+
+}  // namespace bustub
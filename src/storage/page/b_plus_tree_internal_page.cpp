@@ -9,6 +9,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <iostream>
 #include <sstream>
 
@@ -21,24 +22,70 @@ namespace bustub {
  *****************************************************************************/
 /*
  * Init method after creating a new internal page
- * Including set page type, set current size, set page id, set parent id and set
- * max page size
+ * Including set page type, set current size, set page id and set max page size
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size) {
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Init(page_id_t page_id, int max_size) {
+  SetPageType(IndexPageType::INTERNAL_PAGE);
+  size_ = 0;
   page_id_ = page_id;
-  parent_page_id_ = parent_id;
   max_size_ = max_size;
+  next_page_id_ = INVALID_PAGE_ID;
+  fences_.Init();
 }
+
+/*
+ * Helper methods to set/get the page id of the right sibling, on the same level
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::GetNextPageId() const -> page_id_t { return next_page_id_; }
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
+
+/*
+ * Helper methods to get the arrays of keys and of values, in the split layout
+ * where the values start after room for INTERNAL_PAGE_SIZE keys
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::Keys() const -> const KeyType * {
+  return reinterpret_cast<const KeyType *>(array_);
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::Keys() -> KeyType * { return reinterpret_cast<KeyType *>(array_); }
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::Values() const -> const ValueType * {
+  return reinterpret_cast<const ValueType *>(reinterpret_cast<const char *>(array_) +
+                                             INTERNAL_PAGE_SIZE * sizeof(KeyType));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::Values() -> ValueType * {
+  return reinterpret_cast<ValueType *>(reinterpret_cast<char *>(array_) + INTERNAL_PAGE_SIZE * sizeof(KeyType));
+}
+
 /*
  * Helper method to get/set the key associated with input "index"(a.k.a
  * array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyAt(int index) const -> KeyType { return array_[index].first; }
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyAt(int index) const -> KeyType {
+  if constexpr (SPLIT_LAYOUT) {
+    return Keys()[index];
+  }
+  return array_[index].first;
+}
 
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) { array_[index].first = key; }
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) {
+  if constexpr (SPLIT_LAYOUT) {
+    Keys()[index] = key;
+  } else {
+    array_[index].first = key;
+  }
+}
 
 /*
  * Helper method to find and return array index(or offset), so that its value
@@ -47,46 +94,106 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetKeyAt(int index, const KeyType &key) { a
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueIndex(const ValueType &value) const -> int {
   for (int i = 0; i < size_; ++i) {
-    if (value == array_[i].second) {
+    if (value == ValueAt(i)) {
       return i;
     }
   }
-  return 0;
+  return -1;
 }
 
 /*
- * Helper method to get the value associated with input "index"(a.k.a array
+ * Helper method to get/set the value associated with input "index"(a.k.a array
  * offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const -> ValueType { return array_[index].second; }
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::ValueAt(int index) const -> ValueType {
+  if constexpr (SPLIT_LAYOUT) {
+    return Values()[index];
+  }
+  return array_[index].second;
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetValueAt(int index, const ValueType &value) {
+  if constexpr (SPLIT_LAYOUT) {
+    Values()[index] = value;
+  } else {
+    array_[index].second = value;
+  }
+}
+
+/*
+ * Helper methods to get/set the key & value pair associated with input
+ * "index"(a.k.a array offset)
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::ItemAt(int index) const -> MappingType {
+  return std::make_pair(KeyAt(index), ValueAt(index));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::SetItem(int index, const MappingType &pair) {
+  SetKeyAt(index, pair.first);
+  SetValueAt(index, pair.second);
+}
+
+/*
+ * Helper method to move {count} key & value pairs from index {from} to index
+ * {to}, where the two ranges may overlap
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveItems(int from, int to, int count) {
+  auto move = [&](auto *items) {
+    if (to < from) {
+      std::copy(items + from, items + from + count, items + to);
+    } else {
+      std::copy_backward(items + from, items + from + count, items + to + count);
+    }
+  };
+  if constexpr (SPLIT_LAYOUT) {
+    move(Keys());
+    move(Values());
+  } else {
+    move(array_);
+  }
+}
 
 /*****************************************************************************
  * LOOKUP
  *****************************************************************************/
 /*
- * Find and return the child pointer(page_id) which points to the child page
- * that contains input "key"
+ * Find and return the index of the child pointer which points to the child
+ * page that contains input "key"
  * Start the search from the second key(the first key should always be invalid)
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const KeyType &key, const KeyComparator &comparator) const -> ValueType {
-  if (size_ == 1) {
-    return array_[0].second;
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::KeyIndex(const KeyType &key, const KeyComparator &comparator) const -> int {
+  if constexpr (KEY_SEARCH) {
+    // The number of keys not greater than key, from the second one on, is the index of the last of them.
+    return size_ <= 1 ? 0 : BPlusTreeKeySearch<sizeof(KeyType)>::CountBelow(Keys() + 1, size_ - 1, key, true);
   }
   int l = 1;
   int r = size_ - 1;
   int res = 0;
   while (l <= r) {
     int mid = (l + r) >> 1;
-    if (comparator(array_[mid].first, key) <= 0) {
+    if (comparator(KeyAt(mid), key) <= 0) {
       res = mid;
       l = mid + 1;
     } else {
       r = mid - 1;
     }
   }
-  return array_[res].second;
+  return res;
+}
+
+/*
+ * Find and return the child pointer(page_id) which points to the child page
+ * that contains input "key"
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::Lookup(const KeyType &key, const KeyComparator &comparator) const -> ValueType {
+  return ValueAt(KeyIndex(key, comparator));
 }
 
 /*****************************************************************************
@@ -102,9 +209,22 @@ INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::PopulateNewRoot(const ValueType &old_value, const KeyType &new_key,
                                                      const ValueType &new_value) {
   size_ = 2;
-  array_[0].second = old_value;
-  array_[1] = std::make_pair(new_key, new_value);
+  SetValueAt(0, old_value);
+  SetItem(1, std::make_pair(new_key, new_value));
+}
+/*
+ * Fill an empty page with key & value pairs sorted by key, when the tree is
+ * built bottom-up. The key of the first pair is the key the parent uses to
+ * separate this page from its left sibling, and lands in the invalid slot.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Populate(const MappingType *items, int size) {
+  for (int i = 0; i < size; i++) {
+    SetItem(size_ + i, items[i]);
+  }
+  size_ += size;
 }
+
 /*
  * Insert new_key & new_value pair right after the pair with its value ==
  * old_value
@@ -113,7 +233,10 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::PopulateNewRoot(const ValueType &old_value,
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertNodeAfter(const ValueType &old_value, const KeyType &new_key,
                                                      const ValueType &new_value) -> int {
-  return 0;
+  int index = ValueIndex(old_value) + 1;
+  MoveItems(index, index + 1, size_ - index);
+  SetItem(index, std::make_pair(new_key, new_value));
+  return ++size_;
 }
 
 /*****************************************************************************
@@ -121,33 +244,26 @@ auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::InsertNodeAfter(const ValueType &old_value,
  *****************************************************************************/
 /*
  * Remove half of key & value pairs from this page to "recipient" page
+ * The first key moved lands in the invalid slot of the recipient: it is the
+ * key the parent should use to separate the two pages.
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveHalfTo(BPlusTreeInternalPage *recipient,
-                                                BufferPoolManager *buffer_pool_manager) -> KeyType {
-  auto index = size_ / 2;
-  recipient->SetSize(size_ - index);
-  recipient->SetItem(0, std::make_pair(array_[index].first, array_[index].second));
-  for (int i = index + 1; i < size_; ++i) {
-    recipient->SetItem(i - index, std::make_pair(array_[i].first, array_[i].second));
-  }
-  buffer_pool_manager->UnpinPage(recipient->GetPageId(), true);
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveHalfTo(BPlusTreeInternalPage *recipient) {
+  int index = size_ / 2;
+  recipient->CopyNFrom(this, index, size_ - index);
   size_ = index;
-
-  return array_[index].first;
 }
 
-/* Copy entries into me, starting from {items} and copy {size} entries.
- * Since it is an internal page, for all entries (pages) moved, their parents page now changes to me.
- * So I need to 'adopt' them by changing their parent page id, which needs to be persisted with BufferPoolManger
+/* Copy {size} entries of page, starting from index, to my end.
+ * Children do not point back to their parent, so moving them is a plain copy.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(MappingType *items, int size) {
-  for (int i = size_ - 1; i >= 0; i--) {
-    array_[i + size] = array_[i];
-  }
-  for (int i = 0; i < size; ++i) {
-    array_[i] = items[i];
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(const BPlusTreeInternalPage *page, int index, int size) {
+  if constexpr (SPLIT_LAYOUT) {
+    std::copy(page->Keys() + index, page->Keys() + index + size, Keys() + size_);
+    std::copy(page->Values() + index, page->Values() + index + size, Values() + size_);
+  } else {
+    std::copy(page->array_ + index, page->array_ + index + size, array_ + size_);
   }
   size_ += size;
 }
@@ -162,9 +278,7 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyNFrom(MappingType *items, int size) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Remove(int index) {
-  for (int i = index; i + 1 < size_; ++i) {
-    array_[i] = array_[i + 1];
-  }
+  MoveItems(index + 1, index, size_ - index - 1);
   size_--;
 }
 
@@ -173,29 +287,24 @@ void B_PLUS_TREE_INTERNAL_PAGE_TYPE::Remove(int index) {
  * NOTE: only call this method within AdjustRoot()(in b_plus_tree.cpp)
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::RemoveAndReturnOnlyChild() -> ValueType { return INVALID_PAGE_ID; }
+auto B_PLUS_TREE_INTERNAL_PAGE_TYPE::RemoveAndReturnOnlyChild() -> ValueType {
+  size_ = 0;
+  return ValueAt(0);
+}
 /*****************************************************************************
  * MERGE
  *****************************************************************************/
 /*
- * Remove all of key & value pairs from this page to "recipient" page.
- * The middle_key is the separation key you should get from the parent. You need
- * to make sure the middle key is added to the recipient to maintain the invariant.
- * You also need to use BufferPoolManager to persist changes to the parent page id for those
- * pages that are moved to the recipient
+ * Remove all of key & value pairs from this page to the end of "recipient"
+ * page, its left sibling, which takes over the next page id of this page.
+ * The middle_key is the separation key you should get from the parent. It
+ * takes the place of the invalid first key of this page in the recipient.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void BPlusTreeInternalPage<KeyType, ValueType, KeyComparator>::MoveAllTo(BPlusTreeInternalPage *recipient,
-                                                                         const KeyType &middle_key, int opt) {
-  if (opt == 0) {
-    recipient->CopyLastFrom(std::make_pair(middle_key, array_[0].second));
-    for (int i = 1; i < size_; ++i) {
-      recipient->CopyLastFrom(array_[i]);
-    }
-  } else {
-    recipient->SetKeyAt(0, middle_key);
-    recipient->CopyNFrom(array_, size_);
-  }
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveAllTo(BPlusTreeInternalPage *recipient, const KeyType &middle_key) {
+  SetKeyAt(0, middle_key);
+  recipient->CopyNFrom(this, 0, size_);
+  recipient->SetNextPageId(next_page_id_);
   size_ = 0;
 }
 
@@ -205,185 +314,46 @@ void BPlusTreeInternalPage<KeyType, ValueType, KeyComparator>::MoveAllTo(BPlusTr
 /*
  * Remove the first key & value pair from this page to tail of "recipient" page.
  *
- * The middle_key is the separation key you should get from the parent. You need
- * to make sure the middle key is added to the recipient to maintain the invariant.
- * You also need to use BufferPoolManager to persist changes to the parent page id for those
- * pages that are moved to the recipient
+ * The middle_key is the separation key you should get from the parent. It
+ * goes down with the moved child, and the key left in the invalid first slot
+ * of this page is the new separation key for the parent.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeInternalPage *recipient,
-                                                      BufferPoolManager *bufferPoolManager) {
-  auto element = array_[0];
-  auto first_page = reinterpret_cast<BPlusTreePage *>(bufferPoolManager->FetchPage(element.second));
-  first_page->SetParentPageId(recipient->GetPageId());
-  bufferPoolManager->UnpinPage(first_page->GetPageId(), true);
-  recipient->CopyLastFrom(element);
-  for (int i = 0; i + 1 < size_; ++i) {
-    array_[i] = array_[i + 1];
-  }
-  size_--;
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key) {
+  recipient->CopyLastFrom(std::make_pair(middle_key, ValueAt(0)));
+  Remove(0);
 }
 
 /* Append an entry at the end.
- * Since it is an internal page, the moved entry(page)'s parent needs to be updated.
- * So I need to 'adopt' it by changing its parent page id, which needs to be persisted with BufferPoolManger
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyLastFrom(const MappingType &pair) {
-  array_[size_] = pair;
+  SetItem(size_, pair);
   size_++;
 }
 
 /*
  * Remove the last key & value pair from this page to head of "recipient" page.
- * You need to handle the original dummy key properly, e.g. updating recipient’s array to position the middle_key at the
- * right place.
- * You also need to use BufferPoolManager to persist changes to the parent page id for those pages that are
- * moved to the recipient
+ * The middle_key goes down in front of the first key of the recipient, and the
+ * key moved into the invalid first slot of the recipient is the new separation
+ * key for the parent.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeInternalPage *recipient,
-                                                       BufferPoolManager *bufferPoolManager) {
-  auto element = array_[size_ - 1];
-  auto last_page = reinterpret_cast<BPlusTreePage *>(bufferPoolManager->FetchPage(element.second));
-  last_page->SetParentPageId(recipient->GetPageId());
-  bufferPoolManager->UnpinPage(last_page->GetPageId(), true);
-  recipient->CopyFirstFrom(element);
+void B_PLUS_TREE_INTERNAL_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeInternalPage *recipient, const KeyType &middle_key) {
+  recipient->SetKeyAt(0, middle_key);
+  recipient->CopyFirstFrom(ItemAt(size_ - 1));
   size_--;
 }
 
 /* Append an entry at the beginning.
- * Since it is an internal page, the moved entry(page)'s parent needs to be updated.
- * So I need to 'adopt' it by changing its parent page id, which needs to be persisted with BufferPoolManger
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_INTERNAL_PAGE_TYPE::CopyFirstFrom(const MappingType &pair) {
-  for (int i = size_; i > 0; i--) {
-    array_[i] = array_[i - 1];
-  }
-  array_[0] = pair;
+  MoveItems(0, 1, size_);
+  SetItem(0, pair);
   size_++;
 }
 
-INDEX_TEMPLATE_ARGUMENTS
-auto BPlusTreeInternalPage<KeyType, ValueType, KeyComparator>::Insert(const KeyType &key, const ValueType &value,
-                                                                      const KeyComparator &comparator) -> int {
-  if (size_ <= 1 || comparator(array_[size_ - 1].first, key) < 0) {
-    array_[size_] = std::make_pair(key, value);
-  } else {
-    int l = 1;
-    int r = size_ - 1;
-    int res = r;
-    while (l <= r) {
-      int mid = (l + r) >> 1;
-      if (comparator(array_[mid].first, key) >= 0) {
-        res = mid;
-        r = mid - 1;
-      } else {
-        l = mid + 1;
-      }
-    }
-    for (int i = size_; i > res; i--) {
-      array_[i] = array_[i - 1];
-    }
-    array_[res] = std::make_pair(key, value);
-  }
-
-  ++size_;
-  return size_;
-}
-
-INDEX_TEMPLATE_ARGUMENTS
-void BPlusTreeInternalPage<KeyType, ValueType, KeyComparator>::SetItem(int index, std::pair<KeyType, ValueType> item) {
-  array_[index] = item;
-}
-
-INDEX_TEMPLATE_ARGUMENTS
-void BPlusTreeInternalPage<KeyType, ValueType, KeyComparator>::UpdateParentPageId(
-    BufferPoolManager *buffer_pool_manager) {
-  for (int i = 0; i < size_; ++i) {
-    auto child_page = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager->FetchPage(array_[i].second));
-    child_page->SetParentPageId(page_id_);
-    buffer_pool_manager->UnpinPage(array_[i].second, true);
-  }
-}
-
-INDEX_TEMPLATE_ARGUMENTS
-void BPlusTreeInternalPage<KeyType, ValueType, KeyComparator>::FindSiblings(KeyType key, KeyComparator comparator,
-                                                                            page_id_t *left_sibling_page_id,
-                                                                            page_id_t *right_sibling_page_id,
-                                                                            int *index) {
-  /*
-  int l = 1;
-  int r = size_ - 1;
-  int res = r;
-  while (l <= r) {
-    int mid = (l + r) >> 1;
-    if (comparator(array_[mid].first, key) >= 0) {
-      res = mid;
-      r = mid - 1;
-    } else {
-      l = mid + 1;
-    }
-  }
-  */
-  int l = 1;
-  int r = size_ - 1;
-  int res = 0;
-  while (l <= r) {
-    int mid = (l + r) >> 1;
-    if (comparator(array_[mid].first, key) <= 0) {
-      res = mid;
-      l = mid + 1;
-    } else {
-      r = mid - 1;
-    }
-  }
-  if (res >= 1) {
-    *left_sibling_page_id = array_[res - 1].second;
-  }
-  if (res + 1 < size_) {
-    *right_sibling_page_id = array_[res + 1].second;
-  }
-  *index = res;
-}
-
-INDEX_TEMPLATE_ARGUMENTS
-void BPlusTreeInternalPage<KeyType, ValueType, KeyComparator>::UpdateNewParentId(
-    page_id_t new_page_id, BufferPoolManager *buffer_pool_manager) {
-  for (int i = 0; i < static_cast<int>(size_); ++i) {
-    auto child_page = reinterpret_cast<BPlusTreePage *>(buffer_pool_manager->FetchPage(array_[i].second));
-    child_page->SetParentPageId(new_page_id);
-    buffer_pool_manager->UnpinPage(child_page->GetPageId(), true);
-  }
-}
-
-INDEX_TEMPLATE_ARGUMENTS
-auto BPlusTreeInternalPage<KeyType, ValueType, KeyComparator>::LookupKey(const KeyType &key,
-                                                                         const KeyComparator &comparator) -> int {
-  if (size_ == 1) {
-    return 0;
-  }
-  int l = 1;
-  int r = size_ - 1;
-  int res = 0;
-  while (l <= r) {
-    int mid = (l + r) >> 1;
-    if (comparator(array_[mid].first, key) <= 0) {
-      res = mid;
-      l = mid + 1;
-    } else {
-      r = mid - 1;
-    }
-  }
-  return res;
-}
-
-template <typename KeyType, typename ValueType, typename KeyComparator>
-void BPlusTreeInternalPage<KeyType, ValueType, KeyComparator>::SetValueAt(int index, const ValueType &value) {
-  array_[index].second = value;
-}
-
 // valuetype for internalNode should be page id_t
 template class BPlusTreeInternalPage<GenericKey<4>, page_id_t, GenericComparator<4>>;
 template class BPlusTreeInternalPage<GenericKey<8>, page_id_t, GenericComparator<8>>;
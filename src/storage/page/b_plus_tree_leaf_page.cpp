@@ -9,6 +9,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <sstream>
 
 #include "common/exception.h"
@@ -23,14 +24,17 @@ namespace bustub {
 
 /**
  * Init method after creating a new leaf page
- * Including set page type, set current size to zero, set page id/parent id, set
- * next page id and set max size
+ * Including set page type, set current size to zero, set page id, set next
+ * page id and set max size
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, page_id_t parent_id, int max_size) {
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Init(page_id_t page_id, int max_size) {
+  SetPageType(IndexPageType::LEAF_PAGE);
+  size_ = 0;
   page_id_ = page_id;
-  parent_page_id_ = parent_id;
   max_size_ = max_size;
+  next_page_id_ = INVALID_PAGE_ID;
+  fences_.Init();
 }
 
 /**
@@ -42,18 +46,41 @@ auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetNextPageId() const -> page_id_t { return nex
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::SetNextPageId(page_id_t next_page_id) { next_page_id_ = next_page_id; }
 
+/**
+ * Helper methods to get the arrays of keys and of values, in the split layout
+ * where the values start after room for LEAF_PAGE_SIZE keys
+ */
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::Keys() const -> const KeyType * { return reinterpret_cast<const KeyType *>(array_); }
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::Keys() -> KeyType * { return reinterpret_cast<KeyType *>(array_); }
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::Values() const -> const ValueType * {
+  return reinterpret_cast<const ValueType *>(reinterpret_cast<const char *>(array_) + LEAF_PAGE_SIZE * sizeof(KeyType));
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::Values() -> ValueType * {
+  return reinterpret_cast<ValueType *>(reinterpret_cast<char *>(array_) + LEAF_PAGE_SIZE * sizeof(KeyType));
+}
+
 /**
  * Helper method to find the first index i so that array[i].first >= key
- * NOTE: This method is only used when generating index iterator
+ * @return size of the page if every key is less than key
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(const KeyType &key, const KeyComparator &comparator) const -> int {
+  if constexpr (KEY_SEARCH) {
+    return BPlusTreeKeySearch<sizeof(KeyType)>::CountBelow(Keys(), size_, key, false);
+  }
   int l = 0;
   int r = size_ - 1;
-  int res = r;
+  int res = size_;
   while (l <= r) {
     int mid = (l + r) >> 1;
-    if (comparator(array_[mid].first, key) >= 0) {
+    if (comparator(KeyAt(mid), key) >= 0) {
       res = mid;
       r = mid - 1;
     } else {
@@ -68,14 +95,55 @@ auto B_PLUS_TREE_LEAF_PAGE_TYPE::KeyIndex(const KeyType &key, const KeyComparato
  * array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const -> KeyType { return array_[index].first; }
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::KeyAt(int index) const -> KeyType {
+  if constexpr (SPLIT_LAYOUT) {
+    return Keys()[index];
+  }
+  return array_[index].first;
+}
 
 /*
  * Helper method to find and return the key & value pair associated with input
  * "index"(a.k.a array offset)
  */
 INDEX_TEMPLATE_ARGUMENTS
-auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) -> const MappingType & { return array_[index]; }
+auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) const -> MappingType {
+  if constexpr (SPLIT_LAYOUT) {
+    return std::make_pair(Keys()[index], Values()[index]);
+  }
+  return array_[index];
+}
+
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::SetItem(int index, const MappingType &item) {
+  if constexpr (SPLIT_LAYOUT) {
+    Keys()[index] = item.first;
+    Values()[index] = item.second;
+  } else {
+    array_[index] = item;
+  }
+}
+
+/*
+ * Helper method to move {count} key & value pairs from index {from} to index
+ * {to}, where the two ranges may overlap
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveItems(int from, int to, int count) {
+  auto move = [&](auto *items) {
+    if (to < from) {
+      std::copy(items + from, items + from + count, items + to);
+    } else {
+      std::copy_backward(items + from, items + from + count, items + to + count);
+    }
+  };
+  if constexpr (SPLIT_LAYOUT) {
+    move(Keys());
+    move(Values());
+  } else {
+    move(array_);
+  }
+}
 
 /*****************************************************************************
  * INSERTION
@@ -87,20 +155,26 @@ auto B_PLUS_TREE_LEAF_PAGE_TYPE::GetItem(int index) -> const MappingType & { ret
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::Insert(const KeyType &key, const ValueType &value, const KeyComparator &comparator)
     -> int {
-  if (size_ == 0 || comparator(array_[size_ - 1].first, key) < 0) {
-    array_[size_] = std::make_pair(key, value);
-  } else {
-    auto index = KeyIndex(key, comparator);
-    for (int i = size_; i > index; --i) {
-      array_[i] = array_[i - 1];
-    }
-    array_[index] = std::make_pair(key, value);
-  }
+  auto index = KeyIndex(key, comparator);
+  MoveItems(index, index + 1, size_ - index);
+  SetItem(index, std::make_pair(key, value));
 
   ++size_;
   return size_;
 }
 
+/*
+ * Fill an empty leaf page with key & value pairs sorted by key, when the tree
+ * is built bottom-up.
+ */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::Populate(const MappingType *items, int size) {
+  for (int i = 0; i < size; i++) {
+    SetItem(size_ + i, items[i]);
+  }
+  size_ += size;
+}
+
 /*****************************************************************************
  * SPLIT
  *****************************************************************************/
@@ -110,29 +184,20 @@ auto B_PLUS_TREE_LEAF_PAGE_TYPE::Insert(const KeyType &key, const ValueType &val
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveHalfTo(BPlusTreeLeafPage *recipient) {
   auto index = size_ / 2;
-  recipient->SetSize(size_ - index);
-  for (int i = 0; i < size_ - index; ++i) {
-    recipient->SetItem(i, array_[index + i]);
-  }
+  recipient->CopyNFrom(this, index, size_ - index);
   size_ = index;
 }
 
 /*
- * Copy starting from items, and copy {size} number of elements into me.
+ * Copy {size} number of elements of page, starting from index, to my end.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyNFrom(MappingType *items, int size, int opt) {
-  if (opt == 0) {
-    for (int i = 0; i < size; ++i) {
-      array_[size_ + i] = items[i];
-    }
+void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyNFrom(const BPlusTreeLeafPage *page, int index, int size) {
+  if constexpr (SPLIT_LAYOUT) {
+    std::copy(page->Keys() + index, page->Keys() + index + size, Keys() + size_);
+    std::copy(page->Values() + index, page->Values() + index + size, Values() + size_);
   } else {
-    for (int i = size_ - 1; i >= 0; i--) {
-      array_[i + size] = array_[i];
-    }
-    for (int i = 0; i < size; ++i) {
-      array_[i] = items[i];
-    }
+    std::copy(page->array_ + index, page->array_ + index + size, array_ + size_);
   }
   size_ += size;
 }
@@ -148,17 +213,11 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyNFrom(MappingType *items, int size, int opt
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::Lookup(const KeyType &key, ValueType *value, const KeyComparator &comparator) const
     -> bool {
-  if (size_ == 0) {
-    return false;
-  }
-  if (comparator(array_[size_ - 1].first, key) < 0) {
-    return false;
-  }
   auto index = KeyIndex(key, comparator);
-  if (comparator(array_[index].first, key) != 0) {
+  if (index == size_ || comparator(KeyAt(index), key) != 0) {
     return false;
   }
-  *value = array_[index].second;
+  *value = GetItem(index).second;
   return true;
 }
 
@@ -173,27 +232,11 @@ auto B_PLUS_TREE_LEAF_PAGE_TYPE::Lookup(const KeyType &key, ValueType *value, co
  */
 INDEX_TEMPLATE_ARGUMENTS
 auto B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(const KeyType &key, const KeyComparator &comparator) -> int {
-  if (size_ == 0) {
-    return 0;
-  }
-  int l = 0;
-  int r = size_ - 1;
-  int res = r;
-  while (l <= r) {
-    int mid = (l + r) >> 1;
-    if (comparator(array_[mid].first, key) >= 0) {
-      res = mid;
-      r = mid - 1;
-    } else {
-      l = mid + 1;
-    }
-  }
-  if (comparator(array_[res].first, key) != 0) {
+  auto index = KeyIndex(key, comparator);
+  if (index == size_ || comparator(KeyAt(index), key) != 0) {
     return size_;
   }
-  for (int i = res; i + 1 < size_; ++i) {
-    array_[i] = array_[i + 1];
-  }
+  MoveItems(index + 1, index, size_ - index - 1);
   --size_;
   return size_;
 }
@@ -202,13 +245,13 @@ auto B_PLUS_TREE_LEAF_PAGE_TYPE::RemoveAndDeleteRecord(const KeyType &key, const
  * MERGE
  *****************************************************************************/
 /*
- * Remove all of key & value pairs from this page to "recipient" page. Don't forget
- * to update the next_page id in the sibling page
+ * Remove all of key & value pairs from this page to the end of "recipient"
+ * page, its left sibling, which takes over the next page id of this page.
  */
 INDEX_TEMPLATE_ARGUMENTS
-void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient, int opt) {
-  // opt == 0: move all to left neighbor; opt == 1: move all to right neighbor
-  recipient->CopyNFrom(array_, size_, opt);
+void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient) {
+  recipient->CopyNFrom(this, 0, size_);
+  recipient->SetNextPageId(next_page_id_);
   size_ = 0;
 }
 
@@ -220,10 +263,8 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveAllTo(BPlusTreeLeafPage *recipient, int opt
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeLeafPage *recipient) {
-  auto element = array_[0];
-  for (int i = 0; i + 1 < size_; ++i) {
-    array_[i] = array_[i + 1];
-  }
+  auto element = GetItem(0);
+  MoveItems(1, 0, size_ - 1);
   size_--;
   recipient->CopyLastFrom(element);
 }
@@ -233,7 +274,7 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveFirstToEndOf(BPlusTreeLeafPage *recipient)
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyLastFrom(const MappingType &item) {
-  array_[size_] = item;
+  SetItem(size_, item);
   size_++;
 }
 
@@ -242,28 +283,20 @@ void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyLastFrom(const MappingType &item) {
  */
 INDEX_TEMPLATE_ARGUMENTS
 void B_PLUS_TREE_LEAF_PAGE_TYPE::MoveLastToFrontOf(BPlusTreeLeafPage *recipient) {
-  auto element = array_[size_ - 1];
+  auto element = GetItem(size_ - 1);
   size_--;
   recipient->CopyFirstFrom(element);
 }
 
-template <typename KeyType, typename ValueType, typename KeyComparator>
-void BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>::CopyFirstFrom(const std::pair<KeyType, ValueType> &item) {
-  for (int i = size_; i > 0; i--) {
-    array_[i] = array_[i - 1];
-  }
-  array_[0] = item;
-  size_++;
-}
-
-template <typename KeyType, typename ValueType, typename KeyComparator>
-void BPlusTreeLeafPage<KeyType, ValueType, KeyComparator>::SetItem(int index, std::pair<KeyType, ValueType> item) {
-  array_[index] = item;
-}
-
 /*
  * Insert item at the front of my items. Move items accordingly.
  */
+INDEX_TEMPLATE_ARGUMENTS
+void B_PLUS_TREE_LEAF_PAGE_TYPE::CopyFirstFrom(const MappingType &item) {
+  MoveItems(0, 1, size_);
+  SetItem(0, item);
+  size_++;
+}
 
 template class BPlusTreeLeafPage<GenericKey<4>, RID, GenericComparator<4>>;
 template class BPlusTreeLeafPage<GenericKey<8>, RID, GenericComparator<8>>;
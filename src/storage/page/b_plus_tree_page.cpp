@@ -18,7 +18,6 @@ namespace bustub {
  * Page type enum class is defined in b_plus_tree_page.h
  */
 auto BPlusTreePage::IsLeafPage() const -> bool { return page_type_ == IndexPageType::LEAF_PAGE; }
-auto BPlusTreePage::IsRootPage() const -> bool { return parent_page_id_ == INVALID_PAGE_ID; }
 void BPlusTreePage::SetPageType(IndexPageType page_type) { page_type_ = page_type; }
 
 /*
@@ -36,24 +35,12 @@ auto BPlusTreePage::GetMaxSize() const -> int { return max_size_; }
 void BPlusTreePage::SetMaxSize(int size) { max_size_ = size; }
 
 /*
- * Helper method to get min page size
- * Generally, min page size == max page size / 2
+ * Helper method to get min page size of a page other than the root
+ * A page splits in two halves once it reaches its max size, and two pages
+ * merge only if the result stays below max size, so min page size is half of
+ * max page size, rounded down. The root is only bounded by the tree itself.
  */
-auto BPlusTreePage::GetMinSize() const -> int {
-  if (IsRootPage()) {
-    return IsLeafPage() ? 1 : 2;
-  }
-  if (IsLeafPage()) {
-    return max_size_ / 2 + max_size_ % 2 - 1;
-  }
-  return max_size_ / 2 + max_size_ % 2;
-}
-
-/*
- * Helper methods to get/set parent page id
- */
-auto BPlusTreePage::GetParentPageId() const -> page_id_t { return parent_page_id_; }
-void BPlusTreePage::SetParentPageId(page_id_t parent_page_id) { parent_page_id_ = parent_page_id; }
+auto BPlusTreePage::GetMinSize() const -> int { return max_size_ / 2; }
 
 /*
  * Helper methods to get/set self page id
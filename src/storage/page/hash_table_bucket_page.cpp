@@ -20,7 +20,8 @@
 namespace bustub {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-auto HASH_TABLE_BUCKET_TYPE::GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result) -> bool {
+auto HASH_TABLE_BUCKET_TYPE::GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result) const
+    -> bool {
   bool flag = false;
   int size = ((BUCKET_ARRAY_SIZE - 1) / 8 + 1) * 8;
   for (int i = 0; i < size; ++i) {
@@ -34,7 +35,7 @@ auto HASH_TABLE_BUCKET_TYPE::GetValue(KeyType key, KeyComparator cmp, std::vecto
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HashTableBucketPage<KeyType, ValueType, KeyComparator>::GetAllPairs(
-    std::vector<std::pair<KeyType, ValueType>> *vec) {
+    std::vector<std::pair<KeyType, ValueType>> *vec) const {
   int size = ((BUCKET_ARRAY_SIZE - 1) / 8 + 1) * 8;
   for (int i = 0; i < size; ++i) {
     if (IsReadable(i)) {
@@ -44,7 +45,7 @@ void HashTableBucketPage<KeyType, ValueType, KeyComparator>::GetAllPairs(
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-size_t HashTableBucketPage<KeyType, ValueType, KeyComparator>::GetSize() {
+size_t HashTableBucketPage<KeyType, ValueType, KeyComparator>::GetSize() const {
   int size = ((BUCKET_ARRAY_SIZE - 1) / 8 + 1) * 8;
   int tot = 0;
   for (int i = 0; i < size; ++i) {
@@ -56,7 +57,7 @@ size_t HashTableBucketPage<KeyType, ValueType, KeyComparator>::GetSize() {
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-auto HashTableBucketPage<KeyType, ValueType, KeyComparator>::IsEmpty() -> bool {
+auto HashTableBucketPage<KeyType, ValueType, KeyComparator>::IsEmpty() const -> bool {
   int size = ((BUCKET_ARRAY_SIZE - 1) / 8 + 1) * 8;
   for (int i = 0; i < size; ++i) {
     if (IsReadable(i)) {
@@ -68,7 +69,7 @@ auto HashTableBucketPage<KeyType, ValueType, KeyComparator>::IsEmpty() -> bool {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HashTableBucketPage<KeyType, ValueType, KeyComparator>::FindElement(KeyType key, ValueType value,
-                                                                         KeyComparator cmp) -> bool {
+                                                                         KeyComparator cmp) const -> bool {
   int size = ((BUCKET_ARRAY_SIZE - 1) / 8 + 1) * 8;
   for (int i = 0; i < size; ++i) {
     if (IsReadable(i) && cmp(key, array_[i].first) == 0 && value == array_[i].second) {
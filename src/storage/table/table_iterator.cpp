@@ -10,7 +10,9 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <cassert>
+#include <utility>
 
 #include "storage/table/table_heap.h"
 
@@ -35,19 +37,20 @@ auto TableIterator::operator->() -> Tuple * {
 
 auto TableIterator::operator++() -> TableIterator & {
   BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
-  auto cur_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(tuple_->rid_.GetPageId()));
-  cur_page->RLatch();
-  assert(cur_page != nullptr);  // all pages are pinned
+  ReadPageGuard cur_guard = buffer_pool_manager->FetchPageRead(tuple_->rid_.GetPageId(), ScanAccessType());
+  assert(cur_guard.IsValid());  // all pages are pinned
+  auto cur_page = static_cast<TablePage *>(cur_guard.GetPage());
 
   RID next_tuple_rid;
   if (!cur_page->GetNextTupleRid(tuple_->rid_,
                                  &next_tuple_rid)) {  // end of this page
     while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
-      auto next_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
-      cur_page->RUnlatch();
-      buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
-      cur_page = next_page;
-      cur_page->RLatch();
+      // Latch the next page before releasing the current one, so the chain cannot change in between.
+      ReadPageGuard next_guard = buffer_pool_manager->FetchPageRead(cur_page->GetNextPageId(), ScanAccessType());
+      cur_guard = std::move(next_guard);
+      cur_page = static_cast<TablePage *>(cur_guard.GetPage());
+      ++pages_visited_;
+      ReadAhead(cur_page);
       if (cur_page->GetFirstTupleRid(&next_tuple_rid)) {
         break;
       }
@@ -55,15 +58,39 @@ auto TableIterator::operator++() -> TableIterator & {
   }
   tuple_->rid_ = next_tuple_rid;
 
+  // Copy the tuple out of the page that is already latched, rather than fetching and latching it a second time.
   if (*this != table_heap_->End()) {
-    table_heap_->GetTuple(tuple_->rid_, tuple_, txn_);
+    cur_page->GetTuple(tuple_->rid_, tuple_, txn_, table_heap_->lock_manager_);
   }
-  // release until copy the tuple
-  cur_page->RUnlatch();
-  buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
   return *this;
 }
 
+void TableIterator::ReadAhead(TablePage *page) {
+  BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
+  AccessType access_type = ScanAccessType();
+  size_t max_window = std::min<size_t>(TABLE_SCAN_READ_AHEAD_MAX, buffer_pool_manager->GetPoolSize() / 4);
+  if (access_type == AccessType::SCAN) {
+    max_window = std::min(max_window, buffer_pool_manager->GetPoolSize() / 8);
+  }
+  read_ahead_window_ = std::min(std::max<size_t>(2 * read_ahead_window_, 1), max_window);
+  if (read_ahead_distance_ > 0) {
+    --read_ahead_distance_;
+  }
+  if (read_ahead_window_ == 0 || read_ahead_distance_ > read_ahead_window_ / 2) {
+    return;
+  }
+  page_id_t next_page_id = page->GetNextPageId();
+  if (next_page_id == INVALID_PAGE_ID) {
+    return;
+  }
+  buffer_pool_manager->PrefetchPage(next_page_id, read_ahead_window_, TablePage::ReadNextPageId, access_type);
+  read_ahead_distance_ = read_ahead_window_;
+}
+
+auto TableIterator::ScanAccessType() -> AccessType {
+  return pages_visited_ > table_heap_->buffer_pool_manager_->GetPoolSize() / 4 ? AccessType::SCAN : AccessType::DEFAULT;
+}
+
 auto TableIterator::operator++(int) -> TableIterator {
   TableIterator clone(*this);
   ++(*this);
@@ -0,0 +1,171 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// arc_replacer_test.cpp
+//
+// Identification: test/buffer/arc_replacer_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/arc_replacer.h"
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+TEST(ARCReplacerTest, SampleTest) {
+  ARCReplacer arc_replacer(4);
+
+  // Scenario: pages 10-13 are loaded into frames 0-3, and page 10 is referenced a second time.
+  for (frame_id_t frame_id = 0; frame_id < 4; ++frame_id) {
+    arc_replacer.RecordAccess(frame_id, 10 + frame_id);
+    arc_replacer.Unpin(frame_id);
+  }
+  arc_replacer.Pin(0);
+  arc_replacer.RecordAccess(0, 10);
+  arc_replacer.Unpin(0);
+  EXPECT_EQ(4, arc_replacer.Size());
+
+  // Scenario: pages seen once (T1) are evicted first, in unpin order.
+  int value;
+  arc_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  arc_replacer.Remove(1);
+  EXPECT_EQ(3, arc_replacer.Size());
+
+  // Scenario: pinned frames are not victimized.
+  arc_replacer.Pin(2);
+  arc_replacer.Victim(&value);
+  EXPECT_EQ(3, value);
+  arc_replacer.Remove(3);
+  arc_replacer.Unpin(2);
+
+  // Scenario: page 11 comes back while still remembered in B1, which grows the target size of T1 and puts the page
+  // straight into T2.
+  EXPECT_EQ(0, arc_replacer.GetTargetRecencySize());
+  arc_replacer.RecordAccess(1, 11);
+  arc_replacer.Unpin(1);
+  EXPECT_EQ(1, arc_replacer.GetTargetRecencySize());
+
+  // Scenario: T1 (page 12) is at its target, so T2 gives up its frames first, in unpin order.
+  arc_replacer.Victim(&value);
+  EXPECT_EQ(0, value);
+  arc_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  arc_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+  EXPECT_FALSE(arc_replacer.Victim(&value));
+}
+
+/**
+ * Replays a page reference trace against a replacer the same way the buffer pool drives it: every reference pins the
+ * page, records the access and unpins it again.
+ * @return the fraction of references that found their page resident
+ */
+auto HitRatio(Replacer *replacer, size_t num_frames, const std::vector<page_id_t> &trace) -> double {
+  std::unordered_map<page_id_t, frame_id_t> page_table;
+  std::vector<page_id_t> frames(num_frames, INVALID_PAGE_ID);
+  size_t used_frames = 0;
+  size_t hits = 0;
+  for (auto page_id : trace) {
+    frame_id_t frame_id;
+    auto it = page_table.find(page_id);
+    if (it != page_table.end()) {
+      frame_id = it->second;
+      replacer->Pin(frame_id);
+      ++hits;
+    } else {
+      if (used_frames < num_frames) {
+        frame_id = static_cast<frame_id_t>(used_frames++);
+      } else {
+        EXPECT_TRUE(replacer->Victim(&frame_id));
+        replacer->Remove(frame_id);
+        page_table.erase(frames[frame_id]);
+      }
+      frames[frame_id] = page_id;
+      page_table[page_id] = frame_id;
+    }
+    replacer->RecordAccess(frame_id, page_id);
+    replacer->Unpin(frame_id);
+  }
+  return static_cast<double>(hits) / static_cast<double>(trace.size());
+}
+
+/** Point lookups: 80% of the references go to the first hot_pages pages, the rest are spread over num_pages pages. */
+void AppendPointLookups(std::vector<page_id_t> *trace, std::mt19937 *rng, int count, int hot_pages, int num_pages) {
+  std::bernoulli_distribution hot(0.8);
+  std::uniform_int_distribution<page_id_t> hot_page(0, hot_pages - 1);
+  std::uniform_int_distribution<page_id_t> any_page(0, num_pages - 1);
+  for (int i = 0; i < count; ++i) {
+    trace->push_back(hot(*rng) ? hot_page(*rng) : any_page(*rng));
+  }
+}
+
+/** A sequential scan over num_pages pages that are not touched by the point lookups. */
+void AppendScan(std::vector<page_id_t> *trace, int num_pages) {
+  for (int i = 0; i < num_pages; ++i) {
+    trace->push_back(1000000 + i);
+  }
+}
+
+TEST(ARCReplacerTest, HitRatioComparisonTest) {
+  const size_t num_frames = 64;
+  const int hot_pages = 48;
+  const int num_pages = 512;
+  std::mt19937 rng(15445);
+
+  // OLTP: skewed point lookups only.
+  std::vector<page_id_t> oltp;
+  AppendPointLookups(&oltp, &rng, 50000, hot_pages, num_pages);
+
+  // Mixed: point lookups with a large scan running every so often.
+  std::vector<page_id_t> mixed;
+  for (int round = 0; round < 10; ++round) {
+    AppendPointLookups(&mixed, &rng, 5000, hot_pages, num_pages);
+    AppendScan(&mixed, 1000);
+  }
+
+  // Phases: daytime point lookups, a nightly batch of repeated scans over a set that fits in the pool, then point
+  // lookups again.
+  std::vector<page_id_t> phases;
+  for (int day = 0; day < 3; ++day) {
+    AppendPointLookups(&phases, &rng, 20000, hot_pages, num_pages);
+    for (int repeat = 0; repeat < 20; ++repeat) {
+      AppendScan(&phases, 56);
+    }
+  }
+
+  std::vector<std::pair<std::string, const std::vector<page_id_t> *>> traces = {
+      {"oltp", &oltp}, {"mixed", &mixed}, {"phases", &phases}};
+  std::cout << std::fixed << std::setprecision(3) << std::setw(8) << "trace" << std::setw(8) << "LRU"
+            << std::setw(8) << "CLOCK" << std::setw(8) << "LRU-K" << std::setw(8) << "ARC" << std::endl;
+  for (const auto &[name, trace] : traces) {
+    LRUReplacer lru(num_frames);
+    ClockReplacer clock(num_frames);
+    LRUKReplacer lru_k(num_frames);
+    ARCReplacer arc(num_frames);
+    double lru_ratio = HitRatio(&lru, num_frames, *trace);
+    double clock_ratio = HitRatio(&clock, num_frames, *trace);
+    double lru_k_ratio = HitRatio(&lru_k, num_frames, *trace);
+    double arc_ratio = HitRatio(&arc, num_frames, *trace);
+    std::cout << std::setw(8) << name << std::setw(8) << lru_ratio << std::setw(8) << clock_ratio << std::setw(8)
+              << lru_k_ratio << std::setw(8) << arc_ratio << std::endl;
+    // ARC keeps the hot set away from scans like LRU-K does, and also adapts to the nightly loops.
+    EXPECT_GT(arc_ratio, lru_ratio);
+    EXPECT_GT(arc_ratio, clock_ratio);
+    EXPECT_GT(arc_ratio, lru_k_ratio - 0.01);
+  }
+}
+
+}  // namespace bustub
@@ -11,9 +11,13 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/buffer_pool_manager_instance.h"
+#include <unistd.h>
+#include <atomic>
 #include <cstdio>
 #include <random>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 #include "buffer/buffer_pool_manager.h"
 #include "gtest/gtest.h"
 
@@ -141,4 +145,666 @@ TEST(BufferPoolManagerInstanceTest, SampleTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ConcurrentFetchTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 8;
+  const int num_pages = 32;
+  const int num_threads = 8;
+  const int rounds = 200;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Every page stores its own id, so a fetch that returns the wrong frame is detected.
+  for (int i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    ASSERT_EQ(i, page_id);
+    snprintf(page->GetData(), PAGE_SIZE, "%d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([bpm, tid] {
+      for (int round = 0; round < rounds; ++round) {
+        page_id_t page_id = (tid * 7 + round) % num_pages;
+        auto *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        EXPECT_EQ(page_id, page->GetPageId());
+        EXPECT_EQ(std::to_string(page_id), std::string(page->GetData()));
+        EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(0, bpm->Count());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ConcurrentWriteBackTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+  const int num_threads = 4;
+  const int pages_per_thread = 4;
+  const int rounds = 100;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  for (int i = 0; i < num_threads * pages_per_thread; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  // Each thread increments a counter stored in its own pages. The pool is smaller than the working set, so dirty
+  // pages are constantly written back and read in again while other threads are doing the same.
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([bpm, tid] {
+      for (int round = 0; round < rounds; ++round) {
+        page_id_t page_id = tid * pages_per_thread + round % pages_per_thread;
+        Page *page = nullptr;
+        while (page == nullptr) {
+          page = bpm->FetchPage(page_id);
+        }
+        ++*reinterpret_cast<int *>(page->GetData());
+        EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  for (int i = 0; i < num_threads * pages_per_thread; ++i) {
+    auto *page = bpm->FetchPage(i);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(rounds / pages_per_thread, *reinterpret_cast<int *>(page->GetData()));
+    EXPECT_TRUE(bpm->UnpinPage(i, false));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, PageCleanerTest) {
+  const std::string db_name = "test.db";
+  const int buffer_pool_size = 10;
+  const auto saved_interval = page_cleaner_interval;
+  page_cleaner_interval = std::chrono::milliseconds(1);
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Scenario: fill the buffer pool with dirty, unpinned pages. New pages are not written until they are evicted.
+  for (int i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  EXPECT_EQ(0, disk_manager->GetNumWrites());
+
+  // Scenario: the page cleaner writes the dirty pages back in the background.
+  bpm->StartPageCleaner();
+  for (int i = 0; i < 5000 && disk_manager->GetNumWrites() < buffer_pool_size; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  bpm->StopPageCleaner();
+  EXPECT_EQ(buffer_pool_size, disk_manager->GetNumWrites());
+
+  // Scenario: every victim is clean now, so evicting them to make room for new pages costs no writes.
+  for (int i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(buffer_pool_size, disk_manager->GetNumWrites());
+
+  // Scenario: the contents written by the page cleaner can be read back.
+  for (page_id_t page_id = 0; page_id < buffer_pool_size; ++page_id) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(page_id), std::string(page->GetData()));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+
+  // Scenario: an unpinned page can be deleted even while it is being written back.
+  std::atomic<page_id_t> flushed_page_id{INVALID_PAGE_ID};
+  std::atomic<bool> done{false};
+  std::thread flusher([bpm, &flushed_page_id, &done] {
+    while (!done) {
+      bpm->FlushPage(flushed_page_id);
+    }
+  });
+  for (int i = 0; i < 1000; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    if (page == nullptr) {
+      ADD_FAILURE() << "no free frame";
+      break;
+    }
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+    flushed_page_id = page_id;
+    std::this_thread::sleep_for(std::chrono::microseconds(i % 20));
+    EXPECT_TRUE(bpm->DeletePage(page_id));
+  }
+  done = true;
+  flusher.join();
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+  page_cleaner_interval = saved_interval;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, PrefetchTest) {
+  const std::string db_name = "test.db";
+  const int buffer_pool_size = 10;
+  const int num_pages = 30;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Build a chain of pages that links every other page: 0 -> 2 -> 4 -> ...
+  for (int i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    page_id_t next_page_id = page_id + 2 < num_pages ? page_id + 2 : INVALID_PAGE_ID;
+    memcpy(page->GetData(), &next_page_id, sizeof(page_id_t));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  bpm->FlushAllPages();
+  auto next_page = [](const char *page_data) { return *reinterpret_cast<const page_id_t *>(page_data); };
+
+  // Scenario: prefetch the first pages of the chain, which are no longer resident. They are read in the background
+  // and are not pinned.
+  const int first = 0;
+  const int count = 4;
+  int reads = disk_manager->GetNumReads();
+  bpm->PrefetchPage(first, count, next_page);
+  for (int i = 0; i < 5000 && disk_manager->GetNumReads() < reads + count; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  EXPECT_EQ(reads + count, disk_manager->GetNumReads());
+  EXPECT_EQ(0, bpm->Count());
+
+  // Scenario: fetching the prefetched pages does not go to disk again.
+  for (int i = 0; i < count; ++i) {
+    page_id_t page_id = first + 2 * i;
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(reads + count, disk_manager->GetNumReads());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ScanRingTest) {
+  const std::string db_name = "test.db";
+  const int buffer_pool_size = 20;
+  const int num_hot_pages = 10;
+  const int num_pages = 80;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  for (int i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  auto fetch_hot_pages = [bpm] {
+    for (page_id_t page_id = 0; page_id < num_hot_pages; ++page_id) {
+      ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+      EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+    }
+  };
+  auto scan = [bpm](AccessType access_type) {
+    for (page_id_t page_id = num_hot_pages; page_id < num_pages; ++page_id) {
+      ASSERT_NE(nullptr, bpm->FetchPage(page_id, access_type));
+      EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+    }
+  };
+  fetch_hot_pages();
+
+  // Scenario: a scan larger than the pool only recycles the frames of the scan ring, so the hot pages stay resident.
+  scan(AccessType::SCAN);
+  int reads = disk_manager->GetNumReads();
+  fetch_hot_pages();
+  EXPECT_EQ(reads, disk_manager->GetNumReads());
+
+  // Scenario: the same scan without the hint flushes the hot pages out of the pool.
+  scan(AccessType::DEFAULT);
+  reads = disk_manager->GetNumReads();
+  fetch_hot_pages();
+  EXPECT_EQ(reads + num_hot_pages, disk_manager->GetNumReads());
+
+  // Scenario: pages pinned by the scan are never recycled while in use.
+  std::vector<Page *> pinned;
+  for (page_id_t page_id = num_hot_pages; page_id < num_hot_pages + buffer_pool_size - 1; ++page_id) {
+    pinned.push_back(bpm->FetchPage(page_id, AccessType::SCAN));
+    ASSERT_NE(nullptr, pinned.back());
+    EXPECT_EQ(page_id, pinned.back()->GetPageId());
+  }
+  for (auto *page : pinned) {
+    EXPECT_TRUE(bpm->UnpinPage(page->GetPageId(), false));
+  }
+
+  // Scenario: a shrunk pool cuts its ring down to a quarter of its frames, so the hot pages still stay resident.
+  ASSERT_TRUE(bpm->ResizePool(num_hot_pages + 4));
+  fetch_hot_pages();
+  scan(AccessType::SCAN);
+  reads = disk_manager->GetNumReads();
+  fetch_hot_pages();
+  EXPECT_EQ(reads, disk_manager->GetNumReads());
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, DirectIoTest) {
+  const std::string db_name = "test.db";
+  const int buffer_pool_size = 10;
+  const int num_pages = 30;
+
+  enable_direct_io = true;
+  enable_huge_pages = true;
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  enable_direct_io = false;
+  enable_huge_pages = false;
+
+  // Scenario: the data of every frame is page-aligned, so it can be read and written without a bounce buffer.
+  for (int i = 0; i < buffer_pool_size; ++i) {
+    EXPECT_EQ(0, reinterpret_cast<uintptr_t>(bpm->GetPages()[i].GetData()) % PAGE_SIZE);
+  }
+
+  // Scenario: pages make the round trip to disk through evictions.
+  for (int i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(page_id), std::string(page->GetData()));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, FlushAllTest) {
+  const std::string db_name = "test.db";
+  const int buffer_pool_size = 10;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  for (int i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  // Scenario: only the dirty pages are written.
+  int writes = disk_manager->GetNumWrites();
+  bpm->FlushAllPages();
+  EXPECT_EQ(writes + buffer_pool_size, disk_manager->GetNumWrites());
+  writes = disk_manager->GetNumWrites();
+  bpm->FlushAllPages();
+  EXPECT_EQ(writes, disk_manager->GetNumWrites());
+
+  for (page_id_t page_id : {7, 2, 3}) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d again", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  bpm->FlushAllPages();
+  EXPECT_EQ(writes + 3, disk_manager->GetNumWrites());
+
+  // Scenario: the flushed pages are on disk.
+  char data[PAGE_SIZE];
+  for (page_id_t page_id = 0; page_id < buffer_pool_size; ++page_id) {
+    disk_manager->ReadPage(page_id, data);
+    bool again = page_id == 7 || page_id == 2 || page_id == 3;
+    EXPECT_EQ("page " + std::to_string(page_id) + (again ? " again" : ""), std::string(data));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, WriteFailureTest) {
+  const std::string db_name = "test.db";
+  const int buffer_pool_size = 10;
+  const int num_pages = 4;
+
+  // The second segment, with pages 2 and 3, fails every write. It counts as part of the database from the start, so
+  // the first new page is page 2.
+  remove("test.db");
+  remove("test.db.1");
+  remove("test.fsm");
+  ASSERT_EQ(0, symlink("/dev/full", "test.db.1"));
+  auto *disk_manager = new DiskManager(db_name, 2 * PAGE_SIZE);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  for (int i = 0; i < num_pages; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    ASSERT_EQ(i + 2, page_id);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  // Scenario: the pages that could not be written are still dirty after a flush, the others are clean.
+  int writes = disk_manager->GetNumWrites();
+  bpm->FlushAllPages();
+  EXPECT_EQ(writes + 2, disk_manager->GetNumWrites());
+  for (page_id_t page_id = 2; page_id < num_pages + 2; ++page_id) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(page_id < 4, page->IsDirty()) << page_id;
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+
+  // Scenario: so is a page that fails to flush on its own.
+  EXPECT_FALSE(bpm->FlushPage(3));
+  auto *page = bpm->FetchPage(3);
+  ASSERT_NE(nullptr, page);
+  EXPECT_TRUE(page->IsDirty());
+  EXPECT_TRUE(bpm->UnpinPage(3, false));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.fsm");
+  // Reserving the pages created the segments of a whole extent.
+  for (int segment = 1; segment < EXTENT_SIZE / 2; ++segment) {
+    remove(("test.db." + std::to_string(segment)).c_str());
+  }
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, PageReuseTest) {
+  const std::string db_name = "test.db";
+  const int buffer_pool_size = 10;
+  const int num_pages = 5;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  page_id_t page_id;
+  for (int i = 0; i < num_pages; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  bpm->FlushAllPages();
+
+  // Scenario: deleted pages are handed out again, whether they are resident or not.
+  EXPECT_TRUE(bpm->DeletePage(3));
+  EXPECT_TRUE(bpm->DeletePage(1));
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(1, page_id);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(3, page_id);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(num_pages, page_id);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  delete bpm;
+
+  // Scenario: a new buffer pool on an existing database does not hand out its pages again.
+  bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(num_pages + 1, page_id);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+
+  // Scenario: a deleted page read again through a stale page id is skipped while it is resident, but not lost.
+  EXPECT_TRUE(bpm->DeletePage(2));
+  ASSERT_NE(nullptr, bpm->FetchPage(2));
+  EXPECT_TRUE(bpm->UnpinPage(2, false));
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(num_pages + 2, page_id);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  delete bpm;
+  bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(2, page_id);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, StatsTest) {
+  const std::string db_name = "test.db";
+  const int buffer_pool_size = 2;
+  const int num_pages = 3;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, 1, 0, disk_manager, nullptr, ReplacerType::LRU, 0);
+  EXPECT_EQ(0, bpm->GetNumaNode());
+
+  page_id_t page_id;
+  for (int i = 0; i < num_pages; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  // Scenario: page 2 is resident, pages 0 and 1 have to be read back in.
+  for (page_id_t id : {2, 0, 1, 1}) {
+    ASSERT_NE(nullptr, bpm->FetchPage(id));
+    EXPECT_TRUE(bpm->UnpinPage(id, false));
+  }
+  BufferPoolStats stats = bpm->GetStats();
+  EXPECT_EQ(2, stats.hits_);
+  EXPECT_EQ(2, stats.misses_);
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ResizeTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  EXPECT_FALSE(bpm->ResizePool(0));
+  EXPECT_FALSE(bpm->ResizePool(bpm->GetMaxPoolSize() + 1));
+
+  // Scenario: a grown pool holds twice as many pinned pages.
+  std::vector<page_id_t> page_ids;
+  page_id_t page_id;
+  for (size_t i = 0; i < 2 * buffer_pool_size; ++i) {
+    if (i == buffer_pool_size) {
+      EXPECT_EQ(nullptr, bpm->NewPage(&page_id));
+      EXPECT_TRUE(bpm->ResizePool(2 * buffer_pool_size));
+      EXPECT_EQ(2 * buffer_pool_size, bpm->GetPoolSize());
+    }
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    page_ids.push_back(page_id);
+  }
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id));
+
+  // Scenario: pinned pages past the new size stay until they are unpinned; then a retry writes them back.
+  EXPECT_FALSE(bpm->ResizePool(buffer_pool_size));
+  EXPECT_EQ(buffer_pool_size, bpm->GetPoolSize());
+  for (auto id : page_ids) {
+    EXPECT_TRUE(bpm->UnpinPage(id, true));
+  }
+  EXPECT_TRUE(bpm->ResizePool(buffer_pool_size));
+
+  // Scenario: with free frames left, shrinking moves the pages of retired frames instead of evicting them.
+  EXPECT_TRUE(bpm->DeletePage(page_ids[0]));
+  EXPECT_TRUE(bpm->DeletePage(page_ids[1]));
+  EXPECT_TRUE(bpm->ResizePool(buffer_pool_size / 2));
+  BufferPoolStats before = bpm->GetStats();
+  for (size_t i = 2; i < page_ids.size(); ++i) {
+    Page *page = bpm->FetchPage(page_ids[i]);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(page_ids[i]), std::string(page->GetData()));
+    EXPECT_TRUE(bpm->UnpinPage(page_ids[i], false));
+  }
+  BufferPoolStats after = bpm->GetStats();
+  EXPECT_EQ(2, after.hits_ - before.hits_);
+  EXPECT_EQ(page_ids.size() - 4, after.misses_ - before.misses_);
+
+  // Scenario: the pages still pinned in retired frames do not take up the frames left.
+  EXPECT_TRUE(bpm->ResizePool(buffer_pool_size));
+  std::vector<Page *> pages;
+  for (size_t i = 2; i < 2 + buffer_pool_size; ++i) {
+    pages.push_back(bpm->FetchPage(page_ids[i]));
+    ASSERT_NE(nullptr, pages.back());
+  }
+  EXPECT_FALSE(bpm->ResizePool(buffer_pool_size / 2));
+  for (Page *page : pages) {
+    if (page < bpm->GetPages() + buffer_pool_size / 2) {
+      EXPECT_TRUE(bpm->UnpinPage(page->GetPageId(), false));
+    }
+  }
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, VersionTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 1;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Scenario: a version read from a frame does not validate once the frame holds another page, new or read from disk.
+  page_id_t page_id_0;
+  page_id_t page_id_1;
+  Page *page = bpm->NewPage(&page_id_0);
+  ASSERT_NE(nullptr, page);
+  uint64_t version = page->GetVersion();
+  EXPECT_EQ(0, version % 2);
+  EXPECT_TRUE(bpm->UnpinPage(page_id_0, true));
+  ASSERT_EQ(page, bpm->NewPage(&page_id_1));
+  EXPECT_FALSE(page->ValidateVersion(version));
+  version = page->GetVersion();
+  EXPECT_EQ(0, version % 2);
+  EXPECT_TRUE(bpm->UnpinPage(page_id_1, true));
+  ASSERT_EQ(page, bpm->FetchPage(page_id_0));
+  EXPECT_FALSE(page->ValidateVersion(version));
+  EXPECT_EQ(0, page->GetVersion() % 2);
+  EXPECT_TRUE(bpm->UnpinPage(page_id_0, false));
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ArcResizeTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 8;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, nullptr, ReplacerType::ARC);
+
+  // Scenario: shrinking a pool whose frames are all pinned keeps more resident pages than ARC allows for the new size,
+  // and no ghost to drop in their place.
+  std::vector<page_id_t> page_ids;
+  page_id_t page_id;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    page_ids.push_back(page_id);
+  }
+  EXPECT_FALSE(bpm->ResizePool(2));
+  EXPECT_EQ(2, bpm->GetPoolSize());
+
+  // Scenario: once unpinned, the pages of the retired frames are written back, and the pool keeps working.
+  for (auto id : page_ids) {
+    EXPECT_TRUE(bpm->UnpinPage(id, true));
+  }
+  EXPECT_TRUE(bpm->ResizePool(2));
+  for (auto id : page_ids) {
+    ASSERT_NE(nullptr, bpm->FetchPage(id));
+    EXPECT_TRUE(bpm->UnpinPage(id, false));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
 }  // namespace bustub
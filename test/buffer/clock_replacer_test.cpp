@@ -19,7 +19,7 @@
 
 namespace bustub {
 
-TEST(ClockReplacerTest, DISABLED_SampleTest) {
+TEST(ClockReplacerTest, SampleTest) {
   ClockReplacer clock_replacer(7);
 
   // Scenario: unpin six elements, i.e. add them to the replacer.
@@ -59,4 +59,56 @@ TEST(ClockReplacerTest, DISABLED_SampleTest) {
   EXPECT_EQ(4, value);
 }
 
+TEST(ClockReplacerTest, ConcurrentUnpinTest) {
+  const int num_threads = 4;
+  const int frames_per_thread = 64;
+  const int num_frames = num_threads * frames_per_thread;
+  const size_t num_victims = 128;
+  ClockReplacer clock_replacer(num_frames);
+
+  // Scenario: threads keep pinning and unpinning their own frames while another thread takes victims.
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&clock_replacer, tid] {
+      for (int round = 0; round < 100; ++round) {
+        for (int i = 0; i < frames_per_thread; ++i) {
+          clock_replacer.Unpin(tid * frames_per_thread + i);
+        }
+        if (round < 99) {
+          for (int i = 0; i < frames_per_thread; i += 2) {
+            clock_replacer.Pin(tid * frames_per_thread + i);
+          }
+        }
+      }
+    });
+  }
+  std::vector<frame_id_t> victims;
+  while (victims.size() < num_victims) {
+    frame_id_t victim;
+    if (clock_replacer.Victim(&victim)) {
+      victims.push_back(victim);
+    }
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Scenario: once every frame is unpinned again, the size agrees with what the clock holds, and draining it hands out
+  // every frame exactly once.
+  for (frame_id_t frame_id = 0; frame_id < num_frames; ++frame_id) {
+    clock_replacer.Unpin(frame_id);
+  }
+  EXPECT_EQ(num_frames, clock_replacer.Size());
+  std::vector<bool> drained(num_frames, false);
+  size_t remaining = 0;
+  frame_id_t frame_id;
+  while (clock_replacer.Victim(&frame_id)) {
+    EXPECT_FALSE(drained[frame_id]);
+    drained[frame_id] = true;
+    ++remaining;
+  }
+  EXPECT_EQ(0, clock_replacer.Size());
+  EXPECT_EQ(num_frames, remaining);
+}
+
 }  // namespace bustub
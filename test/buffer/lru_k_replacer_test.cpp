@@ -0,0 +1,169 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer_test.cpp
+//
+// Identification: test/buffer/lru_k_replacer_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/lru_k_replacer.h"
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+TEST(LRUKReplacerTest, SampleTest) {
+  LRUKReplacer lru_k_replacer(7, 2, 0);
+
+  // Scenario: frames 1-5 are accessed once, frame 6 twice.
+  for (frame_id_t frame_id = 1; frame_id <= 6; ++frame_id) {
+    lru_k_replacer.RecordAccess(frame_id, frame_id);
+  }
+  lru_k_replacer.RecordAccess(6, 6);
+  for (frame_id_t frame_id = 1; frame_id <= 6; ++frame_id) {
+    lru_k_replacer.Unpin(frame_id);
+  }
+  EXPECT_EQ(6, lru_k_replacer.Size());
+
+  // Scenario: frame 1 is accessed again and joins frame 6 with a finite backward K-distance.
+  lru_k_replacer.RecordAccess(1, 1);
+
+  // Scenario: frames with fewer than K accesses go first, in the order of their access.
+  int value;
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(3, value);
+  EXPECT_EQ(4, lru_k_replacer.Size());
+
+  // Scenario: pinned frames are not victimized, and pinning a victimized frame has no effect.
+  lru_k_replacer.Pin(3);
+  lru_k_replacer.Pin(4);
+  EXPECT_EQ(3, lru_k_replacer.Size());
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(5, value);
+
+  // Scenario: once frame 4 is gone, frame 1 has the largest backward K-distance (its K-th access is the oldest).
+  lru_k_replacer.Unpin(4);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(4, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(6, value);
+  EXPECT_FALSE(lru_k_replacer.Victim(&value));
+
+  // Scenario: a removed frame forgets its history.
+  lru_k_replacer.RecordAccess(2, 2);
+  lru_k_replacer.RecordAccess(2, 2);
+  lru_k_replacer.Remove(2);
+  lru_k_replacer.RecordAccess(2, 2);
+  lru_k_replacer.Unpin(2);
+  lru_k_replacer.RecordAccess(3, 3);
+  lru_k_replacer.RecordAccess(3, 3);
+  lru_k_replacer.Unpin(3);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+}
+
+TEST(LRUKReplacerTest, CorrelatedReferenceTest) {
+  LRUKReplacer lru_k_replacer(3, 2, 2);
+
+  // Scenario: frame 0 is fetched twice back to back, frame 1 twice with other accesses in between.
+  lru_k_replacer.RecordAccess(0, 0);
+  lru_k_replacer.RecordAccess(0, 0);
+  lru_k_replacer.RecordAccess(1, 1);
+  lru_k_replacer.RecordAccess(2, 2);
+  lru_k_replacer.RecordAccess(2, 2);
+  lru_k_replacer.RecordAccess(1, 1);
+  for (frame_id_t frame_id = 0; frame_id < 3; ++frame_id) {
+    lru_k_replacer.Unpin(frame_id);
+  }
+
+  // Scenario: the repeated accesses to frames 0 and 2 are correlated, so only frame 1 has K references.
+  int value;
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(0, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+}
+
+/**
+ * Run point lookups on a few hot pages interleaved with sequential scans over many cold pages, and report whether
+ * every hot page stayed resident. Each hot page carries an in-memory marker that is never written back, so the marker
+ * is lost as soon as the page is evicted.
+ */
+auto HotPagesSurviveScans(ReplacerType replacer_type) -> bool {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 8;
+  const int hot_pages = 4;
+  const int scan_pages = 64;
+  const int scan_batch = 3;
+  const char marker = 'h';
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager, nullptr, replacer_type);
+
+  std::vector<page_id_t> page_ids;
+  for (int i = 0; i < hot_pages + scan_pages; ++i) {
+    page_id_t page_id;
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+    page_ids.push_back(page_id);
+  }
+
+  // Warm up: the hot pages are looked up repeatedly before the scans start.
+  for (int round = 0; round < 3; ++round) {
+    for (int i = 0; i < hot_pages; ++i) {
+      Page *page = bpm->FetchPage(page_ids[i]);
+      EXPECT_NE(nullptr, page);
+      page->GetData()[0] = marker;
+      EXPECT_TRUE(bpm->UnpinPage(page_ids[i], false));
+    }
+  }
+
+  // Every scan step reads a batch of cold pages, fetching each twice like a table iterator does, then looks up one
+  // hot page.
+  bool resident = true;
+  int step = 0;
+  for (int pass = 0; pass < 2; ++pass) {
+    for (int i = 0; i < scan_pages; i += scan_batch, ++step) {
+      for (int j = i; j < std::min(i + scan_batch, scan_pages); ++j) {
+        page_id_t page_id = page_ids[hot_pages + j];
+        for (int repeat = 0; repeat < 2; ++repeat) {
+          EXPECT_NE(nullptr, bpm->FetchPage(page_id));
+          EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+        }
+      }
+      page_id_t hot_page_id = page_ids[step % hot_pages];
+      Page *page = bpm->FetchPage(hot_page_id);
+      EXPECT_NE(nullptr, page);
+      resident = resident && page->GetData()[0] == marker;
+      EXPECT_TRUE(bpm->UnpinPage(hot_page_id, false));
+    }
+  }
+  EXPECT_EQ(0, bpm->Count());
+
+  delete bpm;
+  delete disk_manager;
+  remove("test.db");
+  remove("test.log");
+  return resident;
+}
+
+TEST(LRUKReplacerTest, ScanResistanceTest) {
+  EXPECT_FALSE(HotPagesSurviveScans(ReplacerType::LRU));
+  EXPECT_TRUE(HotPagesSurviveScans(ReplacerType::LRU_K));
+}
+
+}  // namespace bustub
@@ -11,17 +11,21 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/parallel_buffer_pool_manager.h"
+#include <algorithm>
 #include <cstdio>
 #include <random>
 #include <string>
+#include <thread>  // NOLINT
+#include <vector>
 #include "buffer/buffer_pool_manager.h"
+#include "common/util/numa_util.h"
 #include "gtest/gtest.h"
 
 namespace bustub {
 
 // NOLINTNEXTLINE
 // Check whether pages containing terminal characters can be recovered
-TEST(ParallelBufferPoolManagerTest, DISABLED_BinaryDataTest) {
+TEST(ParallelBufferPoolManagerTest, BinaryDataTest) {
   const std::string db_name = "test.db";
   const size_t buffer_pool_size = 10;
   const size_t num_instances = 5;
@@ -88,7 +92,7 @@ TEST(ParallelBufferPoolManagerTest, DISABLED_BinaryDataTest) {
 }
 
 // NOLINTNEXTLINE
-TEST(ParallelBufferPoolManagerTest, DISABLED_SampleTest) {
+TEST(ParallelBufferPoolManagerTest, SampleTest) {
   const std::string db_name = "test.db";
   const size_t buffer_pool_size = 10;
   const size_t num_instances = 5;
@@ -151,4 +155,159 @@ TEST(ParallelBufferPoolManagerTest, DISABLED_SampleTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, ConcurrentRoutingTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 8;
+  const size_t num_instances = 4;
+  const int num_threads = 8;
+  const int pages_per_thread = 50;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager);
+
+  // Every thread creates its own pages, writes its id into them and reads them back, while the other threads do the
+  // same on all instances.
+  std::vector<std::vector<page_id_t>> page_ids(num_threads);
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([bpm, tid, &page_ids] {
+      for (int i = 0; i < pages_per_thread; ++i) {
+        page_id_t page_id;
+        Page *page = nullptr;
+        while (page == nullptr) {
+          page = bpm->NewPage(&page_id);
+        }
+        snprintf(page->GetData(), PAGE_SIZE, "%d:%d", tid, page_id);
+        page_ids[tid].push_back(page_id);
+        EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+      }
+      for (page_id_t page_id : page_ids[tid]) {
+        Page *page = nullptr;
+        while (page == nullptr) {
+          page = bpm->FetchPage(page_id);
+        }
+        EXPECT_EQ(std::to_string(tid) + ":" + std::to_string(page_id), std::string(page->GetData()));
+        EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Scenario: page ids are unique across instances, and the pages are spread over all of them.
+  std::vector<page_id_t> all_page_ids;
+  std::vector<int> per_instance(num_instances);
+  for (const auto &ids : page_ids) {
+    for (page_id_t page_id : ids) {
+      all_page_ids.push_back(page_id);
+      ++per_instance[page_id % num_instances];
+    }
+  }
+  std::sort(all_page_ids.begin(), all_page_ids.end());
+  EXPECT_EQ(all_page_ids.end(), std::adjacent_find(all_page_ids.begin(), all_page_ids.end()));
+  for (int count : per_instance) {
+    EXPECT_GT(count, 0);
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, NumaBindingTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+  const size_t num_instances = 4;
+
+  auto *disk_manager = new DiskManager(db_name);
+  enable_numa_binding = true;
+  auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager);
+  enable_numa_binding = false;
+
+  // Scenario: new pages still fill up every instance, starting with the ones on the node of this thread.
+  std::vector<page_id_t> page_ids;
+  page_id_t page_id;
+  for (size_t i = 0; i < num_instances * buffer_pool_size; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    page_ids.push_back(page_id);
+  }
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id));
+  for (page_id_t id : page_ids) {
+    EXPECT_TRUE(bpm->UnpinPage(id, true));
+  }
+
+  // Scenario: fetches are counted on the node of the instance that serves them.
+  for (page_id_t id : page_ids) {
+    ASSERT_NE(nullptr, bpm->FetchPage(id));
+    EXPECT_TRUE(bpm->UnpinPage(id, false));
+  }
+  BufferPoolStats total;
+  for (int node = 0; node < NumaUtil::NumNodes(); ++node) {
+    BufferPoolStats stats = bpm->GetNodeStats(node);
+    total.hits_ += stats.hits_;
+    total.misses_ += stats.misses_;
+    total.remote_accesses_ += stats.remote_accesses_;
+  }
+  EXPECT_EQ(page_ids.size(), total.hits_);
+  EXPECT_EQ(0, total.misses_);
+  if (NumaUtil::NumNodes() == 1) {
+    EXPECT_EQ(0, total.remote_accesses_);
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, ResizeTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 2;
+  const size_t num_instances = 4;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new ParallelBufferPoolManager(num_instances, buffer_pool_size, disk_manager);
+  EXPECT_EQ(num_instances * buffer_pool_size, bpm->GetPoolSize());
+
+  // Scenario: the new size is split evenly over the instances, so it has to be a multiple of their number.
+  EXPECT_FALSE(bpm->ResizePool(num_instances * buffer_pool_size + 1));
+  EXPECT_TRUE(bpm->ResizePool(2 * num_instances * buffer_pool_size));
+  EXPECT_EQ(2 * num_instances * buffer_pool_size, bpm->GetPoolSize());
+  std::vector<page_id_t> page_ids;
+  page_id_t page_id;
+  for (size_t i = 0; i < 2 * num_instances * buffer_pool_size; ++i) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    page_ids.push_back(page_id);
+  }
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id));
+
+  // Scenario: shrinking back writes the pages of the retired frames out once they are unpinned.
+  for (auto id : page_ids) {
+    EXPECT_TRUE(bpm->UnpinPage(id, true));
+  }
+  EXPECT_TRUE(bpm->ResizePool(num_instances * buffer_pool_size));
+  EXPECT_EQ(num_instances * buffer_pool_size, bpm->GetPoolSize());
+  for (auto id : page_ids) {
+    Page *page = bpm->FetchPage(id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(id), std::string(page->GetData()));
+    EXPECT_TRUE(bpm->UnpinPage(id, false));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
 }  // namespace bustub
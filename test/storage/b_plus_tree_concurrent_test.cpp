@@ -10,10 +10,12 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <atomic>
 #include <chrono>  // NOLINT
 #include <cstdio>
 #include <functional>
 #include <thread>  // NOLINT
+#include <vector>
 
 #include "buffer/buffer_pool_manager_instance.h"
 #include "gtest/gtest.h"
@@ -333,4 +335,98 @@ TEST(BPlusTreeConcurrentTest, DISABLED_MixTest) {
   remove("test.log");
 }
 
+TEST(BPlusTreeConcurrentTest, ReadWhileSplittingAndMergingTest) {
+  // Scenario: lookups and scans run while other threads insert and remove keys around them, splitting and merging
+  // pages over and over; the keys that are never removed are always found.
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 4);
+
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+  // Even keys stay in the tree; odd keys come and go.
+  const int64_t scale_factor = 1000;
+  const int num_writers = 2;
+  const int rounds = 20;
+  std::vector<int64_t> stable_keys;
+  std::vector<int64_t> churn_keys;
+  for (int64_t key = 1; key <= scale_factor; key++) {
+    (key % 2 == 0 ? stable_keys : churn_keys).push_back(key);
+  }
+  InsertHelper(&tree, stable_keys);
+
+  std::atomic<bool> writing{true};
+  std::atomic<int> missed{0};
+  std::atomic<int> misordered{0};
+  std::vector<std::thread> writers;
+  for (int writer = 0; writer < num_writers; writer++) {
+    writers.emplace_back([&, writer] {
+      for (int round = 0; round < rounds; round++) {
+        InsertHelperSplit(&tree, churn_keys, num_writers, writer);
+        DeleteHelperSplit(&tree, churn_keys, num_writers, writer);
+      }
+    });
+  }
+  std::thread reader([&] {
+    GenericKey<8> index_key;
+    std::vector<RID> rids;
+    do {
+      for (auto key : stable_keys) {
+        rids.clear();
+        index_key.SetFromInteger(key);
+        if (!tree.GetValue(index_key, &rids) || rids.size() != 1 || rids[0].GetSlotNum() != key) {
+          missed++;
+        }
+      }
+    } while (writing);
+  });
+  std::thread scanner([&] {
+    do {
+      size_t next = 0;
+      int64_t last_key = 0;
+      for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+        int64_t key = (*iterator).second.GetSlotNum();
+        if (key <= last_key) {
+          misordered++;
+        }
+        last_key = key;
+        if (next < stable_keys.size() && key == stable_keys[next]) {
+          next++;
+        }
+      }
+      if (next != stable_keys.size()) {
+        missed++;
+      }
+    } while (writing);
+  });
+  for (auto &writer : writers) {
+    writer.join();
+  }
+  writing = false;
+  reader.join();
+  scanner.join();
+
+  EXPECT_EQ(0, missed);
+  EXPECT_EQ(0, misordered);
+  int64_t size = 0;
+  int64_t current_key = 2;
+  for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+    EXPECT_EQ(current_key, (*iterator).second.GetSlotNum());
+    current_key += 2;
+    size++;
+  }
+  EXPECT_EQ(stable_keys.size(), size);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.fsm");
+  remove("test.log");
+}
+
 }  // namespace bustub
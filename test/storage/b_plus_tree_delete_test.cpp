@@ -177,6 +177,54 @@ TEST(BPlusTreeTests, DeleteTest1) {
   remove("test.log");
 }
 
+TEST(BPlusTreeTests, FreedPagesTest) {
+  // Scenario: the pages emptied by removals are handed back to the buffer pool, which gives them out again.
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 4);
+  GenericKey<8> index_key;
+  RID rid;
+  auto *transaction = new Transaction(0);
+
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  for (int64_t key = 1; key <= 200; key++) {
+    rid.Set(static_cast<int32_t>(key >> 32), key & 0xFFFFFFFF);
+    index_key.SetFromInteger(key);
+    tree.Insert(index_key, rid, transaction);
+  }
+  page_id_t next_page_id;
+  ASSERT_NE(nullptr, bpm->NewPage(&next_page_id));
+  ASSERT_TRUE(bpm->UnpinPage(next_page_id, false));
+
+  for (int64_t key = 1; key < 200; key++) {
+    index_key.SetFromInteger(key);
+    tree.Remove(index_key, transaction);
+  }
+  std::vector<RID> rids;
+  index_key.SetFromInteger(200);
+  EXPECT_TRUE(tree.GetValue(index_key, &rids));
+
+  // Every page of the tree but its last leaf was freed, and the lowest free page is given out first.
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_LT(page_id, next_page_id);
+  EXPECT_NE(HEADER_PAGE_ID, page_id);
+  bpm->UnpinPage(page_id, false);
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.fsm");
+  remove("test.log");
+}
+
 TEST(BPlusTreeTests, DISABLED_DeleteTest2) {
   // create KeyComparator and index schema
   auto key_schema = ParseCreateStatement("a bigint");
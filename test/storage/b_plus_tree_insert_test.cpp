@@ -13,6 +13,7 @@
 #include <algorithm>
 #include <cstdio>
 #include <random>
+#include <string>
 
 #include "buffer/buffer_pool_manager_instance.h"
 #include "gtest/gtest.h"
@@ -298,4 +299,94 @@ TEST(BPlusTreeTests, InsertTest22) {
   remove("test.db");
   remove("test.log");
 }
+TEST(BPlusTreeTests, BulkLoadTest) {
+  // create KeyComparator and index schema
+  auto key_schema = ParseCreateStatement("a bigint");
+  GenericComparator<8> comparator(key_schema.get());
+
+  auto *disk_manager = new DiskManager("test.db");
+  BufferPoolManager *bpm = new BufferPoolManagerInstance(100, disk_manager);
+  GenericKey<8> index_key;
+  RID rid;
+  // create transaction
+  auto *transaction = new Transaction(0);
+
+  // create and fetch header_page
+  page_id_t page_id;
+  auto header_page = bpm->NewPage(&page_id);
+  (void)header_page;
+
+  // Scenario: sorted keys, one of them twice, are loaded into trees of one leaf, of two levels, and of many levels.
+  for (int64_t scale : {1, 5, 1000}) {
+    BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk_" + std::to_string(scale), bpm, comparator, 3, 4);
+    int64_t next_key = 1;
+    bool repeated = false;
+    auto next = [&](GenericKey<8> *key, RID *value) {
+      if (next_key > scale) {
+        return false;
+      }
+      key->SetFromInteger(next_key);
+      value->Set(static_cast<int32_t>(next_key >> 32), next_key & 0xFFFFFFFF);
+      if (next_key == scale / 2 + 1 && !repeated) {
+        repeated = true;
+      } else {
+        next_key++;
+      }
+      return true;
+    };
+    ASSERT_TRUE(tree.BulkLoad(next, scale == 1000 ? 0.5 : 1.0, transaction));
+
+    std::vector<RID> rids;
+    for (int64_t key = 1; key <= scale; key++) {
+      rids.clear();
+      index_key.SetFromInteger(key);
+      tree.GetValue(index_key, &rids);
+      ASSERT_EQ(rids.size(), 1);
+      EXPECT_EQ(rids[0].GetSlotNum(), key);
+    }
+    int64_t current_key = 1;
+    for (auto iterator = tree.Begin(); iterator != tree.End(); ++iterator) {
+      EXPECT_EQ((*iterator).second.GetSlotNum(), current_key);
+      current_key++;
+    }
+    EXPECT_EQ(current_key, scale + 1);
+
+    // Scenario: a tree that is not empty is not bulk loaded.
+    next_key = 1;
+    EXPECT_FALSE(tree.BulkLoad(next));
+
+    // Scenario: the bulk loaded tree splits and merges as usual.
+    index_key.SetFromInteger(scale + 1);
+    rid.Set(0, scale + 1);
+    EXPECT_TRUE(tree.Insert(index_key, rid, transaction));
+    for (int64_t key = 1; key <= scale + 1; key++) {
+      index_key.SetFromInteger(key);
+      tree.Remove(index_key, transaction);
+    }
+    EXPECT_TRUE(tree.IsEmpty());
+  }
+
+  // Scenario: keys out of order leave the tree empty.
+  BPlusTree<GenericKey<8>, RID, GenericComparator<8>> tree("foo_pk", bpm, comparator, 3, 4);
+  std::vector<int64_t> keys = {1, 2, 3, 4, 5, 6, 7, 8, 9, 3};
+  size_t next_index = 0;
+  auto next = [&](GenericKey<8> *key, RID *value) {
+    if (next_index == keys.size()) {
+      return false;
+    }
+    key->SetFromInteger(keys[next_index]);
+    value->Set(0, keys[next_index]);
+    next_index++;
+    return true;
+  };
+  EXPECT_FALSE(tree.BulkLoad(next));
+  EXPECT_TRUE(tree.IsEmpty());
+
+  bpm->UnpinPage(HEADER_PAGE_ID, true);
+  delete transaction;
+  delete disk_manager;
+  delete bpm;
+  remove("test.db");
+  remove("test.log");
+}
 }  // namespace bustub
@@ -0,0 +1,55 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// b_plus_tree_key_search_test.cpp
+//
+// Identification: test/storage/b_plus_tree_key_search_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/page/b_plus_tree_key_search.h"
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+template <size_t KeySize>
+void CheckKeySearch() {
+  GenericComparator<KeySize> comparator(nullptr);
+  auto make_key = [](int64_t value) {
+    GenericKey<KeySize> key;
+    key.SetFromInteger(value);
+    return key;
+  };
+  // Even values around 0, so that odd values fall in between keys; sizes cover the binary search and every tail.
+  std::vector<GenericKey<KeySize>> keys;
+  for (int64_t value = -150; value < 150; value += 2) {
+    keys.push_back(make_key(value * 1000003));
+  }
+  for (int size = 0; size <= static_cast<int>(keys.size()); size += 7) {
+    for (int64_t value = -153; value <= 153; value++) {
+      auto key = make_key(value * 1000003);
+      int less = 0;
+      int not_greater = 0;
+      for (int i = 0; i < size; i++) {
+        less += static_cast<int>(comparator(keys[i], key) < 0);
+        not_greater += static_cast<int>(comparator(keys[i], key) <= 0);
+      }
+      ASSERT_EQ(less, BPlusTreeKeySearch<KeySize>::CountBelow(keys.data(), size, key, false)) << size << " " << value;
+      ASSERT_EQ(not_greater, BPlusTreeKeySearch<KeySize>::CountBelow(keys.data(), size, key, true))
+          << size << " " << value;
+    }
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(BPlusTreeKeySearchTest, SampleTest) {
+  // Scenario: searching integer keys agrees with the comparator, on both sides of 0 and of every key.
+  CheckKeySearch<4>();
+  CheckKeySearch<8>();
+}
+
+}  // namespace bustub
@@ -11,6 +11,10 @@
 //===----------------------------------------------------------------------===//
 
 #include <cstring>
+#include <fstream>
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "common/exception.h"
 #include "gtest/gtest.h"
@@ -24,12 +28,14 @@ class DiskManagerTest : public ::testing::Test {
   void SetUp() override {
     remove("test.db");
     remove("test.log");
+    remove("test.fsm");
   }
 
   // This function is called after every test.
   void TearDown() override {
     remove("test.db");
     remove("test.log");
+    remove("test.fsm");
   };
 };
 
@@ -72,6 +78,317 @@ TEST_F(DiskManagerTest, ReadWriteLogTest) {
   dm.ShutDown();
 }
 
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, ConcurrentReadWritePageTest) {
+  const int num_threads = 8;
+  const int pages_per_thread = 64;
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+
+  // Every thread writes and reads back its own pages, interleaved with the other threads.
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&dm, tid] {
+      char buf[PAGE_SIZE];
+      char data[PAGE_SIZE];
+      for (int i = 0; i < pages_per_thread; ++i) {
+        page_id_t page_id = i * num_threads + tid;
+        std::memset(data, page_id, sizeof(data));
+        dm.WritePage(page_id, data);
+        dm.ReadPage(page_id, buf);
+        EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  char buf[PAGE_SIZE];
+  for (page_id_t page_id = 0; page_id < num_threads * pages_per_thread; ++page_id) {
+    dm.ReadPage(page_id, buf);
+    EXPECT_EQ(static_cast<char>(page_id), buf[0]);
+    EXPECT_EQ(static_cast<char>(page_id), buf[PAGE_SIZE - 1]);
+  }
+  EXPECT_EQ(2 * num_threads * pages_per_thread, dm.GetNumReads());
+  EXPECT_EQ(num_threads * pages_per_thread, dm.GetNumWrites());
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, LargeOffsetTest) {
+  char buf[PAGE_SIZE] = {0};
+  char data[PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+  std::strncpy(data, "A test string.", sizeof(data));
+
+  // Scenario: a page past the 2 GB mark (the file stays sparse).
+  const page_id_t page_id = 600000;
+  dm.WritePage(page_id, data);
+  dm.ReadPage(page_id, buf);
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, SegmentedFileTest) {
+  const size_t segment_size = 4 * PAGE_SIZE;
+  char buf[PAGE_SIZE] = {0};
+  char data[PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  auto file_exists = [](const std::string &file_name) { return std::ifstream(file_name).good(); };
+
+  {
+    auto dm = DiskManager(db_file, segment_size, true);
+    for (page_id_t page_id : {0, 5, 13}) {
+      std::memset(data, page_id, sizeof(data));
+      dm.WritePage(page_id, data);
+    }
+    // Scenario: segments are created on demand, including the ones in between.
+    EXPECT_TRUE(file_exists("test.db.1"));
+    EXPECT_TRUE(file_exists("test.db.2"));
+    EXPECT_TRUE(file_exists("test.db.3"));
+    EXPECT_FALSE(file_exists("test.db.4"));
+    dm.ShutDown();
+  }
+
+  // Scenario: the pages are found again when the database is reopened.
+  auto dm = DiskManager(db_file, segment_size, true);
+  for (page_id_t page_id : {0, 5, 13}) {
+    std::memset(data, page_id, sizeof(data));
+    dm.ReadPage(page_id, buf);
+    EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  }
+  // Scenario: pages that were never written read as zeroes.
+  std::memset(data, 0, sizeof(data));
+  dm.ReadPage(9, buf);
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  dm.ShutDown();
+
+  for (int segment = 1; segment <= 3; ++segment) {
+    remove(("test.db." + std::to_string(segment)).c_str());
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, BatchRequestTest) {
+  const int num_pages = 300;
+  std::string db_file("test.db");
+  // Scenario: the same batches through io_uring (where the kernel has it) and through the synchronous fallback.
+  for (bool use_io_uring : {true, false}) {
+    enable_io_uring = use_io_uring;
+    auto dm = DiskManager(db_file);
+    enable_io_uring = true;
+    if (!use_io_uring) {
+      EXPECT_FALSE(dm.IsAsync());
+    }
+
+    std::vector<std::vector<char>> data(num_pages, std::vector<char>(PAGE_SIZE));
+    std::vector<DiskRequest> writes;
+    for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+      std::memset(data[page_id].data(), page_id + use_io_uring, PAGE_SIZE);
+      writes.push_back({true, page_id, data[page_id].data()});
+    }
+    dm.SubmitRequests(&writes);
+    dm.WaitForRequests(&writes);
+
+    // The batch is larger than the submission queue, and reads past the end come back as zeroes.
+    std::vector<std::vector<char>> bufs(num_pages + 1, std::vector<char>(PAGE_SIZE, 1));
+    std::vector<DiskRequest> reads;
+    for (page_id_t page_id = num_pages; page_id >= 0; --page_id) {
+      reads.push_back({false, page_id, bufs[page_id].data()});
+    }
+    dm.SubmitRequests(&reads);
+    dm.WaitForRequests(&reads);
+    for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+      EXPECT_EQ(0, std::memcmp(bufs[page_id].data(), data[page_id].data(), PAGE_SIZE));
+    }
+    EXPECT_EQ(0, bufs[num_pages][0]);
+    EXPECT_EQ(num_pages, dm.GetNumWrites());
+    EXPECT_EQ(num_pages + 1, dm.GetNumReads());
+
+    dm.ShutDown();
+    remove("test.db");
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, WritePagesTest) {
+  const size_t segment_size = 4 * PAGE_SIZE;
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file, segment_size);
+
+  // Scenario: an unsorted batch with gaps, and runs that cross segment boundaries.
+  std::vector<page_id_t> page_ids = {9, 1, 2, 3, 4, 5, 12, 0, 7};
+  std::vector<std::vector<char>> data(page_ids.size(), std::vector<char>(PAGE_SIZE));
+  std::vector<DiskRequest> writes;
+  for (size_t i = 0; i < page_ids.size(); ++i) {
+    std::memset(data[i].data(), page_ids[i] + 1, PAGE_SIZE);
+    writes.push_back({true, page_ids[i], data[i].data()});
+  }
+  dm.WritePages(&writes);
+  dm.SyncPages();
+  for (size_t i = 0; i < writes.size(); ++i) {
+    EXPECT_TRUE(writes[i].done_);
+    if (i > 0) {
+      EXPECT_LT(writes[i - 1].page_id_, writes[i].page_id_);
+    }
+  }
+  EXPECT_EQ(static_cast<int>(page_ids.size()), dm.GetNumWrites());
+
+  char buf[PAGE_SIZE];
+  for (size_t i = 0; i < page_ids.size(); ++i) {
+    dm.ReadPage(page_ids[i], buf);
+    EXPECT_EQ(0, std::memcmp(buf, data[i].data(), PAGE_SIZE));
+  }
+  // Scenario: the gaps between the runs read as zeroes.
+  char zeroes[PAGE_SIZE] = {0};
+  dm.ReadPage(6, buf);
+  EXPECT_EQ(0, std::memcmp(buf, zeroes, PAGE_SIZE));
+
+  dm.ShutDown();
+  for (int segment = 1; segment <= 3; ++segment) {
+    remove(("test.db." + std::to_string(segment)).c_str());
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, FreePageTest) {
+  const int num_pages = 10;
+  char data[PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+
+  {
+    auto dm = DiskManager(db_file);
+    for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+      dm.WritePage(page_id, data);
+    }
+    for (page_id_t page_id : {8, 3, 9, 7, 3, num_pages + 10}) {
+      dm.DeallocatePage(page_id);
+    }
+    // Scenario: pages past the end are ignored, and the lowest matching free page is reused first.
+    EXPECT_EQ(4, dm.GetNumFreePages());
+    EXPECT_EQ(3, dm.AllocateFreePage());
+    EXPECT_EQ(7, dm.AllocateFreePage(2, 1));
+    EXPECT_EQ(INVALID_PAGE_ID, dm.AllocateFreePage(3, 1));
+    dm.ShutDown();
+  }
+
+  // Scenario: the free pages survive a restart, and compaction truncates the free pages at the end.
+  auto dm = DiskManager(db_file);
+  EXPECT_EQ(2, dm.GetNumFreePages());
+  EXPECT_EQ(num_pages, dm.GetNumPages());
+  EXPECT_EQ(2, dm.Compact());
+  EXPECT_EQ(0, dm.Compact());
+  EXPECT_EQ(num_pages - 2, dm.GetNumPages());
+  std::ifstream db(db_file, std::ios::binary | std::ios::ate);
+  EXPECT_EQ((num_pages - 2) * PAGE_SIZE, db.tellg());
+
+  // Scenario: truncated pages stay free, and reusing them grows the database again.
+  EXPECT_EQ(8, dm.AllocateFreePage());
+  dm.WritePage(8, data);
+  EXPECT_EQ(num_pages - 1, dm.GetNumPages());
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, SegmentedCompactTest) {
+  const size_t segment_size = 4 * PAGE_SIZE;
+  const int num_pages = 10;
+  char data[PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  auto file_exists = [](const std::string &file_name) { return std::ifstream(file_name).good(); };
+
+  auto dm = DiskManager(db_file, segment_size);
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    dm.WritePage(page_id, data);
+  }
+  for (page_id_t page_id = 3; page_id < num_pages; ++page_id) {
+    dm.DeallocatePage(page_id);
+  }
+  // Scenario: segments past the new end are removed, and the last one is truncated.
+  EXPECT_EQ(num_pages - 3, dm.Compact());
+  EXPECT_TRUE(file_exists("test.db"));
+  EXPECT_FALSE(file_exists("test.db.1"));
+  EXPECT_FALSE(file_exists("test.db.2"));
+  std::ifstream db(db_file, std::ios::binary | std::ios::ate);
+  EXPECT_EQ(3 * PAGE_SIZE, db.tellg());
+
+  // Scenario: the segments are created again when the pages are reused.
+  for (page_id_t page_id = 3; page_id < num_pages; ++page_id) {
+    EXPECT_EQ(page_id, dm.AllocateFreePage());
+    dm.WritePage(page_id, data);
+  }
+  EXPECT_TRUE(file_exists("test.db.2"));
+  dm.ShutDown();
+  remove("test.db.1");
+  remove("test.db.2");
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, ReservePageTest) {
+  char buf[PAGE_SIZE];
+  char data[PAGE_SIZE] = {0};
+  std::string db_file("test.db");
+  auto dm = DiskManager(db_file);
+
+  // Scenario: a reserved page counts as part of the database, but the file only grows once it is written.
+  dm.ReservePage(0);
+  dm.ReservePage(1);
+  EXPECT_EQ(2, dm.GetNumPages());
+  std::ifstream db(db_file, std::ios::binary | std::ios::ate);
+  EXPECT_EQ(0, db.tellg());
+  std::memset(buf, 1, sizeof(buf));
+  dm.ReadPage(1, buf);
+  EXPECT_EQ(0, std::memcmp(buf, data, PAGE_SIZE));
+
+  // Scenario: a reserved page can be freed before it is ever written.
+  dm.DeallocatePage(1);
+  EXPECT_EQ(1, dm.AllocateFreePage());
+
+  std::memset(data, 7, sizeof(data));
+  dm.WritePage(1, data);
+  dm.ReadPage(1, buf);
+  EXPECT_EQ(0, std::memcmp(buf, data, PAGE_SIZE));
+  EXPECT_EQ(2, dm.GetNumPages());
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(DiskManagerTest, DirectIoTest) {
+  const int num_pages = 4;
+  std::string db_file("test.db");
+  enable_direct_io = true;
+  auto dm = DiskManager(db_file);
+  enable_direct_io = false;
+
+  // Scenario: buffers that are not page-aligned still work, through a bounce buffer when the file system supports
+  // direct I/O.
+  std::vector<char> data(num_pages * PAGE_SIZE + 1);
+  std::vector<char> buf(num_pages * PAGE_SIZE + 1);
+  std::vector<DiskRequest> writes;
+  std::vector<DiskRequest> reads;
+  for (page_id_t page_id = 0; page_id < num_pages; ++page_id) {
+    char *page_data = data.data() + 1 + page_id * PAGE_SIZE;
+    std::memset(page_data, page_id + 1, PAGE_SIZE);
+    writes.push_back({true, page_id, page_data});
+    reads.push_back({false, page_id, buf.data() + 1 + page_id * PAGE_SIZE});
+  }
+  dm.WritePage(0, writes[0].data_);
+  dm.ReadPage(0, reads[0].data_);
+  EXPECT_EQ(0, std::memcmp(reads[0].data_, writes[0].data_, PAGE_SIZE));
+  dm.SubmitRequests(&writes);
+  dm.WaitForRequests(&writes);
+  dm.SubmitRequests(&reads);
+  dm.WaitForRequests(&reads);
+  EXPECT_EQ(0, std::memcmp(buf.data(), data.data(), buf.size()));
+
+  dm.ShutDown();
+}
+
 // NOLINTNEXTLINE
 TEST_F(DiskManagerTest, ThrowBadFileTest) { EXPECT_THROW(DiskManager("dev/null\\/foo/bar/baz/test.db"), Exception); }
 
@@ -0,0 +1,68 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// epoch_manager_test.cpp
+//
+// Identification: test/storage/epoch_manager_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/index/epoch_manager.h"
+#include <vector>
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(EpochManagerTest, SampleTest) {
+  std::vector<page_id_t> released;
+  bool can_release = true;
+  {
+    EpochManager epochs([&released, &can_release](page_id_t page_id) {
+      if (!can_release) {
+        return false;
+      }
+      released.push_back(page_id);
+      return true;
+    });
+
+    // Scenario: a page is not released while an operation that may hold it is running.
+    {
+      EpochManager::Guard outer(&epochs);
+      {
+        EpochManager::Guard inner(&epochs);
+        epochs.Retire(1);
+      }
+      EXPECT_TRUE(released.empty());
+    }
+    EXPECT_EQ(std::vector<page_id_t>{1}, released);
+
+    // Scenario: a page that cannot be released yet is kept, and tried again once the operations move on.
+    can_release = false;
+    {
+      EpochManager::Guard guard(&epochs);
+      epochs.Retire(2);
+    }
+    can_release = true;
+    {
+      EpochManager::Guard guard(&epochs);
+      epochs.Retire(3);
+    }
+    EXPECT_EQ((std::vector<page_id_t>{1, 2, 3}), released);
+
+    // Scenario: the pages still waiting are released when the manager is destroyed.
+    can_release = false;
+    {
+      EpochManager::Guard guard(&epochs);
+      epochs.Retire(4);
+    }
+    can_release = true;
+    EXPECT_EQ(3U, released.size());
+  }
+  EXPECT_EQ((std::vector<page_id_t>{1, 2, 3, 4}), released);
+}
+
+}  // namespace bustub
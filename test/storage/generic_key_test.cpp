@@ -0,0 +1,90 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// generic_key_test.cpp
+//
+// Identification: test/storage/generic_key_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/index/generic_key.h"
+#include <string>
+#include <vector>
+#include "gtest/gtest.h"
+#include "type/value_factory.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(GenericKeyTest, SampleTest) {
+  Schema key_schema({Column("a", TypeId::INTEGER), Column("b", TypeId::VARCHAR, 16), Column("c", TypeId::DECIMAL)});
+  GenericComparator<32> comparator(&key_schema);
+  auto make_key = [&](const Value &a, const Value &b, const Value &c) {
+    GenericKey<32> key;
+    key.SetFromKey(Tuple({a, b, c}, &key_schema), key_schema);
+    return key;
+  };
+  auto null_integer = ValueFactory::GetNullValueByType(TypeId::INTEGER);
+
+  // Scenario: encoded keys sort by their first column, then by the next ones, with NULLs first.
+  std::vector<GenericKey<32>> sorted_keys = {
+      make_key(null_integer, ValueFactory::GetVarcharValue("a"), ValueFactory::GetDecimalValue(0)),
+      make_key(ValueFactory::GetIntegerValue(-300), ValueFactory::GetVarcharValue("a"),
+               ValueFactory::GetDecimalValue(0)),
+      make_key(ValueFactory::GetIntegerValue(-1), ValueFactory::GetVarcharValue("a"), ValueFactory::GetDecimalValue(0)),
+      make_key(ValueFactory::GetIntegerValue(0), ValueFactory::GetVarcharValue(""), ValueFactory::GetDecimalValue(0)),
+      make_key(ValueFactory::GetIntegerValue(0), ValueFactory::GetVarcharValue("a"),
+               ValueFactory::GetDecimalValue(-2.5)),
+      make_key(ValueFactory::GetIntegerValue(0), ValueFactory::GetVarcharValue("a"),
+               ValueFactory::GetDecimalValue(0.5)),
+      make_key(ValueFactory::GetIntegerValue(0), ValueFactory::GetVarcharValue("ab"),
+               ValueFactory::GetDecimalValue(-7)),
+      make_key(ValueFactory::GetIntegerValue(256), ValueFactory::GetVarcharValue(""),
+               ValueFactory::GetDecimalValue(0)),
+  };
+  for (size_t i = 0; i + 1 < sorted_keys.size(); i++) {
+    EXPECT_LT(comparator(sorted_keys[i], sorted_keys[i + 1]), 0) << i;
+    EXPECT_GT(comparator(sorted_keys[i + 1], sorted_keys[i]), 0) << i;
+    EXPECT_EQ(comparator(sorted_keys[i], sorted_keys[i]), 0) << i;
+  }
+
+  // Scenario: equal values encode the same way, including -0.0 and 0.0.
+  EXPECT_EQ(comparator(make_key(ValueFactory::GetIntegerValue(7), ValueFactory::GetVarcharValue("x"),
+                                ValueFactory::GetDecimalValue(-0.0)),
+                       make_key(ValueFactory::GetIntegerValue(7), ValueFactory::GetVarcharValue("x"),
+                                ValueFactory::GetDecimalValue(0.0))),
+            0);
+
+  // Scenario: every column decodes back to its value.
+  GenericKey<32> key = make_key(ValueFactory::GetIntegerValue(-42), ValueFactory::GetVarcharValue("hello"),
+                                ValueFactory::GetDecimalValue(-3.25));
+  EXPECT_EQ(key.ToValue(&key_schema, 0).GetAs<int32_t>(), -42);
+  EXPECT_EQ(key.ToValue(&key_schema, 1).ToString(), "hello");
+  EXPECT_EQ(key.ToValue(&key_schema, 2).GetAs<double>(), -3.25);
+  key = make_key(null_integer, ValueFactory::GetVarcharValue(""), ValueFactory::GetDecimalValue(1));
+  EXPECT_TRUE(key.ToValue(&key_schema, 0).IsNull());
+  EXPECT_EQ(key.ToValue(&key_schema, 1).ToString(), "");
+  EXPECT_EQ(key.ToValue(&key_schema, 2).GetAs<double>(), 1);
+
+  // Scenario: test keys set from integers sort like the integers, and decode back to them.
+  GenericKey<8> big_keys[3];
+  GenericKey<4> small_keys[3];
+  int64_t integers[3] = {-5, 3, 70000};
+  GenericComparator<8> big_comparator(nullptr);
+  GenericComparator<4> small_comparator(nullptr);
+  for (int i = 0; i < 3; i++) {
+    big_keys[i].SetFromInteger(integers[i]);
+    small_keys[i].SetFromInteger(integers[i]);
+    EXPECT_EQ(big_keys[i].ToString(), integers[i]);
+    EXPECT_EQ(small_keys[i].ToString(), integers[i]);
+  }
+  for (int i = 0; i < 2; i++) {
+    EXPECT_LT(big_comparator(big_keys[i], big_keys[i + 1]), 0);
+    EXPECT_LT(small_comparator(small_keys[i], small_keys[i + 1]), 0);
+  }
+}
+
+}  // namespace bustub
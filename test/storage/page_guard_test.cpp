@@ -0,0 +1,119 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// page_guard_test.cpp
+//
+// Identification: test/storage/page_guard_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/page/page_guard.h"
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(PageGuardTest, SampleTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 5;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  page_id_t page_id_temp;
+  auto *page0 = bpm->NewPage(&page_id_temp);
+  ASSERT_NE(nullptr, page0);
+
+  // Scenario: a guard takes over the pin of a page, and gives it back when it is dropped.
+  {
+    BasicPageGuard guarded_page(bpm, page0);
+    EXPECT_EQ(page0->GetData(), guarded_page.GetData());
+    EXPECT_EQ(page0->GetPageId(), guarded_page.PageId());
+    EXPECT_EQ(1, page0->GetPinCount());
+
+    // Scenario: moving a guard moves the pin, it does not take a second one.
+    BasicPageGuard moved_page = std::move(guarded_page);
+    EXPECT_FALSE(guarded_page.IsValid());  // NOLINT
+    EXPECT_EQ(1, page0->GetPinCount());
+    moved_page.Drop();
+    EXPECT_EQ(0, page0->GetPinCount());
+    moved_page.Drop();
+    EXPECT_EQ(0, page0->GetPinCount());
+  }
+
+  // Scenario: writing through a write guard marks the page dirty, and the latch is released on destruction.
+  {
+    WritePageGuard write_guard = bpm->FetchPageWrite(page_id_temp);
+    ASSERT_TRUE(write_guard.IsValid());
+    EXPECT_EQ(1, page0->GetPinCount());
+    snprintf(write_guard.GetDataMut(), PAGE_SIZE, "Hello");
+  }
+  EXPECT_EQ(0, page0->GetPinCount());
+  EXPECT_TRUE(page0->IsDirty());
+
+  // Scenario: the version of a page is odd while it is write-latched, and a version read before does not validate.
+  {
+    uint64_t version = page0->GetVersion();
+    EXPECT_EQ(0, version % 2);
+    EXPECT_TRUE(page0->ValidateVersion(version));
+    WritePageGuard write_guard = bpm->FetchPageWrite(page_id_temp);
+    EXPECT_EQ(version + 1, page0->GetVersion());
+    write_guard.Drop();
+    EXPECT_EQ(version + 2, page0->GetVersion());
+    EXPECT_FALSE(page0->ValidateVersion(version));
+    ReadPageGuard read_guard = bpm->FetchPageRead(page_id_temp);
+    EXPECT_TRUE(page0->ValidateVersion(version + 2));
+  }
+
+  // Scenario: read guards share the latch, and each one holds its own pin.
+  {
+    ReadPageGuard read_guard_1 = bpm->FetchPageRead(page_id_temp);
+    ReadPageGuard read_guard_2 = bpm->FetchPageRead(page_id_temp);
+    EXPECT_EQ(2, page0->GetPinCount());
+    EXPECT_EQ(0, strcmp(read_guard_1.GetData(), "Hello"));
+    read_guard_2 = std::move(read_guard_1);
+    EXPECT_EQ(1, page0->GetPinCount());
+  }
+  EXPECT_EQ(0, page0->GetPinCount());
+
+  // Scenario: a basic guard can be upgraded without releasing its pin.
+  {
+    BasicPageGuard basic_guard = bpm->FetchPageBasic(page_id_temp);
+    WritePageGuard write_guard = basic_guard.UpgradeWrite();
+    EXPECT_FALSE(basic_guard.IsValid());  // NOLINT
+    EXPECT_EQ(1, page0->GetPinCount());
+  }
+  EXPECT_EQ(0, page0->GetPinCount());
+
+  // Scenario: once every frame is pinned by a guard, the buffer pool hands out invalid guards.
+  {
+    std::vector<BasicPageGuard> guards;
+    for (size_t i = 0; i < buffer_pool_size; ++i) {
+      page_id_t page_id;
+      guards.emplace_back(bpm->NewPageGuarded(&page_id));
+      EXPECT_TRUE(guards.back().IsValid());
+    }
+    page_id_t page_id;
+    EXPECT_FALSE(bpm->NewPageGuarded(&page_id).IsValid());
+    EXPECT_FALSE(bpm->FetchPageRead(page_id_temp).IsValid());
+  }
+  EXPECT_TRUE(bpm->FetchPageRead(page_id_temp).IsValid());
+
+  // Shutdown the disk manager and remove the temporary file we created.
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+}  // namespace bustub
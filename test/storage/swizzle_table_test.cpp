@@ -0,0 +1,101 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// swizzle_table_test.cpp
+//
+// Identification: test/storage/swizzle_table_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/index/swizzle_table.h"
+#include <cstdio>
+#include <string>
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(SwizzleTableTest, SampleTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 24;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  page_id_t page_ids[5];
+  for (auto &page_id : page_ids) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    bpm->UnpinPage(page_id, true);
+  }
+
+  SwizzleTable swizzle_table(bpm, 2, 4);
+
+  // Scenario: a swizzled page is pinned, and its link resolves to its frame for that page id only.
+  EXPECT_EQ(nullptr, swizzle_table.Resolve(*swizzle_table.RootLink(), page_ids[0]));
+  auto *root = swizzle_table.Swizzle(swizzle_table.RootLink(), page_ids[0]);
+  ASSERT_NE(nullptr, root);
+  EXPECT_EQ(page_ids[0], root->page_.load()->GetPageId());
+  EXPECT_EQ(1, root->page_.load()->GetPinCount());
+  EXPECT_EQ(root, swizzle_table.Resolve(*swizzle_table.RootLink(), page_ids[0]));
+  EXPECT_EQ(nullptr, swizzle_table.Resolve(*swizzle_table.RootLink(), page_ids[1]));
+
+  // Scenario: swizzling a page twice links it twice, but pins it once.
+  auto *child = swizzle_table.Swizzle(swizzle_table.ChildLink(root, 3), page_ids[1]);
+  ASSERT_NE(nullptr, child);
+  EXPECT_EQ(child, swizzle_table.Swizzle(swizzle_table.ChildLink(root, 0), page_ids[1]));
+  EXPECT_EQ(1, child->page_.load()->GetPinCount());
+  EXPECT_EQ(child, swizzle_table.Resolve(*swizzle_table.ChildLink(root, 3), page_ids[1]));
+
+  // Scenario: the table is full.
+  EXPECT_EQ(nullptr, swizzle_table.Swizzle(swizzle_table.ChildLink(root, 1), page_ids[2]));
+
+  // Scenario: an unswizzled page is unpinned, and the links to it no longer resolve.
+  Page *child_page = child->page_.load();
+  swizzle_table.Unswizzle(page_ids[1]);
+  EXPECT_EQ(0, child_page->GetPinCount());
+  EXPECT_EQ(nullptr, swizzle_table.Resolve(*swizzle_table.ChildLink(root, 3), page_ids[1]));
+  EXPECT_TRUE(bpm->DeletePage(page_ids[1]));
+
+  // Scenario: the node is reused, with none of the links of the page it was swizzled for.
+  auto *other = swizzle_table.Swizzle(swizzle_table.ChildLink(root, 1), page_ids[2]);
+  ASSERT_NE(nullptr, other);
+  EXPECT_EQ(nullptr, other->children_[0].load());
+  EXPECT_EQ(nullptr, swizzle_table.Resolve(*swizzle_table.ChildLink(root, 3), page_ids[1]));
+  EXPECT_EQ(other, swizzle_table.Resolve(*swizzle_table.ChildLink(root, 1), page_ids[2]));
+
+  // Scenario: the tables on a buffer pool share its budget of pinned pages, an eighth of the pool, and give their pins
+  // back when they are destroyed.
+  {
+    SwizzleTable other_table(bpm, 2, 4);
+    auto *other_root = other_table.Swizzle(other_table.RootLink(), page_ids[3]);
+    ASSERT_NE(nullptr, other_root);
+    EXPECT_TRUE(other_table.IsFull());
+    EXPECT_EQ(nullptr, other_table.Swizzle(other_table.ChildLink(other_root, 0), page_ids[4]));
+  }
+  EXPECT_TRUE(bpm->DeletePage(page_ids[3]));
+
+  // Scenario: shrinking the buffer pool reclaims the swizzled pages of the frames it retires, so it is not pinned down.
+  Page *root_page = root->page_.load();
+  Page *other_page = other->page_.load();
+  EXPECT_TRUE(bpm->ResizePool(2));
+  EXPECT_EQ(root_page < bpm->GetPages() + 2, swizzle_table.Resolve(*swizzle_table.RootLink(), page_ids[0]) != nullptr);
+  EXPECT_EQ(other_page < bpm->GetPages() + 2,
+            swizzle_table.Resolve(*swizzle_table.ChildLink(root, 1), page_ids[2]) != nullptr);
+  auto *page = bpm->FetchPage(page_ids[2]);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(page_ids[2], page->GetPageId());
+  bpm->UnpinPage(page_ids[2], false);
+
+  // Shutdown the disk manager and remove the temporary file we created.
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+}  // namespace bustub
@@ -21,6 +21,7 @@
 #include "logging/common.h"
 #include "storage/table/table_heap.h"
 #include "storage/table/tuple.h"
+#include "type/value_factory.h"
 
 namespace bustub {
 // NOLINTNEXTLINE
@@ -71,4 +72,48 @@ TEST(TupleTest, DISABLED_TableHeapTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(TupleTest, TableIteratorReadAheadTest) {
+  Column col1{"a", TypeId::VARCHAR, 200};
+  Column col2{"b", TypeId::BIGINT};
+  std::vector<Column> cols{col1, col2};
+  Schema schema{cols};
+
+  auto *transaction = new Transaction(0);
+  auto *disk_manager = new DiskManager("test.db");
+  auto *buffer_pool_manager = new BufferPoolManagerInstance(32, disk_manager);
+  auto *lock_manager = new LockManager();
+  auto *log_manager = new LogManager(disk_manager);
+  auto *table = new TableHeap(buffer_pool_manager, lock_manager, log_manager, transaction);
+
+  // The table spans many more pages than the buffer pool holds, so the scans below keep reading ahead.
+  const int64_t num_tuples = 5000;
+  for (int64_t i = 0; i < num_tuples; ++i) {
+    std::vector<Value> values{ValueFactory::GetVarcharValue(std::string(100, 'a' + i % 26)),
+                              ValueFactory::GetBigIntValue(i)};
+    RID rid;
+    ASSERT_TRUE(table->InsertTuple(Tuple(values, &schema), &rid, transaction));
+  }
+
+  for (int scan = 0; scan < 2; ++scan) {
+    int64_t expected = 0;
+    for (auto itr = table->Begin(transaction); itr != table->End(); ++itr) {
+      EXPECT_EQ(expected, itr->GetValue(&schema, 1).GetAs<int64_t>());
+      ++expected;
+    }
+    EXPECT_EQ(num_tuples, expected);
+    EXPECT_EQ(0, buffer_pool_manager->Count());
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");  // remove db file
+  remove("test.log");
+  delete table;
+  delete log_manager;
+  delete lock_manager;
+  delete buffer_pool_manager;
+  delete disk_manager;
+  delete transaction;
+}
+
 }  // namespace bustub